@@ -0,0 +1,280 @@
+// ****************************************************************************
+//  host-main.cpp                                                 DB48X project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Main entry point for the headless host build
+//
+//     This runs RPL source code read from files, from the command line or
+//     from standard input, then prints the resulting stack. There is no
+//     screen and no keyboard, which makes it possible to run and benchmark
+//     the interpreter, the garbage collector and the numerics on a server.
+//
+//     The program must run from the top of the source tree, so that it
+//     finds the configuration, help and state files at the same relative
+//     location as on the calculator.
+//
+// ****************************************************************************
+//   (C) 2024 Christophe de Dinechin <christophe@dinechin.org>
+//   This software is licensed under the terms outlined in LICENSE.txt
+// ****************************************************************************
+//   This file is part of DB48X.
+//
+//   DB48X is free software: you can redistribute it and/or modify
+//   it under the terms outlined in the LICENSE.txt file
+//
+//   DB48X is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// ****************************************************************************
+
+#include "main.h"
+#include "program.h"
+#include "recorder.h"
+#include "renderer.h"
+#include "runtime.h"
+#include "sysmenu.h"
+#include "version.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+
+RECORDER(host, 16, "Headless host runner");
+
+bool   run_tests   = false;
+bool   noisy_tests = false;
+bool   no_beep     = true;
+uint   memory_size = MEMORY; // Memory size in kilobytes
+
+extern void program_init();
+
+
+static void usage(cstring program)
+// ----------------------------------------------------------------------------
+//   Display the command-line options
+// ----------------------------------------------------------------------------
+{
+    fprintf(stderr,
+            "Usage: %s [options] [files...]\n"
+            "Run RPL source from files, -e options or standard input\n"
+            "  -e <source>    Run the given RPL source code\n"
+            "  -m <size>      Memory size in kilobytes (default %u)\n"
+            "  -t <traces>    Enable the given recorder traces\n"
+            "  -l <state>     Load a state file (.48S or .48B) before running\n"
+            "  -s <state>     Save a state file (.48S or .48B) after running\n"
+            "  --bench <N>    Run the code N times and report statistics\n",
+            program, uint(MEMORY));
+}
+
+
+static bool read_file(std::string &source, FILE *f)
+// ----------------------------------------------------------------------------
+//   Append the contents of a file to the source code
+// ----------------------------------------------------------------------------
+{
+    char   buffer[4096];
+    size_t sz;
+    while ((sz = fread(buffer, 1, sizeof(buffer), f)))
+        source.append(buffer, sz);
+    return !ferror(f);
+}
+
+
+static bool run(const std::string &source)
+// ----------------------------------------------------------------------------
+//   Parse and run the source code, report errors on standard error
+// ----------------------------------------------------------------------------
+{
+    rt.clear_error();
+    program_g cmds = program::parse(utf8(source.data()), source.size());
+    if (cmds)
+        cmds->run();
+    if (utf8 error = rt.error())
+    {
+        fprintf(stderr, "Error: %s\n", cstring(error));
+        rt.clear_error();
+        return false;
+    }
+    return cmds;
+}
+
+
+static void print_stack()
+// ----------------------------------------------------------------------------
+//   Print the stack on standard output, from the deepest level to level 1
+// ----------------------------------------------------------------------------
+{
+    for (uint depth = rt.depth(); depth > 0; depth--)
+    {
+        object_g obj = rt.stack(depth - 1);
+        renderer r;
+        obj->render(r);
+        printf("%u: %.*s\n", depth, int(r.size()), cstring(r.text()));
+    }
+}
+
+
+static double milliseconds()
+// ----------------------------------------------------------------------------
+//   Return wall-clock time in milliseconds
+// ----------------------------------------------------------------------------
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+
+static bool bench(const std::string &source, uint runs)
+// ----------------------------------------------------------------------------
+//   Run the code the given number of times and report statistics
+// ----------------------------------------------------------------------------
+//   Allocation volume is what was added to temporaries during the runs,
+//   whether it was later purged by the garbage collector or is still there.
+{
+    bool   ok      = true;
+    size_t cycles  = rt.gc_cycles();
+    size_t purged  = rt.gc_purged();
+    size_t temps   = rt.temporaries();
+    double start   = milliseconds();
+    for (uint r = 0; r < runs; r++)
+    {
+        rt.drop(rt.depth());
+        ok = run(source) && ok;
+    }
+    double duration = milliseconds() - start;
+    cycles = rt.gc_cycles() - cycles;
+    purged = rt.gc_purged() - purged;
+    size_t allocated = purged + rt.temporaries() - temps;
+
+    fprintf(stderr,
+            "Bench: %u runs in %.3f ms\n"
+            "  Time:        %12.3f ms/run\n"
+            "  GC cycles:   %12.3f /run\n"
+            "  Allocated:   %12.1f bytes/run\n",
+            runs, duration,
+            duration / runs,
+            double(cycles) / runs,
+            double(allocated) / runs);
+    return ok;
+}
+
+
+int main(int argc, char *argv[])
+// ----------------------------------------------------------------------------
+//   Main entry point for the host build
+// ----------------------------------------------------------------------------
+{
+    const char *traces = getenv("DB48X_TRACES");
+    recorder_trace_set(".*(error|warn(ing)?)s?");
+    if (traces)
+        recorder_trace_set(traces);
+    recorder_dump_on_common_signals(0, 0);
+
+    std::string source;
+    bool        sources = false;
+    uint        runs    = 0;
+    cstring     load    = nullptr;
+    cstring     save    = nullptr;
+
+    for (int a = 1; a < argc; a++)
+    {
+        cstring as   = argv[a];
+        bool    more = a + 1 < argc;
+        record(host, "  %u: %+s", a, as);
+        if (strcmp(as, "-e") == 0 && more)
+        {
+            source += argv[++a];
+            source += '\n';
+            sources = true;
+        }
+        else if (strcmp(as, "-m") == 0 && more)
+        {
+            memory_size = atoi(argv[++a]);
+        }
+        else if (strcmp(as, "-t") == 0 && more)
+        {
+            recorder_trace_set(argv[++a]);
+        }
+        else if (strcmp(as, "-l") == 0 && more)
+        {
+            load = argv[++a];
+        }
+        else if (strcmp(as, "-s") == 0 && more)
+        {
+            save = argv[++a];
+        }
+        else if (strcmp(as, "--bench") == 0 && more)
+        {
+            runs = atoi(argv[++a]);
+        }
+        else if (strcmp(as, "-v") == 0 || strcmp(as, "--version") == 0)
+        {
+            printf("%s version %s\n", PROGRAM_NAME, DB48X_VERSION);
+            return 0;
+        }
+        else if (as[0] == '-' && as[1])
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        else
+        {
+            FILE *f = strcmp(as, "-") == 0 ? stdin : fopen(as, "r");
+            if (!f || !read_file(source, f))
+            {
+                perror(as);
+                return 1;
+            }
+            if (f != stdin)
+                fclose(f);
+            source += '\n';
+            sources = true;
+        }
+    }
+
+    if (!sources && !read_file(source, stdin))
+    {
+        perror("stdin");
+        return 1;
+    }
+
+    program_init();
+    if (load)
+    {
+        // Check the file first, the loader waits for a key when it fails
+        FILE *f = fopen(load, "r");
+        if (!f)
+        {
+            perror(load);
+            return 1;
+        }
+        fclose(f);
+
+        // The return value follows the DMCP menu convention, check errors
+        load_state_file(load);
+        if (utf8 error = rt.error())
+        {
+            fprintf(stderr, "Unable to load state %s: %s\n", load, error);
+            return 1;
+        }
+    }
+
+    bool ok = runs ? bench(source, runs) : run(source);
+    print_stack();
+
+    if (save)
+    {
+        save_state_file(save);
+        if (utf8 error = rt.error())
+        {
+            fprintf(stderr, "Unable to save state %s: %s\n", save, error);
+            return 1;
+        }
+    }
+    return ok ? 0 : 2;
+}
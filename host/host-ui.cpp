@@ -0,0 +1,166 @@
+// ****************************************************************************
+//  host-ui.cpp                                                   DB48X project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     User-interface hooks for the headless host build
+//
+//     The DMCP emulation in sim/dmcp.cpp calls these hooks to refresh the
+//     screen, read the keyboard or play sounds. Without a screen, they do
+//     nothing, except for file I/Os, which are performed directly.
+//
+//
+// ****************************************************************************
+//   (C) 2024 Christophe de Dinechin <christophe@dinechin.org>
+//   This software is licensed under the terms outlined in LICENSE.txt
+// ****************************************************************************
+//   This file is part of DB48X.
+//
+//   DB48X is free software: you can redistribute it and/or modify
+//   it under the terms outlined in the LICENSE.txt file
+//
+//   DB48X is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// ****************************************************************************
+
+#include "dmcp.h"
+#include "sim-dmcp.h"
+#include "tests.h"
+
+#include <unistd.h>
+
+
+// The key-driven test suite needs a screen, so it is not linked in
+volatile uint test_command   = 0;
+bool          tests::running = false;
+
+
+void ui_refresh()
+// ----------------------------------------------------------------------------
+//   Nothing to refresh without a screen
+// ----------------------------------------------------------------------------
+{
+}
+
+
+uint ui_refresh_count()
+// ----------------------------------------------------------------------------
+//   Return the number of times the display was actually udpated
+// ----------------------------------------------------------------------------
+{
+    return 0;
+}
+
+
+void ui_screenshot()
+// ----------------------------------------------------------------------------
+//   No screen snapshot on the host
+// ----------------------------------------------------------------------------
+{
+}
+
+
+void ui_push_key(int k)
+// ----------------------------------------------------------------------------
+//   No keyboard to update on the host
+// ----------------------------------------------------------------------------
+{
+}
+
+
+void ui_ms_sleep(uint ms_delay)
+// ----------------------------------------------------------------------------
+//   Suspend the current thread for the given interval in milliseconds
+// ----------------------------------------------------------------------------
+{
+    usleep(ms_delay * 1000);
+}
+
+
+int ui_file_selector(const char *title,
+                     const char *base_dir,
+                     const char *ext,
+                     file_sel_fn callback,
+                     void       *data,
+                     int         disp_new,
+                     int         overwrite_check)
+// ----------------------------------------------------------------------------
+//  No interactive file selection on the host
+// ----------------------------------------------------------------------------
+{
+    return 0;
+}
+
+
+void ui_save_setting(const char *name, const char *value)
+// ----------------------------------------------------------------------------
+//  Settings are not persisted on the host
+// ----------------------------------------------------------------------------
+{
+}
+
+
+size_t ui_read_setting(const char *name, char *value, size_t maxlen)
+// ----------------------------------------------------------------------------
+//  Settings are not persisted on the host
+// ----------------------------------------------------------------------------
+{
+    return 0;
+}
+
+
+uint ui_battery()
+// ----------------------------------------------------------------------------
+//   Report a full battery
+// ----------------------------------------------------------------------------
+{
+    return 1000;
+}
+
+
+bool ui_charging()
+// ----------------------------------------------------------------------------
+//   The host is always on external power
+// ----------------------------------------------------------------------------
+{
+    return true;
+}
+
+
+void ui_start_buzzer(uint frequency)
+// ----------------------------------------------------------------------------
+//   No buzzer on the host
+// ----------------------------------------------------------------------------
+{
+}
+
+
+void ui_stop_buzzer()
+// ----------------------------------------------------------------------------
+//  No buzzer on the host
+// ----------------------------------------------------------------------------
+{
+}
+
+
+int ui_wrap_io(file_sel_fn callback, const char *path, void *data, bool)
+// ----------------------------------------------------------------------------
+//   Run file I/Os directly, since there is no other thread
+// ----------------------------------------------------------------------------
+{
+    cstring name = path;
+    for (cstring p = path; *p; p++)
+        if (*p == '/' || *p == '\\')
+            name = p + 1;
+    return callback(path, name, data);
+}
+
+
+void ui_load_keymap(cstring name)
+// ----------------------------------------------------------------------------
+//   No visible keyboard to change on the host
+// ----------------------------------------------------------------------------
+{
+}
@@ -46,6 +46,7 @@ SOURCES +=                                      \
         ../src/command.cc                       \
         ../src/comment.cc                       \
         ../src/compare.cc                       \
+        ../src/compile.cc                       \
         ../src/complex.cc                       \
         ../src/conditionals.cc                  \
         ../src/constants.cc                     \
@@ -66,6 +67,7 @@ SOURCES +=                                      \
         ../src/graphics.cc                      \
         ../src/grob.cc                          \
         ../src/hwfp.cc                          \
+        ../src/hwmatrix.cc                      \
         ../src/integer.cc                       \
         ../src/integrate.cc                     \
         ../src/library.cc                       \
@@ -77,10 +79,12 @@ SOURCES +=                                      \
         ../src/object.cc                        \
         ../src/plot.cc                          \
         ../src/polynomial.cc                    \
+        ../src/profile.cc                       \
         ../src/program.cc                       \
         ../src/renderer.cc                      \
         ../src/runtime.cc                       \
         ../src/settings.cc                      \
+        ../src/snapshot.cc                      \
         ../src/solve.cc                         \
         ../src/stack.cc                         \
         ../src/stats.cc                         \
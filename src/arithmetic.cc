@@ -1649,17 +1649,34 @@ algebraic_p arithmetic::evaluate(algebraic_r x, algebraic_r y)
 {
     if (!x || !y)
         return nullptr;
-    if (Op::target)
+
+    // Check if we already know a fast path for these argument types
+    id xt = x->type();
+    id yt = y->type();
+    if (target_fn tgt = Op::fast.find(xt, yt))
     {
-        if (arithmetic_fn code = Op::target(x, y))
+        if (arithmetic_fn code = tgt(x, y))
         {
+            fast_hits++;
             if (algebraic_p result = optimize<Op>(x, y))
                 return result;
             else
                 return code(x, y);
         }
     }
-    return evaluate(Op::static_id, x, y, Ops<Op>());
+
+    // Slow path, remember the type-specific code it reports, if any
+    Op::fast.last = nullptr;
+    algebraic_g result = evaluate(Op::static_id, x, y, Ops<Op>());
+    if (target_fn tgt = Op::fast.last)
+    {
+        if (result && tgt(x, y))
+        {
+            fast_misses++;
+            Op::fast.insert(xt, yt, tgt);
+        }
+    }
+    return result;
 }
 
 
@@ -1956,7 +1973,11 @@ COMMAND_BODY(Div2)
 }
 
 
-#define ARITHMETIC_DEFINE(derived)      arithmetic::target_fn derived::target;
+#define ARITHMETIC_DEFINE(derived)      arithmetic::fast_cache derived::fast;
+
+ularge arithmetic::fast_hits   = 0;
+ularge arithmetic::fast_misses = 0;
+
 
 ARITHMETIC_DEFINE(add);
 ARITHMETIC_DEFINE(subtract);
@@ -109,6 +109,60 @@ protected:
     typedef decimal_p (*decimal_fn)(decimal_r x, decimal_r y);
     typedef arithmetic_fn (*target_fn)(algebraic_r x, algebraic_r y);
 
+    struct fast_cache
+    // ------------------------------------------------------------------------
+    //   Polymorphic inline cache of fast paths, indexed by argument types
+    // ------------------------------------------------------------------------
+    //   Type-specific code reports itself with `remember()` on the slow
+    //   path. The target function checks that it applies to the arguments,
+    //   e.g. that hardware floating-point is still enabled, and returns the
+    //   function to call. Keeping a few entries per operator avoids thrashing
+    //   when a program mixes, say, hwdouble arithmetic with bignum counters.
+    {
+        enum { ENTRIES = 4 };
+
+        target_fn find(id xt, id yt) const
+        {
+            for (const entry &e : entries)
+                if (e.xt == xt && e.yt == yt)
+                    return e.target;
+            return nullptr;
+        }
+
+        void insert(id xt, id yt, target_fn tgt)
+        {
+            for (entry &e : entries)
+            {
+                if (e.xt == xt && e.yt == yt)
+                {
+                    e.target = tgt;
+                    return;
+                }
+            }
+            entry &e = entries[next];
+            next = (next + 1) % ENTRIES;
+            e.xt = xt;
+            e.yt = yt;
+            e.target = tgt;
+        }
+
+        struct entry
+        {
+            uint16_t  xt, yt;
+            target_fn target;
+        };
+        entry     entries[ENTRIES];
+        target_fn last;         // Last target reported by remember()
+        uint      next;
+    };
+
+public:
+    // Statistics for the fast path caches
+    static ularge fast_hits;
+    static ularge fast_misses;
+
+protected:
+
     // Structure holding the function pointers called by generic code
     struct ops
     {
@@ -174,30 +228,8 @@ struct derived : arithmetic                                             \
     static bool fraction_ok(fraction_g &x, fraction_g &y);              \
     static bool complex_ok(complex_g &x, complex_g &y);                 \
     static constexpr decimal_fn decop = decimal::derived;               \
-                                                                        \
-    static arithmetic_fn target_float(algebraic_r x, algebraic_r y)     \
-    {                                                                   \
-        return x->type() == ID_hwfloat && y->type() == ID_hwfloat       \
-            ? arithmetic_fn(hwfloat::derived) : nullptr;                \
-    }                                                                   \
-    static arithmetic_fn target_double(algebraic_r x, algebraic_r y)    \
-    {                                                                   \
-        return x->type() == ID_hwdouble && y->type() == ID_hwdouble     \
-            ? arithmetic_fn(hwdouble::derived) : nullptr;               \
-    }                                                                   \
-                                                                        \
-    static hwfloat_p do_float(hwfloat_r x, hwfloat_r y)                 \
-    {                                                                   \
-        remember(target_float);                                         \
-        return hwfloat::derived(x, y);                                  \
-    }                                                                   \
-    static hwdouble_p do_double(hwdouble_r x, hwdouble_r y)             \
-    {                                                                   \
-        remember(target_double);                                        \
-        return hwdouble::derived(x, y);                                 \
-    }                                                                   \
-    static constexpr auto       fop   = do_float;                       \
-    static constexpr auto       dop   = do_double;                      \
+    static constexpr auto       fop   = hwfloat::derived;               \
+    static constexpr auto       dop   = hwdouble::derived;              \
                                                                         \
     OBJECT_DECL(derived)                                                \
     ARITY_DECL(2);                                                      \
@@ -220,10 +252,10 @@ struct derived : arithmetic                                             \
     }                                                                   \
     static void remember(target_fn tgt)                                 \
     {                                                                   \
-        target = tgt;                                                   \
+        fast.last = tgt;                                                \
     }                                                                   \
                                                                         \
-    static target_fn target;                                            \
+    static fast_cache fast;                                             \
 }
 
 
@@ -33,6 +33,7 @@
 #include "expression.h"
 #include "functions.h"
 #include "grob.h"
+#include "hwmatrix.h"
 #include "stats.h"
 #include "tag.h"
 #include "variables.h"
@@ -477,6 +478,14 @@ algebraic_p array::determinant() const
 {
     size_t cx, rx;
     size_t depth = rt.depth();
+    if (id ty = hwmatrix::type(this, &rx, &cx))
+    {
+        if (cx && rx == cx)
+            if (algebraic_p det = hwmatrix::determinant(this, ty, cx))
+                return det;
+        if (rt.error())
+            return nullptr;
+    }
     if (is_matrix(&rx, &cx))
     {
         if (rx != cx)
@@ -787,6 +796,14 @@ array_p array::invert() const
     size_t depth = rt.depth();
     id     atype = type();
 
+    if (id ty = hwmatrix::type(this, &rx, &cx))
+    {
+        if (cx && rx == cx && atype == ID_array)
+            if (array_p inv = hwmatrix::invert(this, ty, cx))
+                return inv;
+        if (rt.error())
+            return nullptr;
+    }
     if (is_matrix(&rx, &cx))
     {
         if (rx != cx)
@@ -1120,6 +1137,11 @@ algebraic_p array::dot(array_r &x, array_r &y)
     if (!x || !y)
         return nullptr;
 
+    size_t xr, xc, yr, yc;
+    if (id ty = hwmatrix::type(x, &xr, &xc))
+        if (!xc && hwmatrix::type(y, &yr, &yc) == ty && !yc && xr == yr)
+            return hwmatrix::dot(x, y, ty, xr);
+
     array::iterator xi = x->begin();
     array::iterator yi = y->begin();
     size_t          count  = 0;
@@ -1208,6 +1230,12 @@ array_p array::cross(array_r &x, array_r &y)
     if (!x || !y)
         return nullptr;
 
+    size_t xr, xc, yr, yc;
+    if (id ty = hwmatrix::type(x, &xr, &xc))
+        if (!xc && xr == 3 && x->type() == ID_array &&
+            hwmatrix::type(y, &yr, &yc) == ty && !yc && yr == 3)
+            return hwmatrix::cross(x, y, ty);
+
     array::iterator xi      = x->begin();
     array::iterator yi      = y->begin();
     size_t          count   = 0;
@@ -2020,6 +2048,12 @@ array_p array::mul(array_r x, array_r y)
     if (!x || !y)
         return nullptr;
 
+    size_t xr, xc, yr, yc;
+    if (id ty = hwmatrix::type(x, &xr, &xc))
+        if (xc && x->type() == ID_array &&
+            hwmatrix::type(y, &yr, &yc) == ty && xc == yr)
+            return hwmatrix::mul(x, y, ty, xr, xc, yc);
+
     stack_depth_restore sdr;
     array::iterator xi = x->begin();
     array::iterator yi = y->begin();
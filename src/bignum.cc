@@ -112,6 +112,580 @@ HELP_BODY(bignum)
 }
 
 
+// ============================================================================
+//
+//    Limb arithmetic
+//
+// ============================================================================
+//   The bignum payload is a little-endian sequence of bytes, which is not
+//   aligned and whose size is not a multiple of the machine word size.
+//   Multiplication and division copy it into aligned 32-bit limbs in the
+//   scratchpad, so that inner loops use the native 32x32->64 bit multiply.
+
+typedef uint32_t limb;
+typedef uint64_t dlimb;
+static const uint   LIMB_BITS           = 32;
+static const size_t KARATSUBA_THRESHOLD = 24;
+
+
+static inline size_t limbs(size_t bytes)
+// ----------------------------------------------------------------------------
+//   Number of limbs required for a given number of bytes
+// ----------------------------------------------------------------------------
+{
+    return (bytes + sizeof(limb) - 1) / sizeof(limb);
+}
+
+
+static inline limb *limbs_align(byte *p)
+// ----------------------------------------------------------------------------
+//   Align a scratchpad pointer for limb access
+// ----------------------------------------------------------------------------
+//   The scratchpad allocation must include sizeof(limb)-1 extra bytes
+{
+    uintptr_t a = (uintptr_t(p) + sizeof(limb) - 1) & ~(sizeof(limb) - 1);
+    return (limb *) a;
+}
+
+
+static void limbs_load(limb *l, size_t n, byte_p b, size_t bs)
+// ----------------------------------------------------------------------------
+//   Load a byte payload into n limbs, zero-extending it
+// ----------------------------------------------------------------------------
+{
+    for (size_t i = 0; i < n; i++)
+        l[i] = 0;
+    for (size_t i = 0; i < bs; i++)
+        l[i / sizeof(limb)] |= limb(b[i]) << (8 * (i % sizeof(limb)));
+}
+
+
+static byte *limbs_store(limb *l, size_t n)
+// ----------------------------------------------------------------------------
+//   Convert limbs to a little-endian byte sequence in place
+// ----------------------------------------------------------------------------
+{
+    byte *b = (byte *) l;
+    for (size_t i = 0; i < n; i++)
+    {
+        limb v = l[i];
+        for (uint j = 0; j < sizeof(limb); j++)
+            b[i * sizeof(limb) + j] = byte(v >> (8 * j));
+    }
+    return b;
+}
+
+
+static limb limbs_add(limb *r, const limb *a, size_t na,
+                      const limb *b, size_t nb)
+// ----------------------------------------------------------------------------
+//   Set r[0..na) = a + b, with na >= nb, return the carry out
+// ----------------------------------------------------------------------------
+{
+    dlimb c = 0;
+    size_t i;
+    for (i = 0; i < nb; i++)
+    {
+        c += dlimb(a[i]) + b[i];
+        r[i] = limb(c);
+        c >>= LIMB_BITS;
+    }
+    for (; i < na; i++)
+    {
+        c += a[i];
+        r[i] = limb(c);
+        c >>= LIMB_BITS;
+    }
+    return limb(c);
+}
+
+
+static limb limbs_sub(limb *r, const limb *a, size_t na,
+                      const limb *b, size_t nb)
+// ----------------------------------------------------------------------------
+//   Set r[0..na) = a - b, with na >= nb, return the borrow out
+// ----------------------------------------------------------------------------
+{
+    limb borrow = 0;
+    size_t i;
+    for (i = 0; i < nb; i++)
+    {
+        dlimb d = dlimb(a[i]) - b[i] - borrow;
+        r[i] = limb(d);
+        borrow = limb(d >> LIMB_BITS) & 1;
+    }
+    for (; i < na; i++)
+    {
+        dlimb d = dlimb(a[i]) - borrow;
+        r[i] = limb(d);
+        borrow = limb(d >> LIMB_BITS) & 1;
+    }
+    return borrow;
+}
+
+
+static limb limbs_addmul1(limb *r, const limb *a, size_t n, limb m)
+// ----------------------------------------------------------------------------
+//   Add a * m to r[0..n), return the carry limb
+// ----------------------------------------------------------------------------
+{
+    dlimb c = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        c += dlimb(a[i]) * m + r[i];
+        r[i] = limb(c);
+        c >>= LIMB_BITS;
+    }
+    return limb(c);
+}
+
+
+static void limbs_mul_basecase(limb *r,
+                               const limb *a, size_t na,
+                               const limb *b, size_t nb)
+// ----------------------------------------------------------------------------
+//   Schoolbook multiplication, r[0..na+nb) = a * b
+// ----------------------------------------------------------------------------
+{
+    for (size_t i = 0; i < na + nb; i++)
+        r[i] = 0;
+    for (size_t i = 0; i < na; i++)
+        if (limb m = a[i])
+            r[i + nb] = limbs_addmul1(r + i, b, nb, m);
+}
+
+
+static size_t limbs_karatsuba_space(size_t n)
+// ----------------------------------------------------------------------------
+//   Workspace needed by limbs_karatsuba for n-limb operands
+// ----------------------------------------------------------------------------
+{
+    if (n < KARATSUBA_THRESHOLD)
+        return 0;
+    size_t h = n - n / 2;
+    return 4 * (h + 1) + limbs_karatsuba_space(h + 1);
+}
+
+
+static void limbs_karatsuba(limb *r, const limb *a, const limb *b, size_t n,
+                            limb *ws)
+// ----------------------------------------------------------------------------
+//   Karatsuba multiplication of two n-limb values, r[0..2n) = a * b
+// ----------------------------------------------------------------------------
+//   With a = a1.B^l + a0 and b = b1.B^l + b0, the middle term
+//   a1.b0 + a0.b1 is computed as (a0 + a1)(b0 + b1) - a0.b0 - a1.b1
+{
+    if (n < KARATSUBA_THRESHOLD)
+    {
+        limbs_mul_basecase(r, a, n, b, n);
+        return;
+    }
+
+    size_t l = n / 2;
+    size_t h = n - l;
+    limbs_karatsuba(r,         a,     b,     l, ws);   // z0 = a0.b0
+    limbs_karatsuba(r + 2 * l, a + l, b + l, h, ws);   // z2 = a1.b1
+
+    limb *sa = ws;
+    limb *sb = sa + (h + 1);
+    limb *z1 = sb + (h + 1);
+    sa[h] = limbs_add(sa, a + l, h, a, l);
+    sb[h] = limbs_add(sb, b + l, h, b, l);
+    limbs_karatsuba(z1, sa, sb, h + 1, z1 + 2 * (h + 1));
+    limbs_sub(z1, z1, 2 * (h + 1), r, 2 * l);
+    limbs_sub(z1, z1, 2 * (h + 1), r + 2 * l, 2 * h);
+
+    size_t zn = 2 * (h + 1);
+    while (zn > 0 && z1[zn - 1] == 0)
+        zn--;
+    limbs_add(r + l, r + l, 2 * n - l, z1, zn);
+}
+
+
+static size_t limbs_mul_space(size_t na, size_t nb)
+// ----------------------------------------------------------------------------
+//   Workspace needed by limbs_mul
+// ----------------------------------------------------------------------------
+{
+    if (na < nb)
+        std::swap(na, nb);
+    if (nb < KARATSUBA_THRESHOLD)
+        return 0;
+    if (na == nb)
+        return limbs_karatsuba_space(nb);
+    size_t full = limbs_karatsuba_space(nb);
+    size_t last = na % nb ? limbs_mul_space(nb, na % nb) : 0;
+    return 2 * nb + std::max(full, last);
+}
+
+
+static void limbs_mul(limb *r, const limb *a, size_t na,
+                      const limb *b, size_t nb, limb *ws)
+// ----------------------------------------------------------------------------
+//   Multiply two limb sequences, r[0..na+nb) = a * b
+// ----------------------------------------------------------------------------
+//   Unbalanced operands are split in chunks the size of the shorter one
+{
+    if (na < nb)
+    {
+        std::swap(a, b);
+        std::swap(na, nb);
+    }
+    if (nb < KARATSUBA_THRESHOLD)
+    {
+        limbs_mul_basecase(r, a, na, b, nb);
+        return;
+    }
+    if (na == nb)
+    {
+        limbs_karatsuba(r, a, b, nb, ws);
+        return;
+    }
+
+    for (size_t i = 0; i < na + nb; i++)
+        r[i] = 0;
+    limb *t = ws;
+    ws += 2 * nb;
+    for (size_t i = 0; i < na; i += nb)
+    {
+        size_t c = std::min(nb, na - i);
+        limbs_mul(t, a + i, c, b, nb, ws);
+        limbs_add(r + i, r + i, na + nb - i, t, c + nb);
+    }
+}
+
+
+static void limbs_divmod(limb *q, limb *u, size_t m, limb *v, size_t n)
+// ----------------------------------------------------------------------------
+//   Knuth algorithm D, divide u[0..m) by v[0..n), with m >= n
+// ----------------------------------------------------------------------------
+//   u must have room for m+1 limbs, and v[n-1] must be non-zero.
+//   On return, q[0..m-n] holds the quotient, and u[0..n) the remainder.
+//   v is normalized in place.
+{
+    if (n == 1)
+    {
+        // Short division
+        dlimb d = v[0];
+        dlimb r = 0;
+        for (size_t j = m; j-- > 0; )
+        {
+            dlimb num = (r << LIMB_BITS) | u[j];
+            q[j] = limb(num / d);
+            r = num % d;
+            u[j] = 0;
+        }
+        u[0] = limb(r);
+        return;
+    }
+
+    // Normalize so that the top bit of the divisor is set
+    uint s = 0;
+    for (limb top = v[n - 1]; !(top & (limb(1) << (LIMB_BITS - 1))); top <<= 1)
+        s++;
+    if (s)
+    {
+        for (size_t i = n - 1; i > 0; i--)
+            v[i] = (v[i] << s) | (v[i - 1] >> (LIMB_BITS - s));
+        v[0] <<= s;
+        u[m] = u[m - 1] >> (LIMB_BITS - s);
+        for (size_t i = m - 1; i > 0; i--)
+            u[i] = (u[i] << s) | (u[i - 1] >> (LIMB_BITS - s));
+        u[0] <<= s;
+    }
+    else
+    {
+        u[m] = 0;
+    }
+
+    const dlimb base = dlimb(1) << LIMB_BITS;
+    for (size_t j = m - n + 1; j-- > 0; )
+    {
+        // Estimate quotient digit from the top two limbs
+        dlimb num  = (dlimb(u[j + n]) << LIMB_BITS) | u[j + n - 1];
+        dlimb qhat = num / v[n - 1];
+        dlimb rhat = num % v[n - 1];
+        while (qhat >= base ||
+               qhat * v[n - 2] > ((rhat << LIMB_BITS) | u[j + n - 2]))
+        {
+            qhat--;
+            rhat += v[n - 1];
+            if (rhat >= base)
+                break;
+        }
+
+        // Multiply and subtract
+        int64_t k = 0;
+        int64_t t = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            dlimb p = qhat * v[i];
+            t = int64_t(u[i + j]) - k - int64_t(p & 0xFFFFFFFFu);
+            u[i + j] = limb(t);
+            k = int64_t(p >> LIMB_BITS) - (t >> LIMB_BITS);
+        }
+        t = int64_t(u[j + n]) - k;
+        u[j + n] = limb(t);
+
+        // If we subtracted too much, add back
+        q[j] = limb(qhat);
+        if (t < 0)
+        {
+            q[j]--;
+            u[j + n] += limbs_add(u + j, u + j, n, v, n);
+        }
+    }
+
+    // Unnormalize remainder
+    if (s)
+    {
+        for (size_t i = 0; i < n - 1; i++)
+            u[i] = (u[i] >> s) | (u[i + 1] << (LIMB_BITS - s));
+        u[n - 1] >>= s;
+    }
+}
+
+
+// ============================================================================
+//
+//    Radix conversion
+//
+// ============================================================================
+//   Digits are produced least significant first, as byte values in the
+//   scratchpad. Bases that are a power of two extract bits directly.
+//   Other bases peel off as many digits as fit in a limb for each pass of
+//   short division. Large values are first split in halves by dividing by
+//   a cached power of the base, so that most of the work is done by the
+//   multiply-and-subtract inner loop of algorithm D rather than by one
+//   long division per limb.
+
+static const size_t RADIX_THRESHOLD = 32;
+static const uint   RADIX_LEVELS    = 24;
+
+struct radix
+// ----------------------------------------------------------------------------
+//   Powers of the base used for radix conversion
+// ----------------------------------------------------------------------------
+{
+    uint   base;                // Base for the digits
+    uint   digits;              // Number of digits in a limb-sized chunk
+    limb   chunk;               // base ^ digits
+    uint   levels;              // Number of cached powers below
+    limb  *power[RADIX_LEVELS]; // chunk ^ (2 ^ level)
+    size_t size[RADIX_LEVELS];  // Size in limbs of each power
+
+    radix(uint base)
+        : base(base), digits(1), chunk(base), levels(0), power(), size()
+    {
+        while (chunk <= ~limb(0) / base)
+        {
+            chunk *= base;
+            digits++;
+        }
+    }
+
+    size_t pad(uint level) const
+    {
+        return size_t(digits) << level;
+    }
+};
+
+
+static size_t radix_basecase(limb *u, size_t n, byte *digits,
+                             const radix &rx)
+// ----------------------------------------------------------------------------
+//   Convert u[0..n) to digits by repeated short division, destroying u
+// ----------------------------------------------------------------------------
+{
+    size_t d = 0;
+    while (n > 0 && u[n - 1] == 0)
+        n--;
+    while (n)
+    {
+        dlimb rem = 0;
+        for (size_t j = n; j-- > 0; )
+        {
+            dlimb num = (rem << LIMB_BITS) | u[j];
+            u[j] = limb(num / rx.chunk);
+            rem = num % rx.chunk;
+        }
+        while (n > 0 && u[n - 1] == 0)
+            n--;
+
+        // Emit a full chunk unless this is the most significant one
+        limb c = limb(rem);
+        for (uint i = 0; i < rx.digits && (n || c); i++)
+        {
+            digits[d++] = c % rx.base;
+            c /= rx.base;
+        }
+    }
+    return d;
+}
+
+
+static size_t radix_convert(limb *u, size_t n, byte *digits, size_t pad,
+                            const radix &rx, limb *ws)
+// ----------------------------------------------------------------------------
+//   Convert u[0..n) to at least pad digits, destroying u
+// ----------------------------------------------------------------------------
+//   u must have room for n+1 limbs.
+//   The value is split as q * P + r, where P is the largest cached power
+//   no more than half the size of u, then r and q are converted separately
+{
+    while (n > 0 && u[n - 1] == 0)
+        n--;
+
+    uint level = rx.levels;
+    while (level > 0 && 2 * rx.size[level - 1] > n + 1)
+        level--;
+
+    size_t d = 0;
+    if (n < RADIX_THRESHOLD || level == 0)
+    {
+        d = radix_basecase(u, n, digits, rx);
+    }
+    else
+    {
+        level--;
+        size_t pn = rx.size[level];
+        size_t qn = n - pn + 1;
+        limb  *q  = ws;
+        limb  *v  = q + qn + 1;
+        for (size_t i = 0; i < pn; i++)
+            v[i] = rx.power[level][i];
+        limbs_divmod(q, u, n, v, pn);
+
+        size_t low = rx.pad(level);
+        d = radix_convert(u, pn, digits, low, rx, v + pn);
+        d += radix_convert(q, qn, digits + d, pad > d ? pad - d : 0, rx, v);
+    }
+    while (d < pad)
+        digits[d++] = 0;
+    return d;
+}
+
+
+static size_t radix_space(size_t n)
+// ----------------------------------------------------------------------------
+//   Bound on the workspace needed by radix_convert and power computation
+// ----------------------------------------------------------------------------
+//   Each split uses at most n+2 limbs, and leaves at most 3/4 of the limbs
+{
+    return std::max(4 * n + 16 * RADIX_LEVELS, limbs_mul_space(n / 2, n / 2));
+}
+
+
+static size_t radix_powers(radix &rx, limb *powers, size_t n, limb *ws)
+// ----------------------------------------------------------------------------
+//   Compute the powers of the base needed to convert an n-limb value
+// ----------------------------------------------------------------------------
+//   Returns the number of limbs used in powers, which is at most n + levels
+{
+    limb *p = powers;
+    p[0] = rx.chunk;
+    rx.power[0] = p;
+    rx.size[0] = 1;
+    rx.levels = 1;
+    size_t used = 1;
+    while (rx.levels < RADIX_LEVELS)
+    {
+        size_t last = rx.size[rx.levels - 1];
+        if (4 * last > n + 1)
+            break;
+        limb *prev = rx.power[rx.levels - 1];
+        p = prev + last;
+        limbs_mul(p, prev, last, prev, last, ws);
+        size_t sz = 2 * last;
+        while (sz > 0 && p[sz - 1] == 0)
+            sz--;
+        rx.power[rx.levels] = p;
+        rx.size[rx.levels] = sz;
+        rx.levels++;
+        used += sz;
+    }
+    return used;
+}
+
+
+static byte *radix_digits(bignum_r n, uint base,
+                          size_t *count, size_t *allocated)
+// ----------------------------------------------------------------------------
+//   Convert a bignum to digits in the scratchpad, least significant first
+// ----------------------------------------------------------------------------
+//   The caller must free the allocated scratchpad space.
+//   If there is not enough memory for divide-and-conquer conversion,
+//   this falls back to short division, which only needs a copy of n.
+{
+    size_t xs   = 0;
+    byte_p x    = n->value(&xs);
+    uint   bits = 0;
+    for (uint b = base; b > 1; b >>= 1)
+        bits++;
+    bool   pow2   = (base & (base - 1)) == 0;
+    size_t maxd   = xs * 8 / bits + 1;
+    size_t nl     = pow2 ? 0 : limbs(xs);
+    size_t needed = maxd;
+    bool   split  = false;
+    if (!pow2)
+    {
+        needed += (nl + 1) * sizeof(limb) + sizeof(limb) - 1;
+        size_t big = 0;
+        if (nl >= RADIX_THRESHOLD)
+            big = (nl + 2 * RADIX_LEVELS + radix_space(nl)) * sizeof(limb);
+        if (big && rt.available() >= needed + big)
+        {
+            needed += big;
+            split = true;
+        }
+    }
+    byte *digits = rt.allocate(needed);         // May GC here
+    if (!digits)
+        return nullptr;
+    x = n->value(&xs);                          // Re-read after potential GC
+
+    size_t d = 0;
+    if (pow2)
+    {
+        uint mask = base - 1;
+        for (size_t bit = 0; bit < xs * 8; bit += bits)
+        {
+            size_t i = bit / 8;
+            uint   s = bit % 8;
+            uint   v = x[i] >> s;
+            if (s + bits > 8 && i + 1 < xs)
+                v |= x[i + 1] << (8 - s);
+            digits[d++] = v & mask;
+        }
+        while (d > 0 && digits[d - 1] == 0)
+            d--;
+    }
+    else
+    {
+        radix rx(base);
+        limb *u = limbs_align(digits + maxd);
+        limbs_load(u, nl, x, xs);
+        if (split)
+        {
+            limb *powers = u + nl + 1;
+            limb *ws = powers + nl + 2 * RADIX_LEVELS;
+            radix_powers(rx, powers, nl, ws);
+            d = radix_convert(u, nl, digits, 0, rx, ws);
+        }
+        else
+        {
+            d = radix_basecase(u, nl, digits, rx);
+        }
+    }
+    if (!d)
+        digits[d++] = 0;
+
+    *count = d;
+    *allocated = needed;
+    return digits;
+}
+
+
 static size_t render_num(renderer &r,
                          bignum_p  num,
                          uint      base,
@@ -122,17 +696,8 @@ static size_t render_num(renderer &r,
 //   This is necessary because the arm-none-eabi-gcc printf can't do 64-bit
 //   I'm getting non-sensible output
 {
-    // If we render to a file, need to first render to scratchpad to be able to
-    // revert the digits in memory before writing
-    if (r.file_save())
-    {
-        renderer tmp(r.expression(), r.editing(), r.stack());
-        size_t result = render_num(tmp, num, base, fmt);
-        r.put(tmp.text(), result);
-        return result;
-    }
-
     // Upper / lower rendering
+    bignum_g n = (bignum *) num;
     bool upper = *fmt == '^';
     bool lower = *fmt == 'v';
     if (upper || lower)
@@ -162,43 +727,32 @@ static size_t render_num(renderer &r,
     else
         r.flush();
 
-    // Get denominator for the base
-    size_t findex = r.size();
-    bignum_g b = rt.make<bignum>(object::ID_bignum, base);
-    bignum_g n = (bignum *) num;
+    // Convert to digits in the scratchpad, least significant first
+    size_t   count     = 0;
+    size_t   allocated = 0;
+    gcmbytes digits    = radix_digits(n, base, &count, &allocated);
+    if (!digits)
+        return r.size();
+    size_t mark = rt.allocated();
 
-    // Keep dividing by the base until we get 0
-    uint sep = 0;
-    do
+    // Emit the digits, most significant first
+    for (size_t i = count; i-- > 0; )
     {
-        bignum_g remainder = nullptr;
-        bignum_g quotient = nullptr;
-        if (!bignum::quorem(n, b, bignum::ID_bignum, &quotient, &remainder))
-            break;
-        uint digit = remainder->value<uint>();
-        if (digit > base)
-        {
-            printf("Ooops: digit=%u, base=%u\n", digit, base);
-            bignum::quorem(n, b, bignum::ID_bignum, &quotient, &remainder);
-        }
+        uint digit = digits[i];
         unicode c = upper        ? fancy_upper_digits[digit]
                   : lower        ? fancy_lower_digits[digit]
                   : (digit < 10) ? digit + '0'
                                  : digit + ('A' - 10);
         r.put(c);
-        n = quotient;
-
-        if (!n->is_zero() && ++sep == spacing)
-        {
-            sep = 0;
+        if (i && spacing && i % spacing == 0)
             r.put(space);
-        }
-    } while (!n->is_zero());
+    }
 
-    // Revert the digits
-    byte *dest  = (byte *) r.text();
-    bool multibyte = upper || lower || (spacing && space > 0xFF);
-    utf8_reverse(dest + findex, dest + r.size(), multibyte);
+    // Release the digits, moving text rendered in the scratchpad down
+    byte *start = digits;
+    size_t rendered = rt.allocated() - mark;
+    memmove(start, start + allocated, rendered);
+    rt.free(allocated);
 
     // Add suffix if there is one
     if (fancy_base)
@@ -513,52 +1067,38 @@ bignum_p bignum::multiply(bignum_r yg, bignum_r xg, id ty)
         rt.number_too_big_error();
         return nullptr;
     }
-    if (wbits && needed > wbytes)
-        needed = wbytes;
-    byte *buffer = rt.allocate(needed);       // May GC here
+    if (!xs || !ys)
+        return rt.make<bignum>(ty, 0);
+
+    // Scratch layout: x limbs, y limbs, product, Karatsuba workspace
+    size_t xl = limbs(xs);
+    size_t yl = limbs(ys);
+    size_t pl = xl + yl;
+    size_t wl = limbs_mul_space(xl, yl);
+    size_t scratch = (xl + yl + pl + wl) * sizeof(limb) + sizeof(limb) - 1;
+    byte *buffer = rt.allocate(scratch);      // May GC here
     if (!buffer)
         return nullptr;                       // Out of memory
     x = xg->value(&xs);                       // Re-read after potential GC
     y = yg->value(&ys);
 
-    // Zero-initialie the result
-    for (size_t i = 0; i < needed; i++)
-        buffer[i] = 0;
-
-    // Loop on all bytes of x then y
-    for (size_t xi = 0; xi < xs; xi++)
-    {
-        byte xd = x[xi];
-        for (int bit = 0; xd && bit < 8; bit++)
-        {
-            if (xd & (1<<bit))
-            {
-                uint c = 0;
-                size_t yi;
-                for (yi = 0; yi < ys && xi + yi < needed; yi++)
-                {
-                    c += buffer[xi + yi] + (y[yi] << bit);
-                    buffer[xi + yi] = byte(c);
-                    c >>= 8;
-                }
-                while (c && xi + yi < needed)
-                {
-                    c += buffer[xi + yi];
-                    buffer[xi + yi] = byte(c);
-                    c >>= 8;
-                    yi++;
-                }
-                xd &= ~(1<<bit);
-            }
-        }
-    }
+    limb *xv = limbs_align(buffer);
+    limb *yv = xv + xl;
+    limb *pv = yv + yl;
+    limb *wv = pv + pl;
+    limbs_load(xv, xl, x, xs);
+    limbs_load(yv, yl, y, ys);
+    limbs_mul(pv, xv, xl, yv, yl, wv);
 
+    if (wbits && needed > wbytes)
+        needed = wbytes;
     size_t sz = needed;
-    while (sz > 0 && buffer[sz-1] == 0)
+    byte *product = limbs_store(pv, pl);
+    while (sz > 0 && product[sz-1] == 0)
         sz--;
-    gcbytes buf = buffer;
+    gcbytes buf = product;
     bignum_g result = rt.make<bignum>(ty, buf, sz);
-    rt.free(needed);
+    rt.free(scratch);
     return result;
 }
 
@@ -582,7 +1122,7 @@ bool bignum::quorem(bignum_r yg, bignum_r xg, id ty, bignum_g *q, bignum_g *r)
 // ----------------------------------------------------------------------------
 //   Compute quotient and remainder of two bignums, as bignums
 // ----------------------------------------------------------------------------
-//   Result is placed in scratchpad, the function returns the size in bytes
+//   This uses Knuth's algorithm D on 32-bit limbs in the scratchpad
 {
     if (xg->is_zero())
     {
@@ -590,86 +1130,43 @@ bool bignum::quorem(bignum_r yg, bignum_r xg, id ty, bignum_g *q, bignum_g *r)
         return false;
     }
 
-    // In the computations below (e.g. needed), the size of the quotient is
-    // less than the size of y, and the size of the remainder is less than the
-    // size of x, therefore, we need at most xs + ys for both.
-    // However, the computation of the remainder requires a subtraction
-    // which can be one byte larger than x (see issue #70 for details).
-    // For example in 0x17B/0xEF, the first remainder subtraction will be
-    // 0x17B - 0xEF, which does require two bytes, not just one. It could
-    // be carried out by keeping the extra byte in a variable, but it's
-    // simpler to allocate one extra byte.
+    // The quotient has at most ys bytes and the remainder at most xs bytes.
+    // Algorithm D needs one extra limb for the normalized numerator.
     size_t xs = 0;
     size_t ys = 0;
-    byte_p x = xg->value(&xs);                // Read those after potential GC
+    byte_p x = xg->value(&xs);
     byte_p y = yg->value(&ys);
     id xt = xg->type();
     size_t wbits = wordsize(xt);
     size_t wbytes = (wbits + 7) / 8;
-    size_t needed = ys + xs + 1;              // No need to check maxbignum
+    size_t xl = limbs(xs);
+    size_t yl = std::max(limbs(ys), xl);
+    size_t ql = yl - xl + 1;
+    size_t needed = (yl + 1 + xl + ql) * sizeof(limb) + sizeof(limb) - 1;
     byte *buffer = rt.allocate(needed);       // May GC here
     if (!buffer)
         return false;                         // Out of memory
     x = xg->value(&xs);                       // Re-read after potential GC
     y = yg->value(&ys);
 
-    // Pointers ot quotient and remainder, initializer to 0
-    byte *quotient = buffer;
-    byte *remainder = quotient + ys;
-    size_t rs = 0;
-    size_t qs = 0;
-    for (uint i = 0; i < needed; i++)
-        buffer[i] = 0;
-
-    // Loop on the numerator
-    for (int yi = ys-1; yi >= 0; yi--)
-    {
-        for (int bit = 7; bit >= 0; bit--)
-        {
-            // Shift remainder left by one bit, add numerator bit
-            uint16_t c = (y[yi] >> bit) & 1;
-            int delta = 0;
-            for (uint ri = 0; ri < rs; ri++)
-            {
-                c += (remainder[ri] << 1);
-                remainder[ri] = byte(c);
-                if (int d = remainder[ri] - x[ri])
-                    delta = d;
-                c >>= 8;
-            }
-
-            if (c)
-            {
-                if (int d = c - x[rs])
-                    delta = d;
-                remainder[rs++] = c;
-            }
-            if (rs != xs)
-                delta = int(rs) - int(xs);
-
-            // If remainder >= denominator, add to quotient, subtract from rem
-            if (delta >= 0)
-            {
-                quotient[yi] |= (1 << bit);
-                if (qs < size_t(yi + 1))
-                    qs = yi + 1;
-
-                c = 0;
-                for (uint ri = 0; ri < rs; ri++)
-                {
-                    c = remainder[ri] - (ri < xs ? x[ri] : 0) - c;
-                    remainder[ri] = byte(c);
-                    c = c > 0xFF;
-                }
-
-                // Strip zeroes at top of remainder
-                while (rs > 0 && remainder[rs-1] == 0)
-                    rs--;
-            }
-        } // numerator bit loop
-    } // numerator byte loop
+    // Scratch layout: numerator / remainder, divisor, quotient
+    limb *uv = limbs_align(buffer);
+    limb *vv = uv + yl + 1;
+    limb *qv = vv + xl;
+    limbs_load(uv, yl, y, ys);
+    limbs_load(vv, xl, x, xs);
+    limbs_divmod(qv, uv, yl, vv, xl);
 
     // Generate results
+    byte *quotient = limbs_store(qv, ql);
+    byte *remainder = limbs_store(uv, xl);
+    size_t qs = std::min(ql * sizeof(limb), ys);
+    size_t rs = std::min(xl * sizeof(limb), xs);
+    while (qs > 0 && quotient[qs-1] == 0)
+        qs--;
+    while (rs > 0 && remainder[rs-1] == 0)
+        rs--;
+
     gcutf8 qg = quotient;
     gcutf8 rg = remainder;
     bool ok = true;
@@ -0,0 +1,661 @@
+// ****************************************************************************
+//  compile.cc                                                   DB48X project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Compile numerical functions into a compact register bytecode
+//
+//     The compiler simulates the RPL stack, assigning a register to each
+//     stack level. Leaves (numbers, variables, the independent variable)
+//     do not generate any code, they simply push the register holding their
+//     value. Each operation generates one instruction reading its arguments
+//     from registers and writing its result in the register for the stack
+//     level where the result lands.
+//
+//     Register 0 holds the input value. Stack levels use registers 1 and up,
+//     and constants are allocated from the last register down.
+//
+// ****************************************************************************
+//   (C) 2024 Christophe de Dinechin <christophe@dinechin.org>
+//   This software is licensed under the terms outlined in LICENSE.txt
+// ****************************************************************************
+//   This file is part of DB48X.
+//
+//   DB48X is free software: you can redistribute it and/or modify
+//   it under the terms outlined in the LICENSE.txt file
+//
+//   DB48X is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// ****************************************************************************
+
+#include "compile.h"
+
+#include "arithmetic.h"
+#include "decimal.h"
+#include "equations.h"
+#include "expression.h"
+#include "fraction.h"
+#include "functions.h"
+#include "hwfp.h"
+#include "integer.h"
+#include "recorder.h"
+#include "settings.h"
+#include "symbol.h"
+#include "variables.h"
+
+#include <cmath>
+
+RECORDER(compile, 16, "Compilation of numerical functions");
+
+
+// Operations that the bytecode knows how to evaluate
+#define COMPILED_ARITHMETIC(ARITH)                                      \
+    ARITH(add)                                                          \
+    ARITH(subtract)                                                     \
+    ARITH(multiply)                                                     \
+    ARITH(divide)                                                       \
+    ARITH(mod)                                                          \
+    ARITH(rem)                                                          \
+    ARITH(pow)                                                          \
+    ARITH(hypot)                                                        \
+    ARITH(atan2)
+
+#define COMPILED_FUNCTIONS(FN)                                          \
+    FN(neg)                                                             \
+    FN(inv)                                                             \
+    FN(sq)                                                              \
+    FN(cubed)                                                           \
+    FN(abs)                                                             \
+    FN(sqrt)                                                            \
+    FN(cbrt)                                                            \
+    FN(sin)                                                             \
+    FN(cos)                                                             \
+    FN(tan)                                                             \
+    FN(asin)                                                            \
+    FN(acos)                                                            \
+    FN(atan)                                                            \
+    FN(sinh)                                                            \
+    FN(cosh)                                                            \
+    FN(tanh)                                                            \
+    FN(asinh)                                                           \
+    FN(acosh)                                                           \
+    FN(log1p)                                                           \
+    FN(expm1)                                                           \
+    FN(log)                                                             \
+    FN(log10)                                                           \
+    FN(log2)                                                            \
+    FN(exp)                                                             \
+    FN(exp10)                                                           \
+    FN(exp2)                                                            \
+    FN(erf)                                                             \
+    FN(erfc)                                                            \
+    FN(tgamma)                                                          \
+    FN(lgamma)
+
+
+compiled::compiled(program_r eq)
+// ----------------------------------------------------------------------------
+//   Compile the equation if possible
+// ----------------------------------------------------------------------------
+    : eq(eq), mode(NONE), count(0), result(0), constants(MAX_REGISTERS)
+{
+    if (!compile(eq))
+    {
+        record(compile, "Could not compile %t", +eq);
+        mode = NONE;
+    }
+}
+
+
+algebraic_p compiled::evaluate(algebraic_r x)
+// ----------------------------------------------------------------------------
+//   Evaluate the compiled code, falling back to RPL evaluation if needed
+// ----------------------------------------------------------------------------
+{
+    if (mode != NONE)
+        if (algebraic_p y = run(x, nullptr))
+            return y;
+    return algebraic::evaluate_function(eq, x);
+}
+
+
+algebraic_p compiled::evaluate(algebraic_r x, algebraic_g &dydx)
+// ----------------------------------------------------------------------------
+//   Evaluate the function and its derivative if possible
+// ----------------------------------------------------------------------------
+//   When the derivative cannot be computed, dydx is set to null, and the
+//   function value is computed as for evaluate(x)
+{
+    dydx = nullptr;
+    if (mode != NONE)
+    {
+        double      d = 0;
+        algebraic_g y = run(x, &d);
+        if (y)
+        {
+            if (std::isfinite(d))
+            {
+                if (mode == FLOAT)
+                    dydx = hwfloat::make(float(d));
+                else if (mode == DOUBLE)
+                    dydx = hwdouble::make(d);
+                else
+                    dydx = decimal::from(d);
+                if (!dydx)
+                    rt.clear_error();
+            }
+            return y;
+        }
+    }
+    return algebraic::evaluate_function(eq, x);
+}
+
+
+bool compiled::compile(program_p prog)
+// ----------------------------------------------------------------------------
+//   Lower the program or expression into register bytecode
+// ----------------------------------------------------------------------------
+{
+    if (!prog)
+        return false;
+    if (prog->type() == object::ID_equation)
+    {
+        object_p value = equation_p(prog)->value();
+        if (!value || !value->is_program())
+            return false;
+        prog = program_p(value);
+    }
+    id ty = prog->type();
+    if (ty != object::ID_expression && ty != object::ID_program)
+        return false;
+
+    // Select the representation of registers from current settings
+    if (!Settings.NumericalResults())
+        return false;
+    uint prec = Settings.Precision();
+    if (Settings.HardwareFloatingPoint() && prec <= 16)
+        mode = prec <= 7 ? FLOAT : DOUBLE;
+    else
+        mode = OBJECTS;
+    bool angles = Settings.SetAngleUnits();
+
+    // Simulate the RPL stack with register numbers, input on the stack
+    constants = MAX_REGISTERS;
+    byte     stack[MAX_REGISTERS];
+    uint     depth     = 0;
+    symbol_p indep     = expression::independent
+                           ? symbol_p(*expression::independent)
+                           : nullptr;
+    stack[depth++] = 0;
+
+    for (object_p obj : *prog)
+    {
+        id oty = obj->type();
+        switch(oty)
+        {
+#define ARITH(name)             case object::ID_##name:
+            COMPILED_ARITHMETIC(ARITH)
+#undef ARITH
+        {
+            if (depth < 2 || count >= MAX_INSTRUCTIONS)
+                return false;
+            if (oty == object::ID_atan2 && angles)
+                return false;
+            instruction &i = code[count++];
+            i.op  = oty;
+            i.y   = stack[--depth];
+            i.x   = stack[--depth];
+            i.dst = depth + 1;
+            stack[depth++] = i.dst;
+            break;
+        }
+
+#define FN(name)                case object::ID_##name:
+            COMPILED_FUNCTIONS(FN)
+#undef FN
+        {
+            if (depth < 1 || count >= MAX_INSTRUCTIONS)
+                return false;
+            if (oty >= object::ID_asin && oty <= object::ID_atan && angles)
+                return false;
+            instruction &i = code[count++];
+            i.op  = oty;
+            i.x   = stack[--depth];
+            i.y   = 0;
+            i.dst = depth + 1;
+            stack[depth++] = i.dst;
+            break;
+        }
+
+        default:
+        {
+            // Leaves: independent variable, variables, constants and numbers
+            if (depth + 1 >= constants)
+                return false;
+            algebraic_g value;
+            if (oty == object::ID_symbol)
+            {
+                symbol_p sym = symbol_p(obj);
+                if (indep && sym->is_same_as(indep))
+                {
+                    stack[depth++] = 0;
+                    break;
+                }
+                object_p found = directory::recall_all(sym, false);
+                if (!found || !found->is_real())
+                    return false;
+                value = algebraic_p(found);
+            }
+            else if (oty == object::ID_constant)
+            {
+                value = algebraic_p(obj)->evaluate();
+                if (!value || !value->is_real())
+                {
+                    rt.clear_error();
+                    return false;
+                }
+            }
+            else if (obj->is_real())
+            {
+                value = algebraic_p(obj);
+            }
+            else
+            {
+                return false;
+            }
+
+            byte reg = --constants;
+            if (mode == OBJECTS)
+            {
+                objects[reg] = value;
+            }
+            else
+            {
+                if (!algebraic::hwfp_promotion(value))
+                    return false;
+                if (mode == FLOAT)
+                    values[reg] = hwfloat_p(+value)->value();
+                else
+                    values[reg] = hwdouble_p(+value)->value();
+            }
+            stack[depth++] = reg;
+            break;
+        }
+        }
+
+        // Stack levels must not overlap with constants
+        if (depth >= constants)
+            return false;
+    }
+
+    // Result must be as evaluate_function expects it
+    if (depth == 2 && stack[0] == 0)
+        result = stack[1];
+    else if (depth == 1)
+        result = stack[0];
+    else
+        return false;
+
+    record(compile, "Compiled %t into %u instructions, %u constants",
+           +prog, count, MAX_REGISTERS - constants);
+    return true;
+}
+
+
+static bool real_value(algebraic_p x, double &value)
+// ----------------------------------------------------------------------------
+//   Approximate a real number as a double, to compute derivatives
+// ----------------------------------------------------------------------------
+{
+    switch(x->type())
+    {
+    case object::ID_integer:
+        value = double(integer_p(x)->value<ularge>());
+        break;
+    case object::ID_neg_integer:
+        value = -double(integer_p(x)->value<ularge>());
+        break;
+    case object::ID_fraction:
+        value = double(fraction_p(x)->numerator_value())
+            / double(fraction_p(x)->denominator_value());
+        break;
+    case object::ID_neg_fraction:
+        value = -double(fraction_p(x)->numerator_value())
+            / double(fraction_p(x)->denominator_value());
+        break;
+    case object::ID_decimal:
+    case object::ID_neg_decimal:
+        value = decimal_p(x)->to_double();
+        break;
+    case object::ID_hwfloat:
+        value = hwfloat_p(x)->value();
+        break;
+    case object::ID_hwdouble:
+        value = hwdouble_p(x)->value();
+        break;
+    default:
+    {
+        algebraic_g dec = x;
+        if (!algebraic::to_decimal(dec) || !dec->is_decimal())
+        {
+            rt.clear_error();
+            return false;
+        }
+        value = decimal_p(+dec)->to_double();
+        break;
+    }
+    }
+    return std::isfinite(value);
+}
+
+
+algebraic_p compiled::run(algebraic_r x, double *dydx)
+// ----------------------------------------------------------------------------
+//   Run the compiled code, return nullptr if we need to use RPL instead
+// ----------------------------------------------------------------------------
+{
+    if (!x || !x->is_real())
+        return nullptr;
+
+    if (mode == OBJECTS)
+    {
+        // Tangents need approximate values of the registers
+        bool diff = dydx && real_value(x, values[0]);
+        if (diff)
+        {
+            tangents[0] = 1;
+            for (uint reg = constants; diff && reg < MAX_REGISTERS; reg++)
+            {
+                tangents[reg] = 0;
+                diff = real_value(objects[reg], values[reg]);
+            }
+        }
+
+        objects[0] = x;
+        for (uint pc = 0; pc < count; pc++)
+        {
+            const instruction &i = code[pc];
+            algebraic_r        a = objects[i.x];
+            algebraic_r        b = objects[i.y];
+            algebraic_p        r = nullptr;
+            switch(i.op)
+            {
+#define ARITH(name)                                                     \
+            case object::ID_##name:     r = name::evaluate(a, b); break;
+                COMPILED_ARITHMETIC(ARITH)
+#undef ARITH
+#define FN(name)                                                        \
+            case object::ID_##name:     r = name::evaluate(a); break;
+                COMPILED_FUNCTIONS(FN)
+#undef FN
+            default:
+                break;
+            }
+            if (!r || !r->is_real())
+                return nullptr;
+            objects[i.dst] = r;
+            if (diff)
+            {
+                double value = 0;
+                diff = real_value(r, value) && tangent(i, value);
+                values[i.dst] = value;
+            }
+        }
+        algebraic_p y = objects[result];
+        objects[0] = nullptr;
+        if (dydx)
+            *dydx = diff ? tangents[result] : NAN;
+        return y;
+    }
+
+    algebraic_g input = x;
+    if (!algebraic::hwfp_promotion(input))
+        return nullptr;
+    if (mode == FLOAT)
+    {
+        hwfloat_p fx = input->as<hwfloat>();
+        float     fy = 0;
+        if (fx && run<float>(fx->value(), fy, dydx))
+            return hwfloat::make(fy);
+    }
+    else
+    {
+        hwdouble_p dx = input->as<hwdouble>();
+        double     dy = 0;
+        if (dx && run<double>(dx->value(), dy, dydx))
+            return hwdouble::make(dy);
+    }
+    return nullptr;
+}
+
+
+template <typename hw>
+bool compiled::run(hw x, hw &y, double *dydx)
+// ----------------------------------------------------------------------------
+//   The interpreter loop for hardware floating-point
+// ----------------------------------------------------------------------------
+//   This computes the same values as the hwfp operations, but leaves it to
+//   RPL evaluation to report errors or deal with non-finite values
+{
+    typedef hwfp<hw> fp;
+
+    bool diff = dydx;
+    if (diff)
+    {
+        tangents[0] = 1;
+        for (uint reg = constants; reg < MAX_REGISTERS; reg++)
+            tangents[reg] = 0;
+    }
+
+    values[0] = x;
+    for (uint pc = 0; pc < count; pc++)
+    {
+        const instruction &i = code[pc];
+        hw a = values[i.x];
+        hw b = values[i.y];
+        hw r;
+        switch(i.op)
+        {
+        case object::ID_add:            r = a + b; break;
+        case object::ID_subtract:       r = a - b; break;
+        case object::ID_multiply:       r = a * b; break;
+        case object::ID_divide:
+            if (b == 0)
+                return false;
+            r = a / b;
+            break;
+        case object::ID_mod:
+            if (b == 0)
+                return false;
+            r = std::fmod(a, b);
+            if (r < 0)
+                r = b < 0 ? r - b : r + b;
+            break;
+        case object::ID_rem:
+            if (b == 0)
+                return false;
+            r = std::fmod(a, b);
+            break;
+        case object::ID_pow:
+            if (a == 0 && b == 0)
+                return false;
+            r = std::pow(a, b);
+            break;
+        case object::ID_hypot:          r = std::hypot(a, b); break;
+        case object::ID_atan2:          r = fp::to_angle(std::atan2(a, b)); break;
+
+        case object::ID_neg:            r = -a; break;
+        case object::ID_inv:
+            if (a == 0)
+                return false;
+            r = 1.0 / a;
+            break;
+        case object::ID_sq:             r = a * a; break;
+        case object::ID_cubed:          r = a * a * a; break;
+        case object::ID_abs:            r = std::abs(a); break;
+        case object::ID_sqrt:           r = std::sqrt(a); break;
+        case object::ID_cbrt:           r = std::cbrt(a); break;
+        case object::ID_sin:            r = std::sin(fp::from_angle(a)); break;
+        case object::ID_cos:            r = std::cos(fp::from_angle(a)); break;
+        case object::ID_tan:            r = std::tan(fp::from_angle(a)); break;
+        case object::ID_asin:           r = fp::to_angle(std::asin(a)); break;
+        case object::ID_acos:           r = fp::to_angle(std::acos(a)); break;
+        case object::ID_atan:           r = fp::to_angle(std::atan(a)); break;
+        case object::ID_sinh:           r = std::sinh(a); break;
+        case object::ID_cosh:           r = std::cosh(a); break;
+        case object::ID_tanh:           r = std::tanh(a); break;
+        case object::ID_asinh:          r = std::asinh(a); break;
+        case object::ID_acosh:          r = std::acosh(a); break;
+        case object::ID_log1p:          r = std::log1p(a); break;
+        case object::ID_expm1:          r = std::expm1(a); break;
+        case object::ID_log:            r = std::log(a); break;
+        case object::ID_log10:          r = std::log10(a); break;
+        case object::ID_log2:           r = std::log2(a); break;
+        case object::ID_exp:            r = std::exp(a); break;
+        case object::ID_exp10:          r = std::exp(a * hw(M_LN10)); break;
+        case object::ID_exp2:           r = std::exp2(a); break;
+        case object::ID_erf:            r = std::erf(a); break;
+        case object::ID_erfc:           r = std::erfc(a); break;
+        case object::ID_tgamma:         r = std::tgamma(a); break;
+        case object::ID_lgamma:         r = std::lgamma(a); break;
+        default:                return false;
+        }
+        if (!std::isfinite(r))
+            return false;
+        if (diff)
+            diff = tangent(i, r);
+        values[i.dst] = r;
+    }
+    y = values[result];
+    if (dydx)
+        *dydx = diff ? tangents[result] : NAN;
+    return true;
+}
+
+
+bool compiled::tangent(const instruction &i, double r)
+// ----------------------------------------------------------------------------
+//   Compute the tangent of the destination register of an instruction
+// ----------------------------------------------------------------------------
+//   This uses `values` for the arguments, and `r` for the result, so it must
+//   be called before the result is stored, since the destination register
+//   may also be an argument. It returns false if the operation has no
+//   derivative that we know how to compute.
+{
+    typedef hwfp<double> fp;
+
+    double a  = values[i.x];
+    double b  = values[i.y];
+    double ta = tangents[i.x];
+    double tb = tangents[i.y];
+    double t  = 0;
+
+    // Unary operations ignore the second argument, which is register 0
+    switch(i.op)
+    {
+#define FN(name)                case object::ID_##name:
+        COMPILED_FUNCTIONS(FN)
+#undef FN
+        tb = 0;
+        break;
+    default:
+        break;
+    }
+
+    // Constant sub-expressions, e.g. abs(0) when it does not depend on x
+    if (ta == 0 && tb == 0)
+    {
+        tangents[i.dst] = 0;
+        return true;
+    }
+
+    switch(i.op)
+    {
+    case object::ID_add:        t = ta + tb; break;
+    case object::ID_subtract:   t = ta - tb; break;
+    case object::ID_multiply:   t = ta * b + a * tb; break;
+    case object::ID_divide:     t = (ta - r * tb) / b; break;
+    case object::ID_mod:
+    case object::ID_rem:        t = ta - tb * ((a - r) / b); break;
+    case object::ID_pow:
+        if (tb == 0)
+            t = b * std::pow(a, b - 1) * ta;
+        else if (a > 0)
+            t = r * (tb * std::log(a) + b * ta / a);
+        else
+            return false;
+        break;
+    case object::ID_hypot:
+        if (r == 0)
+            return false;
+        t = (a * ta + b * tb) / r;
+        break;
+    case object::ID_atan2:
+        t = fp::to_angle(b * ta - a * tb) / (a * a + b * b);
+        break;
+
+    case object::ID_neg:        t = -ta; break;
+    case object::ID_inv:        t = -ta * r * r; break;
+    case object::ID_sq:         t = 2 * a * ta; break;
+    case object::ID_cubed:      t = 3 * a * a * ta; break;
+    case object::ID_abs:
+        if (a == 0)
+            return false;
+        t = a < 0 ? -ta : ta;
+        break;
+    case object::ID_sqrt:
+        if (r == 0)
+            return false;
+        t = ta / (2 * r);
+        break;
+    case object::ID_cbrt:
+        if (r == 0)
+            return false;
+        t = ta / (3 * r * r);
+        break;
+    case object::ID_sin:
+        t = std::cos(fp::from_angle(a)) * fp::from_angle(ta);
+        break;
+    case object::ID_cos:
+        t = -std::sin(fp::from_angle(a)) * fp::from_angle(ta);
+        break;
+    case object::ID_tan:        t = (1 + r * r) * fp::from_angle(ta); break;
+    case object::ID_asin:
+        if (a * a >= 1)
+            return false;
+        t = fp::to_angle(ta / std::sqrt(1 - a * a));
+        break;
+    case object::ID_acos:
+        if (a * a >= 1)
+            return false;
+        t = -fp::to_angle(ta / std::sqrt(1 - a * a));
+        break;
+    case object::ID_atan:       t = fp::to_angle(ta / (1 + a * a)); break;
+    case object::ID_sinh:       t = std::cosh(a) * ta; break;
+    case object::ID_cosh:       t = std::sinh(a) * ta; break;
+    case object::ID_tanh:       t = (1 - r * r) * ta; break;
+    case object::ID_asinh:      t = ta / std::sqrt(a * a + 1); break;
+    case object::ID_acosh:
+        if (a <= 1)
+            return false;
+        t = ta / std::sqrt(a * a - 1);
+        break;
+    case object::ID_log1p:      t = ta / (1 + a); break;
+    case object::ID_expm1:      t = (r + 1) * ta; break;
+    case object::ID_log:        t = ta / a; break;
+    case object::ID_log10:      t = ta / (a * M_LN10); break;
+    case object::ID_log2:       t = ta / (a * M_LN2); break;
+    case object::ID_exp:        t = r * ta; break;
+    case object::ID_exp10:      t = r * M_LN10 * ta; break;
+    case object::ID_exp2:       t = r * M_LN2 * ta; break;
+    case object::ID_erf:        t = M_2_SQRTPI * std::exp(-a * a) * ta; break;
+    case object::ID_erfc:       t = -M_2_SQRTPI * std::exp(-a * a) * ta; break;
+    default:                    return false;
+    }
+    if (!std::isfinite(t))
+        return false;
+    tangents[i.dst] = t;
+    return true;
+}
@@ -0,0 +1,97 @@
+#ifndef COMPILE_H
+#define COMPILE_H
+// ****************************************************************************
+//  compile.h                                                    DB48X project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Compile numerical functions into a compact register bytecode
+//
+//     Plotting, solving and integrating evaluate the same function for
+//     many values of the independent variable. When the function is purely
+//     numerical, it is lowered once into a register bytecode that a tight
+//     interpreter loop runs for each sample, without going through the
+//     RPL evaluator, looking up symbols or allocating intermediate results.
+//
+//
+//
+// ****************************************************************************
+//   (C) 2024 Christophe de Dinechin <christophe@dinechin.org>
+//   This software is licensed under the terms outlined in LICENSE.txt
+// ****************************************************************************
+//   This file is part of DB48X.
+//
+//   DB48X is free software: you can redistribute it and/or modify
+//   it under the terms outlined in the LICENSE.txt file
+//
+//   DB48X is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// ****************************************************************************
+
+#include "algebraic.h"
+#include "program.h"
+
+
+struct compiled
+// ----------------------------------------------------------------------------
+//   A numerical function compiled to register bytecode
+// ----------------------------------------------------------------------------
+//   The function can be an expression using the independent variable, or a
+//   program taking its input from the stack, like algebraic::evaluate_function
+//   accepts. Only numbers, variables containing real numbers, the independent
+//   variable, arithmetic and the usual math functions can be compiled.
+//
+//   With hardware floating-point enabled, registers are native `double` or
+//   `float` values, depending on the precision. Otherwise, registers hold
+//   objects, and each instruction calls the same C++ code as the RPL command.
+//
+//   Any case the bytecode does not handle, e.g. a division by zero or
+//   a non-finite result, falls back to algebraic::evaluate_function for that
+//   sample, so that errors and special results are reported the same way.
+//
+//   The derivative with respect to the independent variable can be computed
+//   along with the value, using forward-mode differentiation: each register
+//   carries a tangent, which each instruction updates using the derivative
+//   of its operation. Tangents are `double` values in all modes, since they
+//   only steer iterations like Newton's method, and never end up in results.
+{
+    compiled(program_r eq);
+
+    algebraic_p evaluate(algebraic_r x);
+    algebraic_p evaluate(algebraic_r x, algebraic_g &dydx);
+    bool        valid() const   { return mode != NONE; }
+
+private:
+    typedef object::id id;
+    enum { MAX_REGISTERS = 24, MAX_INSTRUCTIONS = 48 };
+    enum mode_t { NONE, FLOAT, DOUBLE, OBJECTS };
+
+    struct instruction
+    {
+        uint16_t        op;             // Object ID of the operation
+        byte            dst;            // Destination register
+        byte            x;              // First argument register
+        byte            y;              // Second argument register (binary)
+    };
+
+    bool        compile(program_p eq);
+    algebraic_p run(algebraic_r x, double *dydx);
+    template <typename hw>
+    bool        run(hw x, hw &result, double *dydx);
+    bool        tangent(const instruction &i, double r);
+
+private:
+    program_g   eq;                     // Original equation, for fallback
+    mode_t      mode;                   // How we evaluate
+    uint        count;                  // Number of instructions
+    byte        result;                 // Register holding the result
+    byte        constants;              // First register holding a constant
+    instruction code[MAX_INSTRUCTIONS]; // Instructions
+    double      values[MAX_REGISTERS];  // Native registers
+    double      tangents[MAX_REGISTERS];// Derivatives of registers
+    algebraic_g objects[MAX_REGISTERS]; // Object registers
+};
+
+#endif // COMPILE_H
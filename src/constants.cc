@@ -37,6 +37,7 @@
 #include "files.h"
 #include "functions.h"
 #include "grob.h"
+#include "hash.h"
 #include "parser.h"
 #include "renderer.h"
 #include "settings.h"
@@ -825,6 +826,240 @@ const constant::config constant::constants =
 };
 
 
+// ============================================================================
+//
+//   Index of constant names
+//
+// ============================================================================
+//   Parsing a constant, or finding its name or value, used to scan the CSV
+//   file and the built-in table every time. The index records, for each
+//   constant index, the hash of its name and where it is defined, i.e. the
+//   position of its row in the file or its position in the built-in table,
+//   along with a hash table from names to constant indexes.
+//   The index is shared by configurations using the same file and builtins,
+//   e.g. constants and their uncertainties. It is built the first time it is
+//   needed, and rebuilt if the size or modification time of the file change.
+
+struct constant_index
+// ----------------------------------------------------------------------------
+//   Index of the names for a given file and built-in table
+// ----------------------------------------------------------------------------
+{
+    typedef constant::config_r   config_r;
+    typedef constant::builtins_p builtins_p;
+    enum { MAX_INDEXES = 4, MAX_ENTRIES = 0xFFFF };
+
+    struct entry
+    {
+        uint32_t        hash;           // Hash of the constant name
+        uint32_t        where;          // Row position or builtins position
+    };
+
+    cstring             file;           // CSV file the index was built for
+    builtins_p          builtins;       // Builtins the index was built for
+    uint                size;           // Size of the file when built
+    uint                modified;       // Modification time when built
+    uint                count;          // Number of entries
+    uint                files;          // Number of entries from the file
+    uint                mask;           // Hash table size minus one
+    entry *             entries;        // Entries by constant index
+    uint16_t *          table;          // Hash table of constant index + 1
+
+    static constant_index *indexes[MAX_INDEXES];
+};
+
+constant_index *constant_index::indexes[MAX_INDEXES] = { nullptr };
+
+
+static bool constant_index_add(constant_index *ndx, utf8 txt, size_t len,
+                               uint where, uint &capacity)
+// ----------------------------------------------------------------------------
+//   Add an entry to the index, growing it as necessary
+// ----------------------------------------------------------------------------
+{
+    if (ndx->count >= capacity)
+    {
+        if (capacity >= constant_index::MAX_ENTRIES)
+            return false;
+        uint ncap = capacity * 2;
+        if (ncap > constant_index::MAX_ENTRIES)
+            ncap = constant_index::MAX_ENTRIES;
+        size_t sz = ncap * sizeof(constant_index::entry);
+        void  *ne = realloc(ndx->entries, sz);
+        if (!ne)
+            return false;
+        ndx->entries = (constant_index::entry *) ne;
+        capacity = ncap;
+    }
+    constant_index::entry &e = ndx->entries[ndx->count++];
+    e.hash = fnv1a(txt, len);
+    e.where = where;
+    return true;
+}
+
+
+static bool constant_index_build(constant_index *ndx,
+                                 constant::config_r cfg, unit_file &cfile)
+// ----------------------------------------------------------------------------
+//   Build the index for the given configuration
+// ----------------------------------------------------------------------------
+{
+    uint   capacity = 32 + cfg.nbuiltins / 2;
+    size_t clen     = 0;
+
+    free(ndx->table);
+    ndx->table = nullptr;
+    ndx->entries = (constant_index::entry *)
+        realloc(ndx->entries, capacity * sizeof(constant_index::entry));
+    if (!ndx->entries)
+        return false;
+
+    ndx->file     = cfg.file;
+    ndx->builtins = cfg.builtins;
+    ndx->size     = cfile.valid() ? cfile.size() : 0;
+    ndx->modified = cfile.valid() ? cfile.modified() : 0;
+    ndx->count    = 0;
+
+    // Same walk as in the file scans below, recording row positions
+    if (cfile.valid())
+    {
+        cfile.seek(0);
+        while (symbol_g category = cfile.next(true))
+        {
+            uint position = cfile.position();
+            while (symbol_p sym = cfile.next(false))
+            {
+                utf8 ctxt = sym->value(&clen);
+                if (!constant_index_add(ndx, ctxt, clen, position, capacity))
+                    return false;
+                position = cfile.position();
+            }
+        }
+
+        // Running out of memory while reading the file stops the walk early
+        if (cfile.position() < ndx->size)
+            return false;
+    }
+    ndx->files = ndx->count;
+
+    constant::builtins_p builtins = cfg.builtins;
+    for (size_t b = 0; b < cfg.nbuiltins; b += 2)
+    {
+        if (builtins[b+1] && *builtins[b+1])
+        {
+            cstring ctxt = builtins[b];
+            if (!constant_index_add(ndx, utf8(ctxt), strlen(ctxt), b, capacity))
+                return false;
+        }
+    }
+
+    // Hash table at most half full, filled in index order so that
+    // the first definition of a name is found first, like with a scan
+    uint buckets = 16;
+    while (buckets < 2 * ndx->count)
+        buckets *= 2;
+    ndx->mask = buckets - 1;
+    ndx->table = (uint16_t *) calloc(buckets, sizeof(uint16_t));
+    if (!ndx->table)
+        return false;
+    for (uint i = 0; i < ndx->count; i++)
+    {
+        uint b = ndx->entries[i].hash & ndx->mask;
+        while (ndx->table[b])
+            b = (b + 1) & ndx->mask;
+        ndx->table[b] = i + 1;
+    }
+
+    record(constants, "Indexed %u constants in %s, %u from file",
+           ndx->count, cfg.file, ndx->files);
+    return true;
+}
+
+
+static constant_index *constant_index_get(constant::config_r cfg,
+                                          unit_file &cfile)
+// ----------------------------------------------------------------------------
+//   Return an up-to-date index for the configuration, nullptr if none
+// ----------------------------------------------------------------------------
+//   When the index cannot be built, e.g. for lack of memory, callers
+//   fall back to scanning the file and builtins
+{
+    constant_index **indexes = constant_index::indexes;
+    constant_index  *ndx     = nullptr;
+    uint             size    = cfile.valid() ? cfile.size() : 0;
+    uint             mtime   = cfile.valid() ? cfile.modified() : 0;
+
+    for (uint i = 0; i < constant_index::MAX_INDEXES; i++)
+    {
+        ndx = indexes[i];
+        if (!ndx)
+        {
+            // operator new support purposefully not linked in embedded versions
+            ndx = (constant_index *) calloc(1, sizeof(constant_index));
+            if (!ndx)
+                return nullptr;
+            indexes[i] = ndx;
+            break;
+        }
+        if (ndx->file == cfg.file && ndx->builtins == cfg.builtins)
+        {
+            if (ndx->table && ndx->size == size && ndx->modified == mtime)
+                return ndx;
+            break;
+        }
+        ndx = nullptr;
+    }
+
+    if (ndx && !constant_index_build(ndx, cfg, cfile))
+    {
+        free(ndx->table);
+        free(ndx->entries);
+        ndx->table = nullptr;
+        ndx->entries = nullptr;
+        ndx = nullptr;
+    }
+    return ndx;
+}
+
+
+static uint constant_index_find(constant_index *ndx, constant::config_r cfg,
+                                unit_file &cfile, utf8 txt, size_t len)
+// ----------------------------------------------------------------------------
+//   Find the index for a given name, or ndx->count if not found
+// ----------------------------------------------------------------------------
+{
+    uint32_t hash = fnv1a(txt, len);
+    size_t   clen = 0;
+    for (uint b = hash & ndx->mask; uint slot = ndx->table[b];
+         b = (b + 1) & ndx->mask)
+    {
+        uint                   idx = slot - 1;
+        constant_index::entry &e   = ndx->entries[idx];
+        if (e.hash != hash)
+            continue;
+
+        // Constant name comparison is case-sensitive
+        if (idx < ndx->files)
+        {
+            cfile.seek(e.where);
+            if (symbol_p sym = cfile.next(false))
+            {
+                utf8 ctxt = sym->value(&clen);
+                if (len == clen && memcmp(txt, ctxt, len) == 0)
+                    return idx;
+            }
+        }
+        else
+        {
+            cstring ctxt = cfg.builtins[e.where];
+            if (strlen(ctxt) == len && memcmp(ctxt, txt, len) == 0)
+                return idx;
+        }
+    }
+    return ndx->count;
+}
+
+
 object::result constant::do_parsing(config_r cfg, parser &p)
 // ----------------------------------------------------------------------------
 //    Try to parse this as a constant
@@ -886,8 +1121,17 @@ constant_p constant::do_lookup(config_r cfg, utf8 txt, size_t len, bool error)
     size_t    clen     = 0;
     uint      idx      = 0;
 
+    // Check the index
+    if (constant_index *ndx = constant_index_get(cfg, cfile))
+    {
+        idx = constant_index_find(ndx, cfg, cfile, txt, len);
+        if (idx < ndx->count)
+            return constant::make(cfg.type, idx);
+        maxb = 0;
+    }
+
     // Check in-file constants
-    if (cfile.valid())
+    else if (cfile.valid())
     {
         cfile.seek(0);
         while (symbol_g category = cfile.next(true))
@@ -933,6 +1177,25 @@ utf8 constant::do_name(config_r cfg, size_t *len) const
     cstring   ctxt     = nullptr;
     uint      idx      = index();
 
+    // Check the index
+    if (constant_index *ndx = constant_index_get(cfg, cfile))
+    {
+        if (idx >= ndx->count)
+            return nullptr;
+        uint where = ndx->entries[idx].where;
+        if (idx < ndx->files)
+        {
+            cfile.seek(where);
+            if (symbol_p sym = cfile.next(false))
+                return sym->value(len);
+            return nullptr;
+        }
+        ctxt = builtins[where];
+        if (len)
+            *len = strlen(ctxt);
+        return utf8(ctxt);
+    }
+
     // Check in-file constants
     if (cfile.valid())
     {
@@ -980,8 +1243,32 @@ object_p constant::do_value(config_r cfg) const
     size_t    clen     = 0;
     uint      idx      = index();
 
+    // Check the index
+    if (constant_index *ndx = constant_index_get(cfg, cfile))
+    {
+        if (idx < ndx->files)
+        {
+            uint position = ndx->entries[idx].where;
+            cfile.seek(position);
+            if (symbol_p sym = cfile.next(false))
+            {
+                cname = sym;
+                utf8 ctxt = sym->value(&clen);
+                cfile.seek(position);
+                csym = cfile.lookup(ctxt, clen, false, false);
+            }
+        }
+        else if (idx < ndx->count)
+        {
+            uint b = ndx->entries[idx].where;
+            cname = symbol::make(builtins[b]);
+            csym = symbol::make(builtins[b+1]);
+        }
+        maxb = 0;
+    }
+
     // Check in-file constants
-    if (cfile.valid())
+    else if (cfile.valid())
     {
         cfile.seek(0);
         while (symbol_g category = cfile.next(true))
@@ -1468,6 +1468,12 @@ int decimal::compare(decimal_r x, decimal_r y, uint epsilon)
     info xi   = x->shape();
     info yi   = y->shape();
 
+    // The exponent of zero is meaningless, e.g. 0 < 0.01
+    bool xz = x->is_zero();
+    bool yz = y->is_zero();
+    if (xz || yz)
+        return xz == yz ? 0 : sign * (xz ? -1 : 1);
+
     // Number with largest exponent is larger
     large xe   = xi.exponent;
     large ye   = yi.exponent;
@@ -1564,155 +1570,588 @@ arithmetic_fn target(algebraic_r x, algebraic_r y)
 }
 
 
-decimal_p decimal::add(decimal_r x, decimal_r y)
+// ============================================================================
+//
+//   Kigit arithmetic
+//
+// ============================================================================
+//   Products of long mantissas are computed as polynomial products of the
+//   kigits, without carries, using 64-bit coefficients. The coefficients of
+//   the final product fit in 32 bits for all supported precisions, and
+//   intermediate values in Karatsuba and Toom-3 evaluation stay well within
+//   64 bits. Carries are only propagated once, when the result is stored.
+//
+//   Convolution does not depend on the order of kigits, so the same code
+//   works for the most-significant-first order of decimal mantissas and
+//   the least-significant-first order used for Newton division below.
+
+using kint = decimal::kint;
+using kacc = int64_t;
+
+static const size_t KARATSUBA_KIGITS = 32;
+static const size_t TOOM3_KIGITS     = 192;
+static const size_t NEWTON_KIGITS    = 64;
+
+size_t decimal::newton_kigits = NEWTON_KIGITS;
+
+
+static void kigits_mul_basecase(kacc *r,
+                                const kacc *a, size_t na,
+                                const kacc *b, size_t nb)
 // ----------------------------------------------------------------------------
-//   Addition of two numbers with the same sign
+//   Schoolbook polynomial product, r[0..na+nb-1) = a * b
 // ----------------------------------------------------------------------------
 {
-    if (!x || !y)
-        return nullptr;
-    id xty = x->type();
-    id yty = y->type();
-    if (xty != yty)
-        return subtract(x, decimal_g(neg(y)));
-    add::remember(target<add>);
+    for (size_t i = 0; i + 1 < na + nb; i++)
+        r[i] = 0;
+    for (size_t i = 0; i < na; i++)
+        if (kacc ai = a[i])
+            for (size_t j = 0; j < nb; j++)
+                r[i + j] += ai * b[j];
+}
 
-    // Read information from both numbers
-    info  xi = x->shape();
-    info  yi = y->shape();
-    large xe = xi.exponent;
-    large ye = yi.exponent;
-    id    ty = x->type();
 
-    // Put the smallest exponent in y
-    bool lt = xe < ye;
-    if (lt)
+static size_t kigits_mul_space(size_t na, size_t nb);
+static void   kigits_mul(kacc *r, const kacc *a, size_t na,
+                         const kacc *b, size_t nb, kacc *ws);
+
+
+static size_t kigits_balanced_space(size_t n)
+// ----------------------------------------------------------------------------
+//   Workspace for a balanced n x n product
+// ----------------------------------------------------------------------------
+{
+    if (n < KARATSUBA_KIGITS)
+        return 0;
+    if (n < TOOM3_KIGITS)
     {
-        std::swap(xe, ye);
-        std::swap(xi, yi);
+        size_t h = (n + 1) / 2;
+        return 2 * h + (2 * h - 1) + kigits_balanced_space(h);
     }
+    size_t k = (n + 2) / 3;
+    return 6 * k + 3 * (2 * k - 1) + kigits_balanced_space(k);
+}
 
-    // Check dimensions
-    size_t   xs     = xi.nkigits;
-    size_t   ys     = yi.nkigits;
-    gcbytes  xb     = xi.base;
-    gcbytes  yb     = yi.base;
-    size_t   yshift = xe - ye;
-    size_t   kshift = yshift / 3;
-    kint     mod3   = yshift % 3;
 
-    // Size of result - y can be wider than x
-    size_t   ps     = (Settings.Precision() + 2) / 3;
-    size_t   rs     = std::min(ps, std::max(xs, ys + (yshift + 2) / 3));
+static void kigits_balanced(kacc *r, const kacc *a, const kacc *b, size_t n,
+                            kacc *ws)
+// ----------------------------------------------------------------------------
+//   Balanced n x n polynomial product, r[0..2n-1) = a * b
+// ----------------------------------------------------------------------------
+{
+    if (n < KARATSUBA_KIGITS)
+    {
+        kigits_mul_basecase(r, a, n, b, n);
+        return;
+    }
 
-    // Check if y is negligible relative to x
-    if (rs < kshift)
-        return lt ? y : x;
+    if (n < TOOM3_KIGITS)
+    {
+        // Karatsuba: a = a0 + a1 x^h, b = b0 + b1 x^h
+        size_t h  = (n + 1) / 2;
+        size_t l  = n - h;
+        kacc  *s  = ws;
+        kacc  *t  = s + h;
+        kacc  *z1 = t + h;
+        kigits_balanced(r, a, b, h, ws);                        // a0.b0
+        kigits_balanced(r + 2 * h, a + h, b + h, l, ws);        // a1.b1
+        r[2 * h - 1] = 0;
+        for (size_t i = 0; i < h; i++)
+        {
+            s[i] = a[i] + (i < l ? a[h + i] : 0);
+            t[i] = b[i] + (i < l ? b[h + i] : 0);
+        }
+        kigits_balanced(z1, s, t, h, z1 + 2 * h - 1);
+        for (size_t i = 0; i < 2 * h - 1; i++)
+            z1[i] -= r[i] + (i < 2 * l - 1 ? r[2 * h + i] : 0);
+        for (size_t i = 0; i < 2 * h - 1; i++)
+            r[h + i] += z1[i];
+        return;
+    }
 
-    // Allocate the mantissa
-    scribble scr;
-    kint    *rb = (kint *) rt.allocate(rs * sizeof(kint));
-    if (!rb)
-        return nullptr;
+    // Toom-3: a = a0 + a1 x^k + a2 x^2k, evaluated at 0, 1, -1, -2, infinity
+    size_t k   = (n + 2) / 3;
+    size_t l   = n - 2 * k;
+    size_t pn  = 2 * k - 1;
+    kacc  *a1  = ws;
+    kacc  *am1 = a1  + k;
+    kacc  *am2 = am1 + k;
+    kacc  *b1  = am2 + k;
+    kacc  *bm1 = b1  + k;
+    kacc  *bm2 = bm1 + k;
+    kacc  *r1  = bm2 + k;
+    kacc  *rm1 = r1  + pn;
+    kacc  *rm2 = rm1 + pn;
+    kacc  *rws = rm2 + pn;
+
+    const kacc *a0 = a,     *b0 = b;
+    const kacc *ak = a + k, *bk = b + k;
+    const kacc *a2 = a + 2 * k, *b2 = b + 2 * k;
+    for (size_t i = 0; i < k; i++)
+    {
+        kacc p = a0[i] + (i < l ? a2[i] : 0);
+        a1[i]  = p + ak[i];
+        am1[i] = p - ak[i];
+        am2[i] = 2 * (am1[i] + (i < l ? a2[i] : 0)) - a0[i];
+        kacc q = b0[i] + (i < l ? b2[i] : 0);
+        b1[i]  = q + bk[i];
+        bm1[i] = q - bk[i];
+        bm2[i] = 2 * (bm1[i] + (i < l ? b2[i] : 0)) - b0[i];
+    }
 
-    // Addition loop
-    kint   hmul  = mod3 == 2 ? 100 : mod3 == 1 ? 10 : 1;
-    kint   lmul  = 1000 / hmul;
-    kint   carry = 0;
-    size_t ko    = rs;
-    while (ko-- > 0)
+    kacc *r0   = r;
+    kacc *rinf = r + 4 * k;
+    size_t ln  = l ? 2 * l - 1 : 0;
+    kigits_balanced(r0, a0, b0, k, rws);
+    if (l)
+        kigits_balanced(rinf, a2, b2, l, rws);
+    kigits_balanced(r1,  a1,  b1,  k, rws);
+    kigits_balanced(rm1, am1, bm1, k, rws);
+    kigits_balanced(rm2, am2, bm2, k, rws);
+
+    // Interpolation (Bodrato's sequence)
+    for (size_t i = 0; i < pn; i++)
     {
-        kint xk = ko < xs ? kigit(+xb, ko) : 0;
-        kint yk = carry;
-        if (ko >= kshift)
+        kacc vinf = i < ln ? rinf[i] : 0;
+        kacc v3 = (rm2[i] - r1[i]) / 3;
+        kacc v1 = (r1[i] - rm1[i]) / 2;
+        kacc v2 = rm1[i] - r0[i];
+        v3 = (v2 - v3) / 2 + 2 * vinf;
+        v2 = v2 + v1 - vinf;
+        v1 = v1 - v3;
+        r1[i]  = v1;
+        rm1[i] = v2;
+        rm2[i] = v3;
+    }
+
+    // Recompose
+    size_t rn = 2 * n - 1;
+    for (size_t i = pn; i < 4 * k && i < rn; i++)
+        r[i] = 0;
+    for (size_t i = 0; i < pn; i++)
+    {
+        if (k + i < rn)
+            r[k + i] += r1[i];
+        if (2 * k + i < rn)
+            r[2 * k + i] += rm1[i];
+        if (3 * k + i < rn)
+            r[3 * k + i] += rm2[i];
+    }
+}
+
+
+static size_t kigits_mul_space(size_t na, size_t nb)
+// ----------------------------------------------------------------------------
+//   Workspace needed by kigits_mul
+// ----------------------------------------------------------------------------
+{
+    if (na < nb)
+        std::swap(na, nb);
+    if (nb < KARATSUBA_KIGITS)
+        return 0;
+    if (na == nb)
+        return kigits_balanced_space(nb);
+    size_t full = kigits_balanced_space(nb);
+    size_t last = na % nb ? kigits_mul_space(nb, na % nb) : 0;
+    return 2 * nb - 1 + std::max(full, last);
+}
+
+
+static void kigits_mul(kacc *r, const kacc *a, size_t na,
+                       const kacc *b, size_t nb, kacc *ws)
+// ----------------------------------------------------------------------------
+//   Polynomial product, r[0..na+nb-1) = a * b
+// ----------------------------------------------------------------------------
+//   Unbalanced operands are split in chunks the size of the shorter one
+{
+    if (na < nb)
+    {
+        std::swap(a, b);
+        std::swap(na, nb);
+    }
+    if (nb < KARATSUBA_KIGITS)
+    {
+        kigits_mul_basecase(r, a, na, b, nb);
+        return;
+    }
+    if (na == nb)
+    {
+        kigits_balanced(r, a, b, nb, ws);
+        return;
+    }
+
+    for (size_t i = 0; i + 1 < na + nb; i++)
+        r[i] = 0;
+    kacc *t = ws;
+    ws += 2 * nb - 1;
+    for (size_t i = 0; i < na; i += nb)
+    {
+        size_t c = std::min(nb, na - i);
+        kigits_mul(t, a + i, c, b, nb, ws);
+        for (size_t j = 0; j + 1 < c + nb; j++)
+            r[i + j] += t[j];
+    }
+}
+
+
+static uint kigits_product(kint *rb, size_t rs,
+                           const kint *xp, size_t xs,
+                           const kint *yp, size_t ys)
+// ----------------------------------------------------------------------------
+//   Compute the rs leading kigits of a product, return carry above them
+// ----------------------------------------------------------------------------
+//   Only partial products x[i]*y[j] with i+j < rs are taken into account,
+//   which is what the original ripple-carry loop computed.
+//   Short products use column-wise schoolbook with a single carry pass.
+//   Longer ones use Karatsuba or Toom-3 if there is enough free memory,
+//   which is checked first so that the allocation does not cause a GC.
+{
+    xs = std::min(xs, rs);
+    ys = std::min(ys, rs);
+    size_t mn     = std::min(xs, ys);
+    size_t pn     = xs + ys - 1;
+    size_t ws     = kigits_mul_space(xs, ys);
+    size_t needed = (xs + ys + pn + ws) * sizeof(kacc) + sizeof(kacc) - 1;
+    ularge carry  = 0;
+
+    if (mn >= KARATSUBA_KIGITS && rt.available() >= needed)
+    {
+        scribble scr;
+        byte *buffer = rt.allocate(needed);
+        uintptr_t aligned = uintptr_t(buffer) + sizeof(kacc) - 1;
+        kacc *xa = (kacc *) (aligned & ~uintptr_t(sizeof(kacc) - 1));
+        kacc *ya = xa + xs;
+        kacc *pa = ya + ys;
+        for (size_t i = 0; i < xs; i++)
+            xa[i] = xp[i];
+        for (size_t i = 0; i < ys; i++)
+            ya[i] = yp[i];
+        kigits_mul(pa, xa, xs, ya, ys, pa + pn);
+
+        for (size_t ri = rs; ri-- > 0; )
         {
-            size_t yo = ko - kshift;
-            if (yo < ys)
-                yk += kigit(+yb, yo) / hmul;
-            if (mod3 && ko > kshift && --yo < ys)
-                yk += kigit(+yb, yo) % hmul * lmul;
+            if (ri < pn)
+                carry += pa[ri];
+            rb[ri] = carry % 1000;
+            carry /= 1000;
         }
-        xk += yk;
-        carry = xk >= 1000;
-        if (carry)
-            xk -= 1000;
-        rb[ko] = xk;
+        return carry;
     }
 
-    // Check if a carry remains above top
-    if (carry)
+    // Column-wise schoolbook, from the least significant column
+    for (size_t ri = rs; ri-- > 0; )
     {
-        uint expincr = 1;
-        hmul = 10;
-        while (carry >= hmul)
+        if (ri < pn)
         {
-            hmul *= 10;
-            expincr++;
+            size_t lo = ri >= ys ? ri - ys + 1 : 0;
+            size_t hi = std::min(ri + 1, xs);
+            for (size_t i = lo; i < hi; i++)
+                carry += uint(xp[i]) * yp[ri - i];
         }
-        xe += expincr;
-        if (rs < ps)
+        rb[ri] = carry % 1000;
+        carry /= 1000;
+    }
+    return carry;
+}
+
+
+static size_t kigits_mul_bound(size_t n)
+// ----------------------------------------------------------------------------
+//   Workspace large enough for any kigits_mul with operands up to n kigits
+// ----------------------------------------------------------------------------
+//   Chunks of unbalanced products follow Euclid's algorithm on the sizes,
+//   so the chunk buffers add up to less than 8n.
+{
+    size_t bal = 0;
+    for (size_t j = KARATSUBA_KIGITS; j <= n; j++)
+        bal = std::max(bal, kigits_balanced_space(j));
+    return 8 * n + bal;
+}
+
+
+static void kn_mul(kacc *r, const kacc *a, size_t na,
+                   const kacc *b, size_t nb, kacc *ws)
+// ----------------------------------------------------------------------------
+//   Product of two kigit integers, r[0..na+nb) = a * b, with carries
+// ----------------------------------------------------------------------------
+{
+    kigits_mul(r, a, na, b, nb, ws);
+    kacc carry = 0;
+    for (size_t i = 0; i + 1 < na + nb; i++)
+    {
+        carry += r[i];
+        r[i] = carry % 1000;
+        carry /= 1000;
+    }
+    r[na + nb - 1] = carry;
+}
+
+
+static int kn_compare(const kacc *a, size_t na, const kacc *b, size_t nb)
+// ----------------------------------------------------------------------------
+//   Compare two kigit integers, which may have leading zeros
+// ----------------------------------------------------------------------------
+{
+    for (size_t i = std::max(na, nb); i-- > 0; )
+    {
+        kacc ak = i < na ? a[i] : 0;
+        kacc bk = i < nb ? b[i] : 0;
+        if (ak != bk)
+            return ak < bk ? -1 : 1;
+    }
+    return 0;
+}
+
+
+static void kn_add(kacc *r, size_t nr, const kacc *a, size_t na)
+// ----------------------------------------------------------------------------
+//   Add a to r in place, with nr >= na, dropping the carry out of r
+// ----------------------------------------------------------------------------
+{
+    kacc carry = 0;
+    for (size_t i = 0; i < nr && (i < na || carry); i++)
+    {
+        carry += r[i] + (i < na ? a[i] : 0);
+        r[i] = carry % 1000;
+        carry /= 1000;
+    }
+}
+
+
+static void kn_sub(kacc *r, size_t nr, const kacc *a, size_t na)
+// ----------------------------------------------------------------------------
+//   Subtract a from r in place, where r >= a
+// ----------------------------------------------------------------------------
+{
+    kacc borrow = 0;
+    for (size_t i = 0; i < nr && (i < na || borrow); i++)
+    {
+        kacc v = r[i] - (i < na ? a[i] : 0) - borrow;
+        borrow = v < 0;
+        r[i] = v + 1000 * borrow;
+    }
+}
+
+
+static size_t kn_size(const kacc *a, size_t na)
+// ----------------------------------------------------------------------------
+//   Size without leading zeros
+// ----------------------------------------------------------------------------
+{
+    while (na > 0 && a[na - 1] == 0)
+        na--;
+    return na;
+}
+
+
+static bool kigits_newton_divide(kint *qp, size_t rs,
+                                 const kint *xk, size_t xs,
+                                 const kint *yk, size_t ys)
+// ----------------------------------------------------------------------------
+//   Compute the quotient kigits of a division using Newton's method
+// ----------------------------------------------------------------------------
+//   This computes the same quotient as the long division in decimal::divide,
+//   Q = floor(X * 1000^(ys + rs - xs) / Y), stored most significant first
+//   in qp[0..rs), with qp[0] holding everything above the last rs-1 kigits.
+//   The reciprocal of Y is refined with precision doubling, then
+//   the quotient is corrected using the exact remainder.
+//   Returns false without touching qp if there is not enough memory.
+//   Free memory is checked first, so that the allocation does not cause a GC.
+{
+    size_t m  = ys;
+    size_t p  = rs + 3;
+    size_t sh = p + xs - rs;
+    size_t s  = m + rs - xs;
+    size_t qn = rs + 1;
+    size_t nn = m + rs;
+    size_t ws = kigits_mul_bound(p + 2);
+    size_t total = p + xs + 2 * (p + 2) + (2 * p + 4) + (3 * p + 4)
+        + (xs + p + 2) + (qn + m + 1) + (nn + 1) + ws;
+    size_t needed = total * sizeof(kacc) + sizeof(kacc) - 1;
+    if (rt.available() < needed)
+        return false;
+    scribble scr;
+    byte *buffer = rt.allocate(needed);
+
+    uintptr_t aligned = uintptr_t(buffer) + sizeof(kacc) - 1;
+    kacc *dp = (kacc *) (aligned & ~uintptr_t(sizeof(kacc) - 1));
+    kacc *xp = dp + p;
+    kacc *vp = xp + xs;
+    kacc *wp = vp + (p + 2);
+    kacc *pp = wp + (p + 2);
+    kacc *tp = pp + (2 * p + 4);
+    kacc *xv = tp + (3 * p + 4);
+    kacc *qd = xv + (xs + p + 2);
+    kacc *np = qd + (qn + m + 1);
+    kacc *wsp = np + (nn + 1);
+
+    // Load Y, padded with zeros to p kigits, and X, least significant first
+    for (size_t i = 0; i < p - m; i++)
+        dp[i] = 0;
+    for (size_t i = 0; i < m; i++)
+        dp[p - 1 - i] = yk[i];
+    for (size_t i = 0; i < xs; i++)
+        xp[xs - 1 - i] = xk[i];
+
+    // Initial reciprocal of the top two kigits, V = 1000^4 / D2
+    ularge d2 = ularge(dp[p - 1]) * 1000 + dp[p - 2];
+    ularge v2 = 1000000000000ULL / d2;
+    size_t h = 2;
+    for (size_t i = 0; i <= h; i++)
+    {
+        vp[i] = v2 % 1000;
+        v2 /= 1000;
+    }
+
+    // Newton iteration: V' = V + V * (1000^(l+h) - Dl * V) / 1000^2h
+    while (h < p)
+    {
+        size_t l  = std::min(2 * h - 1, p);
+        kacc  *dl = dp + (p - l);
+        size_t pn = l + h + 1;
+        kn_mul(pp, dl, l, vp, h + 1, wsp);
+
+        // Error term E = |1000^(l+h) - P|, and its sign
+        bool below = pp[l + h] == 0;
+        if (below)
         {
-            rb = (kint *) rt.allocate(sizeof(kint)) - rs;
-            if (!rb)
-                return nullptr;
-            rb[rs] = 0;
-            rs++;
+            // Two's complement in base 1000
+            kacc borrow = 0;
+            for (size_t i = 0; i < l + h; i++)
+            {
+                kacc v = -pp[i] - borrow;
+                borrow = v < 0;
+                pp[i] = v + 1000 * borrow;
+            }
         }
-
-        ko = rs;
-        lmul = 1000 / hmul;
-        while (ko --> 0)
+        else
         {
-            kint above = ko ? rb[ko-1] : carry;
-            rb[ko] = rb[ko] / hmul + (above % hmul) * lmul;
+            pp[l + h]--;
         }
+        size_t en = kn_size(pp, pn);
+
+        // Correction V * E / 1000^2h
+        for (size_t i = 0; i < l - h; i++)
+            wp[i] = 0;
+        for (size_t i = 0; i <= h; i++)
+            wp[l - h + i] = vp[i];
+        wp[l + 1] = 0;
+        if (en)
+        {
+            kn_mul(tp, vp, h + 1, pp, en, wsp);
+            size_t tn = kn_size(tp, h + 1 + en);
+            if (tn > 2 * h)
+            {
+                if (below)
+                    kn_add(wp, l + 2, tp + 2 * h, tn - 2 * h);
+                else
+                    kn_sub(wp, l + 2, tp + 2 * h, tn - 2 * h);
+            }
+        }
+        std::swap(vp, wp);
+        h = l;
     }
 
-    // Normalize result
-    if (!normalize(ty, rb, rs, xe))
-        return nullptr;
+    // Approximate quotient Qa = X * V / 1000^sh
+    kn_mul(xv, xp, xs, vp, p + 1, wsp);
+    kacc *qa = xv + sh;
+
+    // Exact remainder R = N - Qa * Y, where N = X * 1000^s
+    kacc *yp = dp + (p - m);
+    kn_mul(qd, qa, qn, yp, m, wsp);
+    size_t qdn = qn + m;
+    for (size_t i = 0; i <= nn; i++)
+        np[i] = i >= s && i - s < xs ? xp[i - s] : 0;
+    static const kacc one[1] = { 1 };
+    while (kn_compare(qd, qdn, np, nn + 1) > 0)
+    {
+        kn_sub(qd, qdn, yp, m);
+        kn_sub(qa, qn, one, 1);
+    }
+    kn_sub(np, nn + 1, qd, qdn);
+    while (kn_compare(np, nn + 1, yp, m) >= 0)
+    {
+        kn_sub(np, nn + 1, yp, m);
+        kn_add(qa, qn, one, 1);
+    }
 
-    // Build the result
-    gcp<kint> kigits = rb;
-    decimal_p result = rt.make<decimal>(ty, xe, rs, kigits);
-    return result;
+    // Store most significant first, with the top two kigits in qp[0]
+    for (size_t i = 0; i + 1 < rs; i++)
+        qp[rs - 1 - i] = qa[i];
+    qp[0] = qa[rs - 1] + 1000 * qa[rs];
+    return true;
 }
 
 
-decimal_p decimal::subtract(decimal_r x, decimal_r y)
+// ============================================================================
+//
+//   Unpacked decimal arithmetic
+//
+// ============================================================================
+//   The kernels below operate on unpacked kigits. They are shared between
+//   the decimal operations, which unpack their inputs once, and the
+//   accumulator used to evaluate series, which keeps intermediate values
+//   unpacked in the scratchpad until the final result is built.
+//   No kernel reads more than the working precision plus one kigit from
+//   its inputs, which is what division uses.
+
+struct kdecimal
 // ----------------------------------------------------------------------------
-//   Subtraction of two numbers with the same sign
+//   An unpacked decimal value, kigits most significant first
 // ----------------------------------------------------------------------------
 {
-    if (!x || !y)
-        return nullptr;
-    id xty = x->type();
-    id yty = y->type();
-    if (xty != yty)
-        return add(x, decimal_g(neg(y)));
-    subtract::remember(target<subtract>);
+    const kint *kigits;
+    size_t      nkigits;
+    large       exponent;
+    bool        negative;
+};
 
-    // Read information from both numbers
-    info  xi = x->shape();
-    info  yi = y->shape();
-    large xe = xi.exponent;
-    large ye = yi.exponent;
-    id    ty = x->type();
-    bool  lt = xe < ye;
+
+static inline size_t kdecimal_width()
+// ----------------------------------------------------------------------------
+//   Maximum number of kigits used by the kernels for an input
+// ----------------------------------------------------------------------------
+{
+    return (Settings.Precision() + 2) / 3 + 1;
+}
+
+
+static kdecimal kdecimal_unpack(decimal_p x, kint *kigits, size_t max)
+// ----------------------------------------------------------------------------
+//   Unpack up to max kigits of a decimal value
+// ----------------------------------------------------------------------------
+{
+    decimal::info xi = x->shape();
+    size_t        xs = std::min(xi.nkigits, max);
+    for (size_t i = 0; i < xs; i++)
+        kigits[i] = decimal::kigit(xi.base, i);
+    return kdecimal { kigits, xs, xi.exponent,
+                      x->type() == object::ID_neg_decimal };
+}
+
+
+static bool kdecimal_sum(kint *rb, kdecimal &r,
+                         kdecimal x, kdecimal y, bool sub)
+// ----------------------------------------------------------------------------
+//   Add or subtract two unpacked values
+// ----------------------------------------------------------------------------
+//   The result is built in rb, which must have room for the input width.
+//   If y is negligible relative to x or conversely, r refers to the
+//   kigits of the larger input, with the sign adjusted.
+{
+    bool  negative = x.negative;
+    bool  diff     = (x.negative != y.negative) != sub;
 
     // Put the smallest exponent in y
+    bool  lt = x.exponent < y.exponent;
     if (lt)
-    {
-        std::swap(xe, ye);
-        std::swap(xi, yi);
-    }
+        std::swap(x, y);
 
     // Check dimensions
-    size_t   xs     = xi.nkigits;
-    size_t   ys     = yi.nkigits;
-    gcbytes  xb     = xi.base;
-    gcbytes  yb     = yi.base;
-    size_t   yshift = xe - ye;
+    large    xe     = x.exponent;
+    size_t   xs     = x.nkigits;
+    size_t   ys     = y.nkigits;
+    size_t   yshift = x.exponent - y.exponent;
     size_t   kshift = yshift / 3;
     kint     mod3   = yshift % 3;
 
@@ -1722,130 +2161,117 @@ decimal_p decimal::subtract(decimal_r x, decimal_r y)
 
     // Check if y is negligible relative to x
     if (rs < kshift)
-        return lt ? neg(y) : decimal_p(x);
-
-    // Allocate the mantissa
-    scribble scr;
-    kint    *rb = (kint *) rt.allocate(rs * sizeof(kint));
-    if (!rb)
-        return nullptr;
+    {
+        r = x;
+        r.negative = negative != (diff && lt);
+        return true;
+    }
 
-    // Subtraction loop
+    // Addition or subtraction loop
     kint   hmul  = mod3 == 2 ? 100 : mod3 == 1 ? 10 : 1;
     kint   lmul  = 1000 / hmul;
     kint   carry = 0;
     size_t ko    = rs;
     while (ko-- > 0)
     {
-        kint xk = ko < xs ? kigit(+xb, ko) : 0;
+        kint xk = ko < xs ? x.kigits[ko] : 0;
         kint yk = carry;
         if (ko >= kshift)
         {
             size_t yo = ko - kshift;
             if (yo < ys)
-                yk += kigit(+yb, yo) / hmul;
+                yk += y.kigits[yo] / hmul;
             if (mod3 && ko > kshift && --yo < ys)
-                yk += kigit(+yb, yo) % hmul * lmul;
+                yk += y.kigits[yo] % hmul * lmul;
+        }
+        if (diff)
+        {
+            carry = xk < yk;
+            if (carry)
+                xk += 1000;
+            xk = xk - yk;
+        }
+        else
+        {
+            xk += yk;
+            carry = xk >= 1000;
+            if (carry)
+                xk -= 1000;
         }
-        carry = xk < yk;
-        if (carry)
-            xk += 1000;
-        xk = xk - yk;
         rb[ko] = xk;
     }
 
-    // Check if a carry remains above top, e.g. 0.5 - 0.6 = -0.1
-    if (carry)
+    // Check if a carry remains above top
+    if (carry && !diff)
     {
+        uint expincr = 1;
+        hmul = 10;
+        while (carry >= hmul)
+        {
+            hmul *= 10;
+            expincr++;
+        }
+        xe += expincr;
+        if (rs < ps)
+        {
+            rb[rs] = 0;
+            rs++;
+        }
+
+        ko = rs;
+        lmul = 1000 / hmul;
+        while (ko --> 0)
+        {
+            kint above = ko ? rb[ko-1] : carry;
+            rb[ko] = rb[ko] / hmul + (above % hmul) * lmul;
+        }
+    }
+    else if (carry)
+    {
+        // Subtraction went below zero, e.g. 0.5 - 0.6 = -0.1
+        // Trailing zero kigits remain zero, e.g. 0 - 0.001 = -0.001
         ko = rs;
         uint rev = 1000;
         while (ko --> 0)
         {
             rb[ko] = rev - rb[ko];
-            rev = 999;
+            if (rb[ko] == 1000)
+                rb[ko] = 0;
+            else
+                rev = 999;
         }
         lt = !lt;
     }
 
-    // Check if we need to change the sign
-    if (lt)
-        ty = negtype(ty);
-
     // Normalize result
+    negative = negative != (diff && lt);
+    object::id ty = negative ? object::ID_neg_decimal : object::ID_decimal;
     if (!normalize(ty, rb, rs, xe))
-        return nullptr;
-
-    // Build the result
-    gcp<kint> kigits = rb;
-    decimal_p result = rt.make<decimal>(ty, xe, rs, kigits);
-    return result;
+        return false;
+    r = kdecimal { rb, rs, xe, negative };
+    return true;
 }
 
 
-decimal_p decimal::multiply(decimal_r x, decimal_r y)
+static bool kdecimal_product(kint *rb, kdecimal &r,
+                             const kdecimal &x, const kdecimal &y)
 // ----------------------------------------------------------------------------
-//   Multiplication of two decimal numbers
+//   Multiply two unpacked values
 // ----------------------------------------------------------------------------
 //  (a0+a1/1000) * (b0+b1/1000) = a0*b0 + (a0*b1+a1*b0) / 1000 + epsilon
 //  Exponent is the sum of the two exponents
 {
-    if (!x || !y)
-        return nullptr;
-    multiply::remember(target<multiply>);
-
-    // Read information from both numbers
-    info     xi  = x->shape();
-    info     yi  = y->shape();
-    large    xe  = xi.exponent;
-    large    ye  = yi.exponent;
-    id       xty = x->type();
-    id       yty = y->type();
-    id       ty  = xty == yty ? ID_decimal : ID_neg_decimal;
-
-    // Check dimensions
-    size_t   xs  = xi.nkigits;
-    size_t   ys  = yi.nkigits;
-    gcbytes  xb  = xi.base;
-    gcbytes  yb  = yi.base;
-    large    re  = xe + ye - 3;
+    bool     negative = x.negative != y.negative;
+    size_t   xs       = x.nkigits;
+    size_t   ys       = y.nkigits;
+    large    re       = x.exponent + y.exponent - 3;
 
     // Size of result
-    size_t   ps  = (Settings.Precision() + 2) / 3;
-    size_t   rs  = std::min(ps, xs + ys + 1);
-
-    // Allocate the mantissa
-    scribble scr;
-    kint    *rb = (kint *) rt.allocate(rs * sizeof(kint));
-    if (!rb)
-        return nullptr;
-
-    // Zero the result before doing sums on it
-    for (size_t ri = 0; ri < rs; ri++)
-        rb[ri] = 0;
+    size_t   ps       = (Settings.Precision() + 2) / 3;
+    size_t   rs       = std::min(ps, xs + ys + 1);
 
     // Sum on all digits
-    uint carry = 0;
-    for (size_t xi = 0; xi < xs; xi++)
-    {
-        kint xk = kigit(xb, xi);
-        for (size_t yi = 0; yi < ys; yi++)
-        {
-            size_t ri = xi + yi;
-            if (ri >= rs)
-                break;
-            kint yk = kigit(yb, yi);
-            uint rk = xk * yk;
-            while (rk)
-            {
-                rk += rb[ri];
-                rb[ri] = rk % 1000;
-                rk /= 1000;
-                if (ri-- == 0)
-                    break;
-            }
-            carry += rk;
-        }
-    }
+    uint carry = kigits_product(rb, rs, x.kigits, xs, y.kigits, ys);
 
     // Check if a carry remains above top
     while (carry)
@@ -1888,22 +2314,22 @@ decimal_p decimal::multiply(decimal_r x, decimal_r y)
             rb[ko] = (rb[ko] * hmul + next / lmul) % 1000;
         }
     }
-
-    // Normalize result
-    if (!normalize(ty, rb, rs, re))
-        return nullptr;
-
-    // Build the result
-    gcp<kint> kigits = rb;
-    decimal_p result = rt.make<decimal>(ty, re, rs, kigits);
-    return result;
+
+    // Normalize result
+    object::id ty = negative ? object::ID_neg_decimal : object::ID_decimal;
+    if (!normalize(ty, rb, rs, re))
+        return false;
+    r = kdecimal { rb, rs, re, negative };
+    return true;
 }
 
 
-decimal_p decimal::divide(decimal_r x, decimal_r y)
+static bool kdecimal_quotient(kint *rp, kdecimal &r,
+                              const kdecimal &x, const kdecimal &y)
 // ----------------------------------------------------------------------------
-//   Division of two decimal numbers
+//   Divide two unpacked values
 // ----------------------------------------------------------------------------
+//   The rp buffer must have room for twice the input width plus one.
 //
 //   This uses the traditional algorithm, but with digits between 0 and 999
 //
@@ -1913,55 +2339,36 @@ decimal_p decimal::divide(decimal_r x, decimal_r y)
 //          R = R * 1000 + X[i]
 //          Q[i] = R[0] / D[0]
 //          R = R - Y * Q[i]
+//
+//   For long mantissas, the quotient is computed using Newton's method
+//   instead, see kigits_newton_divide above.
 {
-    if (!x || !y)
-        return nullptr;
-    divide::remember(target<divide>);
-
     // Check if we divide by zero
-    if (y->is_zero())
+    if (!y.nkigits)
     {
         rt.zero_divide_error();
-        return nullptr;
+        return false;
     }
 
-    // Read information from both numbers
-    info     xi  = x->shape();
-    info     yi  = y->shape();
-    large    xe  = xi.exponent;
-    large    ye  = yi.exponent;
-    id       xty = x->type();
-    id       yty = y->type();
-    id       ty  = xty == yty ? ID_decimal : ID_neg_decimal;
+    bool     negative = x.negative != y.negative;
+    object::id ty     = negative ? object::ID_neg_decimal : object::ID_decimal;
 
     // Size of result
     size_t   rs  = (Settings.Precision() + 2) / 3 + 1;
     size_t   qs  = rs;
 
     // Check dimensions
-    size_t   xs  = std::min(xi.nkigits, rs);
-    size_t   ys  = std::min(yi.nkigits, rs);
-    gcbytes  xb  = xi.base;
-    gcbytes  yb  = yi.base;
-    large    re  = xe - ye;
+    size_t   xs  = std::min(x.nkigits, rs);
+    size_t   ys  = std::min(y.nkigits, rs);
+    large    re  = x.exponent - y.exponent;
 
-    // Allocate memory for the result
-    scribble scr;
-    kint    *rp = (kint *) rt.allocate((rs + qs + xs + ys) * sizeof(kint));
-    if (!rp)
-        return nullptr;
-
-    // Read the kigits from both inputs
-    kint    *qp = rp + rs;
-    kint    *xp = qp + qs;
-    kint    *yp = xp + xs;
-    for (size_t xi = 0; xi < xs; xi++)
-        xp[xi] = kigit(+xb, xi);
-    for (size_t yi = 0; yi < ys; yi++)
-        yp[yi] = kigit(+yb, yi);
+    // The quotient follows the remainder, the remainder loop relies on it
+    kint       *qp = rp + rs;
+    const kint *xp = x.kigits;
+    const kint *yp = y.kigits;
 
     // Initialize remainder and quotient with 0
-    size_t rqs = rs + qs;
+    size_t rqs = rs + qs + 1;
     for (size_t xi = 0; xi < xs; xi++)
         rp[xi] = xp[xi];
     for (size_t rqi = xs; rqi < rqs; rqi++)
@@ -1972,8 +2379,12 @@ decimal_p decimal::divide(decimal_r x, decimal_r y)
     // After that, these are remainders, so always smaller than Y[0]
     uint yv = yp[0] + (ys > 0);
 
+    // For long mantissas, compute the quotient with Newton's method
+    bool   newton = qs >= decimal::newton_kigits
+        && kigits_newton_divide(qp, qs, xp, xs, yp, ys);
+    size_t qi     = newton ? qs : 0;
+
     // Loop on the numerator
-    size_t qi = 0;
     while (qi < qs)
     {
         // R = R * 1000
@@ -2038,6 +2449,45 @@ decimal_p decimal::divide(decimal_r x, decimal_r y)
         {
             qi++;
             memmove(rp, rp + 1, sizeof(kint) * (rs - 1));
+            rp[rs - 1] = 0;
+        }
+    }
+
+    // The loop stops once the top kigit of the remainder is below Y[0] + 1,
+    // so the remainder may still be above Y. Subtract what is left, so that
+    // the last kigit is truncated exactly, as with Newton's method
+    if (!newton)
+    {
+        uint yv2 = yp[0] * 1000 + (ys > 1 ? yp[1] + 1 : 0);
+        while (true)
+        {
+            size_t ri = 0;
+            while (ri < ys && rp[ri] == yp[ri])
+                ri++;
+            if (ri < ys && rp[ri] < yp[ri])
+                break;
+
+            // Underestimate the quotient from the top two kigits
+            uint q = (rp[0] * 1000 + (rs > 1 ? rp[1] : 0)) / yv2;
+            if (!q)
+                q = 1;
+
+            int borrow = 0;
+            for (size_t yi = ys; yi --> 0; )
+            {
+                int rk = int(rp[yi]) - int(q * yp[yi]) - borrow;
+                borrow = rk < 0 ? (999 - rk) / 1000 : 0;
+                rp[yi] = rk + 1000 * borrow;
+            }
+
+            size_t ci = qs - 1;
+            qp[ci] += q;
+            while (ci && qp[ci] >= 1000)
+            {
+                qp[ci - 1] += qp[ci] / 1000;
+                qp[ci] %= 1000;
+                ci--;
+            }
         }
     }
 
@@ -2065,15 +2515,276 @@ decimal_p decimal::divide(decimal_r x, decimal_r y)
 
     // Normalize result
     if (!normalize(ty, qp, qs, re))
-        return nullptr;
+        return false;
 
     if (qs >= rs)
         qs = rs - 1;
 
+    r = kdecimal { qp, qs, re, negative };
+    return true;
+}
+
+
+enum kdecimal_op { KDECIMAL_ADD, KDECIMAL_SUB, KDECIMAL_MUL, KDECIMAL_DIV };
+
+static bool kdecimal_apply(kdecimal_op op, kint *work, kdecimal &r,
+                           const kdecimal &x, const kdecimal &y)
+// ----------------------------------------------------------------------------
+//   Run one of the kernels, work must hold twice the input width plus one
+// ----------------------------------------------------------------------------
+{
+    switch (op)
+    {
+    case KDECIMAL_ADD:  return kdecimal_sum(work, r, x, y, false);
+    case KDECIMAL_SUB:  return kdecimal_sum(work, r, x, y, true);
+    case KDECIMAL_MUL:  return kdecimal_product(work, r, x, y);
+    case KDECIMAL_DIV:  return kdecimal_quotient(work, r, x, y);
+    }
+    return false;
+}
+
+
+static decimal_p kdecimal_operation(kdecimal_op op, decimal_r x, decimal_r y)
+// ----------------------------------------------------------------------------
+//   Unpack two decimal values, apply a kernel and build the result
+// ----------------------------------------------------------------------------
+{
+    size_t   width = kdecimal_width();
+    scribble scr;
+    kint    *xp    = (kint *) rt.allocate((4 * width + 1) * sizeof(kint));
+    if (!xp)
+        return nullptr;
+    kint    *yp    = xp + width;
+    kint    *work  = yp + width;
+    kdecimal xv    = kdecimal_unpack(x, xp, width);
+    kdecimal yv    = kdecimal_unpack(y, yp, width);
+    kdecimal r;
+    if (!kdecimal_apply(op, work, r, xv, yv))
+        return nullptr;
+
+    // If one input was negligible, return it unchanged
+    if (r.kigits == xp)
+        return r.negative == xv.negative ? +x : decimal::neg(x);
+    if (r.kigits == yp)
+        return r.negative == yv.negative ? +y : decimal::neg(y);
+
     // Build the result
-    gcp<kint> kigits = qp;
-    decimal_p result = rt.make<decimal>(ty, re, qs, kigits);
-    return result;
+    object::id ty = r.negative ? object::ID_neg_decimal : object::ID_decimal;
+    gcp<kint> kigits = r.kigits;
+    return rt.make<decimal>(ty, r.exponent, r.nkigits, kigits);
+}
+
+
+struct kigits_accumulator
+// ----------------------------------------------------------------------------
+//   Unpacked decimal registers in the scratchpad, used to evaluate series
+// ----------------------------------------------------------------------------
+//   Registers are identified by index. All the storage is allocated when
+//   the accumulator is built, so that operations never cause a GC.
+//   Other code may run between operations, since the storage is referenced
+//   through a GC-safe pointer.
+//   A register also remembers the decimal object it was loaded from, as long
+//   as it holds the same value, so that an input that goes through a series
+//   unchanged is returned as is, like the decimal operations would do.
+{
+    static const uint MAX_REGISTERS = 8;
+
+    kigits_accumulator(uint count)
+        : scr(), count(count), width(kdecimal_width()), storage()
+    {
+        storage = rt.allocate(((count + 2) * width + 1) * sizeof(kint));
+        for (uint r = 0; r < count; r++)
+            value[r] = kdecimal { nullptr, 0, 0, false };
+    }
+
+    operator bool() const
+    {
+        return storage;
+    }
+
+    kint *kigits(uint r)
+    {
+        return (kint *) +storage + r * width;
+    }
+
+    kdecimal operator[](uint r)
+    {
+        kdecimal v = value[r];
+        v.kigits = kigits(r);
+        return v;
+    }
+
+    bool store(uint r, const kdecimal &v)
+    {
+        kint *rp = kigits(r);
+        if (v.kigits != rp)
+        {
+            decimal_p src = nullptr;
+            for (uint q = 0; q < count; q++)
+                if (v.kigits == kigits(q))
+                    src = source[q];
+            memmove(rp, v.kigits, v.nkigits * sizeof(kint));
+            source[r] = src;
+        }
+        value[r] = v;
+        return true;
+    }
+
+    bool load(uint r, decimal_p x)
+    {
+        if (!x || !storage)
+            return false;
+        value[r] = kdecimal_unpack(x, kigits(r), width);
+        source[r] = x;
+        return true;
+    }
+
+    bool load_integer(uint r, ularge x)
+    {
+        // Same layout as decimal::make, which keeps trailing zero kigits
+        if (!storage)
+            return false;
+        kint   kigs[8];
+        uint   digits = 0;
+        for (ularge v = x; v; v /= 10)
+            digits++;
+        size_t rs   = (digits + 2) / 3;
+        uint   hmul = digits % 3 == 1 ? 100 : digits % 3 == 2 ? 10 : 1;
+        uint   lmod = 1000 / hmul;
+        for (size_t ri = rs; ri --> 0; )
+        {
+            if (ri + 1 == rs)
+            {
+                kigs[ri] = x % lmod * hmul;
+                x /= lmod;
+            }
+            else
+            {
+                kigs[ri] = x % 1000;
+                x /= 1000;
+            }
+        }
+        rs = std::min(rs, width);
+        memcpy(kigits(r), kigs, rs * sizeof(kint));
+        value[r] = kdecimal { nullptr, rs, large(digits), false };
+        source[r] = nullptr;
+        return true;
+    }
+
+    bool copy(uint r, uint x)
+    {
+        return storage && store(r, (*this)[x]);
+    }
+
+    bool apply(kdecimal_op op, uint r, uint x, uint y)
+    {
+        kdecimal v;
+        return storage
+            && kdecimal_apply(op, kigits(count), v, (*this)[x], (*this)[y])
+            && store(r, v);
+    }
+
+    bool add(uint r, uint x, uint y) { return apply(KDECIMAL_ADD, r, x, y); }
+    bool sub(uint r, uint x, uint y) { return apply(KDECIMAL_SUB, r, x, y); }
+    bool mul(uint r, uint x, uint y) { return apply(KDECIMAL_MUL, r, x, y); }
+    bool div(uint r, uint x, uint y) { return apply(KDECIMAL_DIV, r, x, y); }
+
+    void negate(uint r)
+    {
+        value[r].negative = !value[r].negative;
+    }
+
+    large exponent(uint r) const
+    {
+        return value[r].exponent;
+    }
+
+    decimal_p make(uint r)
+    {
+        if (!storage)
+            return nullptr;
+        if (decimal_g src = source[r])
+        {
+            bool negative = src->type() == object::ID_neg_decimal;
+            return negative == value[r].negative ? +src : decimal::neg(src);
+        }
+        object::id ty = value[r].negative
+            ? object::ID_neg_decimal
+            : object::ID_decimal;
+        gcp<kint> kigs = kigits(r);
+        return rt.make<decimal>(ty, value[r].exponent, value[r].nkigits, kigs);
+    }
+
+private:
+    scribble scr;
+    uint     count;
+    size_t   width;
+    gcmbytes  storage;
+    kdecimal  value[MAX_REGISTERS];
+    decimal_g source[MAX_REGISTERS];
+};
+
+
+decimal_p decimal::add(decimal_r x, decimal_r y)
+// ----------------------------------------------------------------------------
+//   Addition of two numbers with the same sign
+// ----------------------------------------------------------------------------
+{
+    if (!x || !y)
+        return nullptr;
+    id xty = x->type();
+    id yty = y->type();
+    if (xty != yty)
+        return subtract(x, decimal_g(neg(y)));
+    add::remember(target<add>);
+    return kdecimal_operation(KDECIMAL_ADD, x, y);
+}
+
+
+decimal_p decimal::subtract(decimal_r x, decimal_r y)
+// ----------------------------------------------------------------------------
+//   Subtraction of two numbers with the same sign
+// ----------------------------------------------------------------------------
+{
+    if (!x || !y)
+        return nullptr;
+    id xty = x->type();
+    id yty = y->type();
+    if (xty != yty)
+        return add(x, decimal_g(neg(y)));
+    subtract::remember(target<subtract>);
+    return kdecimal_operation(KDECIMAL_SUB, x, y);
+}
+
+
+decimal_p decimal::multiply(decimal_r x, decimal_r y)
+// ----------------------------------------------------------------------------
+//   Multiplication of two decimal numbers
+// ----------------------------------------------------------------------------
+{
+    if (!x || !y)
+        return nullptr;
+    multiply::remember(target<multiply>);
+    return kdecimal_operation(KDECIMAL_MUL, x, y);
+}
+
+
+decimal_p decimal::divide(decimal_r x, decimal_r y)
+// ----------------------------------------------------------------------------
+//   Division of two decimal numbers
+// ----------------------------------------------------------------------------
+{
+    if (!x || !y)
+        return nullptr;
+    divide::remember(target<divide>);
+
+    // Check if we divide by zero
+    if (y->is_zero())
+    {
+        rt.zero_divide_error();
+        return nullptr;
+    }
+    return kdecimal_operation(KDECIMAL_DIV, x, y);
 }
 
 
@@ -2290,42 +3001,39 @@ decimal_p decimal::sin_fracpi(uint qturns, decimal_r fp)
     // Scale by pi / 2, sum is between 0 and pi/4
     decimal_g sum = fp;
     decimal_g fact = make(2);
-    decimal_g tmp;
     sum = sum / fact;
     sum = sum * pi();
-    fact = make(6); // 3!
 
     // Prepare power factor and square that we multiply by every time
-    decimal_g power = sum;
-    decimal_g square = sum * sum;
+    enum { SUM, POWER, SQUARE, FACT, TMP };
+    kigits_accumulator acc(5);
+    if (!acc.load(SUM, sum) || !acc.copy(POWER, SUM) ||
+        !acc.mul(SQUARE, SUM, SUM) || !acc.load_integer(FACT, 6)) // 3!
+        return nullptr;
 
     uint prec = Settings.Precision();
     for (uint i = 3; i < prec; i += 2)
     {
-        power = power * square; // First iteration is x^3
-        tmp = power / fact;     // x^3 / 3!
-
-        // Check if we ran out of memory
-        if (!sum || !tmp)
+        if (!acc.mul(POWER, POWER, SQUARE) ||   // First iteration is x^3
+            !acc.div(TMP, POWER, FACT))         // x^3 / 3!
             return nullptr;
 
         // If what we add no longer has an impact, we can exit
-        if (tmp->exponent() + large(prec) < sum->exponent())
+        if (acc.exponent(TMP) + large(prec) < acc.exponent(SUM))
             break;
 
-        if ((i / 2) & 1)
-            sum = sum - tmp;
-        else
-            sum = sum + tmp;
+        if ((i / 2) & 1 ? !acc.sub(SUM, SUM, TMP) : !acc.add(SUM, SUM, TMP))
+            return nullptr;
 
-        tmp = make((i+1) * (i+2)); // First iteration: 4 * 5
-        fact = fact * tmp;
+        if (!acc.load_integer(TMP, (i+1) * (i+2)) || // First iteration: 4 * 5
+            !acc.mul(FACT, FACT, TMP))
+            return nullptr;
     }
 
     // sin(x+pi) = -si(x)
     if (qturns != 0)
-        sum = -sum;
-    return sum;
+        acc.negate(SUM);
+    return acc.make(SUM);
 }
 
 
@@ -2353,44 +3061,43 @@ decimal_p decimal::cos_fracpi(uint qturns, decimal_r fp)
     // Scale by pi / 2, sum is between 0 and pi/4
     decimal_g sum = fp;
     decimal_g fact = make(2); // Also 2!
-    decimal_g tmp;
     sum = sum / fact;
     sum = sum * pi();
 
     // Prepare power factor and square that we multiply by every time
-    decimal_g square = sum * sum;
-    decimal_g power = square;
+    enum { SUM, POWER, SQUARE, FACT, TMP };
+    kigits_accumulator acc(5);
+    if (!acc.load(SUM, sum) || !acc.mul(SQUARE, SUM, SUM) ||
+        !acc.copy(POWER, SQUARE) || !acc.load(FACT, fact))
+        return nullptr;
 
     // For cosine, the sum starts at 1
-    sum = make(1);
+    if (!acc.load_integer(SUM, 1))
+        return nullptr;
 
     uint prec = Settings.Precision();
     for (uint i = 2; i < prec; i += 2)
     {
-        tmp = power / fact;     // x^2 / 2!
-
-        // Check if we ran out of memory
-        if (!sum || !tmp)
+        if (!acc.div(TMP, POWER, FACT))         // x^2 / 2!
             return nullptr;
 
         // If what we add no longer has an impact, we can exit
-        if (tmp->exponent() + large(prec) < sum->exponent())
+        if (acc.exponent(TMP) + large(prec) < acc.exponent(SUM))
             break;
 
-        if ((i / 2) & 1)
-            sum = sum - tmp;
-        else
-            sum = sum + tmp;
+        if ((i / 2) & 1 ? !acc.sub(SUM, SUM, TMP) : !acc.add(SUM, SUM, TMP))
+            return nullptr;
 
-        power = power * square; // Next iteration is x^4
-        tmp = make((i+1) * (i+2)); // First iteration: 4 * 5
-        fact = fact * tmp;
+        if (!acc.mul(POWER, POWER, SQUARE) ||          // Next iteration is x^4
+            !acc.load_integer(TMP, (i+1) * (i+2)) ||   // First iteration: 4 * 5
+            !acc.mul(FACT, FACT, TMP))
+            return nullptr;
     }
 
     // sin(x+pi) = -si(x)
     if (qturns != 0)
-        sum = -sum;
-    return sum;
+        acc.negate(SUM);
+    return acc.make(SUM);
 }
 
 
@@ -2684,33 +3391,35 @@ decimal_p decimal::log1p(decimal_r x)
            +scaled, texp, eexp, ipart);
 
     // Taylor's serie
-    decimal_g sum = scaled;
+    enum { SUM, SCALED, POWER, SCALE };
+    kigits_accumulator acc(4);
+    if (!acc.load(SCALED, scaled) ||
+        !acc.copy(SUM, SCALED) || !acc.copy(POWER, SCALED))
+        return nullptr;
+
     uint prec = Settings.Precision();
-    power = scaled;
     for (uint i = 2; i < 3*prec; i++)
     {
-        power = power * scaled;
-        scale = make(i);
-        scale = power / scale;
-
-        if (!sum || !scale)
+        if (!acc.mul(POWER, POWER, SCALED) ||
+            !acc.load_integer(SCALE, i) ||
+            !acc.div(SCALE, POWER, SCALE))
             return nullptr;
 
         // If what we add no longer has an impact, we can exit
-        if (scale->exponent() + large(prec) < sum->exponent())
+        if (acc.exponent(SCALE) + large(prec) < acc.exponent(SUM))
         {
-            record(decimal, "Taylor exits at %u exp=%ld", i, scale->exponent());
+            record(decimal, "Taylor exits at %u exp=%ld",
+                   i, acc.exponent(SCALE));
             break;
         }
 
-        if (i & 1)
-            sum = sum + scale;
-        else
-            sum = sum - scale;
+        if (i & 1 ? !acc.add(SUM, SUM, SCALE) : !acc.sub(SUM, SUM, SCALE))
+            return nullptr;
     }
-    record(decimal, "Power at exit %t exponent %ld", +power, power->exponent());
-    record(decimal, "Sum   at exit %t exponent %ld", +sum, sum->exponent());
+    record(decimal, "Power at exit exponent %ld", acc.exponent(POWER));
+    record(decimal, "Sum   at exit exponent %ld", acc.exponent(SUM));
 
+    decimal_g sum = acc.make(SUM);
     if (ipart)
     {
         scale = make(ipart);
@@ -2734,30 +3443,27 @@ decimal_p decimal::expm1(decimal_r x)
         return nullptr;
 
     // Prepare power factor and square that we multiply by every time
-    decimal_g one =  make(1);
-    decimal_g sum = fp;
-    decimal_g fact = one;
-    decimal_g power = fp;
-    decimal_g tmp;
+    enum { SUM, X, POWER, FACT, TMP };
+    kigits_accumulator acc(5);
+    if (!acc.load(X, fp) || !acc.copy(SUM, X) || !acc.copy(POWER, X) ||
+        !acc.load_integer(FACT, 1))
+        return nullptr;
 
     uint prec = Settings.Precision();
     for (uint i = 2; i < prec; i++)
     {
-        power = power * fp;
-        tmp = make(i);
-        fact = fact * tmp;
-
-        tmp = power / fact;     // x^2 / 2!
-
-        // Check if we ran out of memory
-        if (!sum || !tmp)
+        if (!acc.mul(POWER, POWER, X) ||
+            !acc.load_integer(TMP, i) ||
+            !acc.mul(FACT, FACT, TMP) ||
+            !acc.div(TMP, POWER, FACT))         // x^2 / 2!
             return nullptr;
 
         // If what we add no longer has an impact, we can exit
-        if (tmp->exponent() + large(prec) < sum->exponent())
+        if (acc.exponent(TMP) + large(prec) < acc.exponent(SUM))
             break;
 
-        sum = sum + tmp;
+        if (!acc.add(SUM, SUM, TMP))
+            return nullptr;
     }
 
     if (ip)
@@ -2765,23 +3471,25 @@ decimal_p decimal::expm1(decimal_r x)
         bool neg = ip < 0;
         if (neg)
             ip = -ip;
-        fact = one;
-        power = constants().e;
+        if (!acc.load_integer(FACT, 1) || !acc.load(POWER, constants().e))
+            return nullptr;
         while (ip)
         {
             if (ip & 1)
-                fact = fact * power;
+                if (!acc.mul(FACT, FACT, POWER))
+                    return nullptr;
             ip >>= 1;
             if (ip)
-                power = power * power;
+                if (!acc.mul(POWER, POWER, POWER))
+                    return nullptr;
         }
-        if (neg)
-            sum = (sum + one) / fact - one;
-        else
-            sum = (sum + one) * fact - one;
+        if (!acc.load_integer(TMP, 1) || !acc.add(SUM, SUM, TMP) ||
+            !(neg ? acc.div(SUM, SUM, FACT) : acc.mul(SUM, SUM, FACT)) ||
+            !acc.sub(SUM, SUM, TMP))
+            return nullptr;
     }
 
-    return sum;
+    return acc.make(SUM);
 }
 
 
@@ -2869,33 +3577,38 @@ decimal_p decimal::exp(decimal_r x)
     if (!x->split(ip, fp))
         return nullptr;
 
-    // Compute exponential for integral part
-    decimal_g one = make(1);
+    // Compute exponential for fractional part
     decimal_g result = expm1(fp);
-    result = (one + result);
+    enum { RESULT, SCALE, POWER };
+    kigits_accumulator acc(3);
+    if (!acc.load_integer(SCALE, 1) || !acc.load(RESULT, result) ||
+        !acc.add(RESULT, SCALE, RESULT))
+        return nullptr;
 
+    // Compute exponential for integral part
     if (ip)
     {
         bool neg = ip < 0;
         if (neg)
             ip = - ip;
-        decimal_g scale = one;
-        decimal_g power = constants().e;
+        if (!acc.load(POWER, constants().e))
+            return nullptr;
         while (ip)
         {
             if (ip & 1)
-                scale = scale * power;
+                if (!acc.mul(SCALE, SCALE, POWER))
+                    return nullptr;
             ip >>= 1;
             if (ip)
-                power = power * power;
+                if (!acc.mul(POWER, POWER, POWER))
+                    return nullptr;
         }
-        if (neg)
-            result = result / scale;
-        else
-            result = result * scale;
+        if (neg ? !acc.div(RESULT, RESULT, SCALE)
+                : !acc.mul(RESULT, RESULT, SCALE))
+            return nullptr;
     }
 
-    return result;
+    return acc.make(RESULT);
 }
 
 
@@ -2952,39 +3665,37 @@ decimal_p decimal::erf(decimal_r x)
     }
 
     // Taylor's serie
-    decimal_g sum    = x;
-    decimal_g square = x * x;
-    decimal_g power  = sum;
-    decimal_g fact = make(1);
-    decimal_g tmp;
+    enum { SUM, SQUARE, POWER, FACT, TMP };
+    kigits_accumulator acc(5);
+    if (!acc.load(SUM, x) || !acc.mul(SQUARE, SUM, SUM) ||
+        !acc.copy(POWER, SUM) || !acc.load_integer(FACT, 1))
+        return nullptr;
 
     uint prec = Settings.Precision();
     for (uint i = 1; i < 2 * prec; i++)
     {
         // First term is x^3 / (3 * 1!), second is x^5 / (5 * 2!)
-        power = power * square;         // x^3
-        tmp = make(i);                  // 1
-        fact = fact * tmp;              // 1!
-        tmp = make(2*i+1);              // 3
-        tmp = fact * tmp;               // 1! * 3
-        tmp = power / tmp;              // x^3 / (1! * 3)
-
-        if (!sum || !tmp)
+        if (!acc.mul(POWER, POWER, SQUARE) ||   // x^3
+            !acc.load_integer(TMP, i) ||        // 1
+            !acc.mul(FACT, FACT, TMP) ||        // 1!
+            !acc.load_integer(TMP, 2*i+1) ||    // 3
+            !acc.mul(TMP, FACT, TMP) ||         // 1! * 3
+            !acc.div(TMP, POWER, TMP))          // x^3 / (1! * 3)
             return nullptr;
 
         // If what we add no longer has an impact, we can exit
-        if (tmp->exponent() + large(prec) < sum->exponent())
+        if (acc.exponent(TMP) + large(prec) < acc.exponent(SUM))
             break;
 
-        if (i & 1)
-            sum = sum - tmp;
-        else
-            sum = sum + tmp;
+        if (i & 1 ? !acc.sub(SUM, SUM, TMP) : !acc.add(SUM, SUM, TMP))
+            return nullptr;
     }
 
     // Multiply result by 2 / sqrt(pi)
-    sum = sum * constants().two_over_sqrt_pi();
-    return sum;
+    if (!acc.load(TMP, constants().two_over_sqrt_pi()) ||
+        !acc.mul(SUM, SUM, TMP))
+        return nullptr;
+    return acc.make(SUM);
 }
 
 
@@ -3166,14 +3877,17 @@ decimal_p decimal::lgamma_internal(decimal_r x)
     // Loop for terms except first one
     decimal_g factorial = make(1);
     decimal_g sum       = constants().sqrt_2pi();
-    decimal_g one       = make(1);
-    decimal_g z         = x;
-    decimal_g ck, power, scale;
+    decimal_g z, power, scale;
     record(decimal, "First sum %t", +sum);
+
+    enum { SUM, Z, ONE, CK };
+    kigits_accumulator acc(4);
+    if (!acc.load(SUM, sum) || !acc.load(Z, x) || !acc.load_integer(ONE, 1))
+        return nullptr;
     for (uint i = 1; i < na; i++)
     {
-        z   = z + one;
-        record(decimal, "%u: z=%t", i, +z);
+        if (!acc.add(Z, Z, ONE))
+            return nullptr;
 
         tmp = cks[i-1];
         if (!tmp)
@@ -3206,13 +3920,12 @@ decimal_p decimal::lgamma_internal(decimal_r x)
             record(decimal, "%u: factorial=%t", i, +factorial);
         }
         record(decimal, "%u: ck=%t", i, +tmp);
-        if (i & 1)
-            sum = sum + tmp / z;
-        else
-            sum = sum - tmp / z;
-        record(decimal, "%u: sum=%t", i, +sum);
+        if (!acc.load(CK, tmp) || !acc.div(CK, CK, Z) ||
+            (i & 1 ? !acc.add(SUM, SUM, CK) : !acc.sub(SUM, SUM, CK)))
+            return nullptr;
     }
 
+    sum = acc.make(SUM);
     sum = log(sum);
 
     // Add first term
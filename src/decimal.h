@@ -516,6 +516,11 @@ struct decimal : algebraic
     static decimal_p Min(decimal_r x, decimal_r y);
     static decimal_p Max(decimal_r x, decimal_r y);
 
+    static size_t newton_kigits;
+    // ------------------------------------------------------------------------
+    //   Quotient length in kigits from which division uses Newton's method
+    // ------------------------------------------------------------------------
+
 
 
     // ========================================================================
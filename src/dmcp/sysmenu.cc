@@ -38,6 +38,7 @@
 #include "runtime.h"
 #include "settings.h"
 #include "sim-dmcp.h"
+#include "snapshot.h"
 #include "target.h"
 #include "types.h"
 #include "user_interface.h"
@@ -198,6 +199,8 @@ const uint8_t state_menu_items[] =
     MI_48STATE_SAVE,            // Save a 48 program to disk
     MI_48STATE_CLEAN,           // Start with a fresh clean state
     MI_48STATE_MERGE,           // Merge a 48S state from disk
+    MI_48STATE_SNAP_LOAD,       // Load a binary snapshot from disk
+    MI_48STATE_SNAP_SAVE,       // Save a binary snapshot to disk
     MI_MSC,                     // Activate USB disk
     MI_DISK_INFO,               // Show disk information
 
@@ -240,6 +243,20 @@ static int state_save_callback(cstring fpath, cstring fname, void *)
     // Display the name of the file being saved
     ui.draw_message("Saving state...", fname);
 
+    // Binary snapshots are written as is, without rendering
+    if (snapshot::is_snapshot(fpath))
+    {
+        if (!snapshot::save(fpath))
+        {
+            ui.draw_message("State save failed", cstring(rt.error()), fpath);
+            rt.clear_error();
+            wait_for_key_press();
+            return 1;
+        }
+        set_reset_state_file(fpath);
+        return MRET_EXIT;
+    }
+
     // Open save file name
     file prog(fpath, file::WRITING);
     if (!prog.valid())
@@ -296,7 +313,7 @@ static int state_save_callback(cstring fpath, cstring fname, void *)
 }
 
 
-static int state_save()
+static int state_save(cstring ext = ".48S")
 // ----------------------------------------------------------------------------
 //   Save a program to disk
 // ------------------------------------------------------------1----------------
@@ -309,7 +326,7 @@ static int state_save()
     bool overwrite_check = true;
     void *user_data = NULL;
     int ret = file_selection_screen("Save state",
-                                    "/state", ".48S",
+                                    "/state", ext,
                                     state_save_callback,
                                     display_new, overwrite_check,
                                     user_data);
@@ -375,6 +392,20 @@ static int state_load_callback(cstring path, cstring name, void *merge)
     ui.draw_message(merge ? "Merge state" : "Load state",
                     "Loading state...", name);
 
+    // Binary snapshots always replace the whole state
+    if (snapshot::is_snapshot(path))
+    {
+        if (!snapshot::load(path))
+        {
+            ui.draw_error();
+            return 1;
+        }
+        ui.menu_refresh();
+        if (!merge)
+            set_reset_state_file(path);
+        return MRET_EXIT;
+    }
+
     // Store the state file name
     {
         file prog(path, file::READING);
@@ -461,7 +492,7 @@ static int state_load_callback(cstring path, cstring name, void *merge)
 }
 
 
-static int state_load(bool merge)
+static int state_load(bool merge, cstring ext = ".48S")
 // ----------------------------------------------------------------------------
 //   Load a state from disk
 // ----------------------------------------------------------------------------
@@ -470,7 +501,7 @@ static int state_load(bool merge)
     bool overwrite_check = false;
     void *user_data = (void *) merge;
     int ret = file_selection_screen(merge ? "Merge state" : "Load state",
-                                    "/state", ".48S",
+                                    "/state", ext,
                                     state_load_callback,
                                     display_new, overwrite_check,
                                     user_data);
@@ -507,11 +538,12 @@ static bool is_valid_state_file(cstring filename)
 // ----------------------------------------------------------------------------
 //   Check if we have a valid DB48X state (to avoid touching DM42/DM32 states)
 // ----------------------------------------------------------------------------
-//   We accept both .48s and .48S
+//   We accept both .48s and .48S, as well as .48b and .48B for snapshots
 {
     if (cstring ext = file::extension(filename))
         return
-            ext[1] == '4' && ext[2] == '8' && tolower(ext[3]) == 's'
+            ext[1] == '4' && ext[2] == '8'
+            && (tolower(ext[3]) == 's' || tolower(ext[3]) == 'b')
             && !ext[4];
     return false;
 }
@@ -695,6 +727,8 @@ int menu_item_run(uint8_t menu_id)
     case MI_48STATE_MERGE: ret = state_load(true);                      break;
     case MI_48STATE_SAVE:  ret = state_save();                          break;
     case MI_48STATE_CLEAN: ret = state_clear();                         break;
+    case MI_48STATE_SNAP_LOAD: ret = state_load(false, ".48B");         break;
+    case MI_48STATE_SNAP_SAVE: ret = state_save(".48B");                break;
 
     case MI_DB48_FLASH:
         Settings.SilentBeepOn(!Settings.SilentBeepOn());                break;
@@ -779,6 +813,8 @@ cstring menu_item_description(uint8_t menu_id, char *s, const int UNUSED len)
     case MI_48STATE_MERGE:              ln = "Merge State";             break;
     case MI_48STATE_SAVE:               ln = "Save State";              break;
     case MI_48STATE_CLEAN:              ln = "Clear state";             break;
+    case MI_48STATE_SNAP_LOAD:          ln = "Load Snapshot";           break;
+    case MI_48STATE_SNAP_SAVE:          ln = "Save Snapshot";           break;
 
     case MI_48STATUS:                   ln = "Status bar >";            break;
     case MI_48STATUS_DAY_OF_WEEK:
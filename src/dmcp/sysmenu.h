@@ -50,6 +50,8 @@ enum menu_item
     MI_48STATE_LOAD,            // Load a state from disk
     MI_48STATE_MERGE,           // Merge a state from disk
     MI_48STATE_SAVE,            // Save state to disk
+    MI_48STATE_SNAP_LOAD,       // Load a binary snapshot from disk
+    MI_48STATE_SNAP_SAVE,       // Save a binary snapshot to disk
 
     MI_48STATUS,                // Status bar menu
     MI_48STATUS_TIME,           // Display time
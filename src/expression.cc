@@ -35,6 +35,7 @@
 #include "finance.h"
 #include "functions.h"
 #include "grob.h"
+#include "hash.h"
 #include "integer.h"
 #include "parser.h"
 #include "polynomial.h"
@@ -1245,6 +1246,292 @@ static size_t check_match(size_t eq, size_t eqsz,
 }
 
 
+void expression::operators::scan(expression_p eq)
+// ----------------------------------------------------------------------------
+//   Record the types of the objects at the top level of the equation
+// ----------------------------------------------------------------------------
+//   This is where the first object in a pattern is compared in check_match
+{
+    memset(bits, 0, sizeof(bits));
+    if (eq)
+    {
+        for (object_p obj : *eq)
+        {
+            uint ty = obj->type();
+            bits[ty / 32] |= 1U << (ty % 32);
+        }
+    }
+}
+
+
+struct rewrite_memo
+// ----------------------------------------------------------------------------
+//   Results of recent rewrites, which are kept across commands
+// ----------------------------------------------------------------------------
+//   Simplifying or differentiating the same expression again, e.g. when
+//   symbolic arithmetic runs auto-simplification, returns the earlier result.
+//   The key records what a rewrite may depend on besides the expression:
+//   the rules, the settings, the independent variable, the funcall hooks and
+//   the current directory. Variables are covered by `memo_flush()`, which is
+//   called whenever a variable changes.
+{
+    enum { ENTRIES = 8, MAX_BYTES = 512 };
+
+    struct entry
+    {
+        const byte_p                *rules;
+        uint                         hash;
+        directory_p                  dir;
+        expression::funcall_match_fn match;
+        expression::funcall_build_fn build;
+        symbol_g                     indep;
+        expression_g                 input;
+        expression_g                 result;
+    };
+
+    entry entries[ENTRIES];
+    uint  next;
+};
+static rewrite_memo *RewriteMemo = nullptr;
+
+
+static bool memo_pure(object::id ty)
+// ----------------------------------------------------------------------------
+//   Check if an object in an expression always rewrites the same way
+// ----------------------------------------------------------------------------
+//   Commands are listed one by one, so that reordering ids.tbl has no effect.
+//   Commands that evaluate user code, like Root, Integrate, Sum or Where,
+//   are not listed, since the result depends on more than the expression.
+{
+    if (object::is_algebraic_num(ty))
+        return true;
+    switch (ty)
+    {
+    case object::ID_add:
+    case object::ID_subtract:
+    case object::ID_multiply:
+    case object::ID_divide:
+    case object::ID_mod:
+    case object::ID_rem:
+    case object::ID_pow:
+    case object::ID_neg:
+    case object::ID_abs:
+    case object::ID_inv:
+    case object::ID_sqrt:
+    case object::ID_sq:
+    case object::ID_cubed:
+    case object::ID_True:
+    case object::ID_False:
+    case object::ID_And:
+    case object::ID_Or:
+    case object::ID_Xor:
+    case object::ID_Not:
+    case object::ID_same:
+    case object::ID_TestSame:
+    case object::ID_TestLT:
+    case object::ID_TestEQ:
+    case object::ID_TestGT:
+    case object::ID_TestLE:
+    case object::ID_TestNE:
+    case object::ID_TestGE:
+    case object::ID_asin:
+    case object::ID_acos:
+    case object::ID_atan:
+    case object::ID_sin:
+    case object::ID_cos:
+    case object::ID_tan:
+    case object::ID_log:
+    case object::ID_exp:
+    case object::ID_log10:
+    case object::ID_exp10:
+    case object::ID_ToDecimal:
+    case object::ID_ToFraction:
+    case object::ID_asinh:
+    case object::ID_acosh:
+    case object::ID_atanh:
+    case object::ID_sinh:
+    case object::ID_cosh:
+    case object::ID_tanh:
+    case object::ID_log1p:
+    case object::ID_expm1:
+    case object::ID_log2:
+    case object::ID_exp2:
+    case object::ID_erf:
+    case object::ID_erfc:
+    case object::ID_tgamma:
+    case object::ID_lgamma:
+    case object::ID_fact:
+    case object::ID_comb:
+    case object::ID_perm:
+    case object::ID_cbrt:
+    case object::ID_hypot:
+    case object::ID_atan2:
+    case object::ID_xroot:
+    case object::ID_sign:
+    case object::ID_IntPart:
+    case object::ID_FracPart:
+    case object::ID_ceil:
+    case object::ID_floor:
+    case object::ID_Round:
+    case object::ID_Truncate:
+    case object::ID_mant:
+    case object::ID_xpon:
+    case object::ID_SigDig:
+    case object::ID_Percent:
+    case object::ID_PercentChange:
+    case object::ID_PercentTotal:
+    case object::ID_Min:
+    case object::ID_Max:
+    case object::ID_re:
+    case object::ID_im:
+    case object::ID_arg:
+    case object::ID_conj:
+    case object::ID_dot:
+    case object::ID_cross:
+    case object::ID_det:
+    case object::ID_constant:
+    case object::ID_Derivative:
+    case object::ID_Primitive:
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+static bool memo_same(object_p x, object_p y)
+// ----------------------------------------------------------------------------
+//   Compare two objects byte for byte
+// ----------------------------------------------------------------------------
+{
+    if (x == y)
+        return true;
+    if (!x || !y)
+        return false;
+    size_t sz = x->size();
+    return sz == y->size() && memcmp(x, y, sz) == 0;
+}
+
+
+expression_p expression::memo_lookup(const byte_p rules[],
+                                     expression_p eq,
+                                     uint        &hash)
+// ----------------------------------------------------------------------------
+//   Lookup the result of applying some rules to an expression
+// ----------------------------------------------------------------------------
+//   On return, `hash` is zero if the result cannot be memoized
+{
+    hash = 0;
+    if (!eq || independent_value || dependent_value)
+        return nullptr;
+    size_t sz = eq->size();
+    if (sz > rewrite_memo::MAX_BYTES)
+        return nullptr;
+
+    for (object_p obj : *eq)
+    {
+        id ty = obj->type();
+        if (ty == ID_symbol)
+        {
+            // A variable may contain a program with side effects
+            if (object_p value = directory::recall_all(obj, false))
+                if (!is_algebraic_num(value->type()))
+                    return nullptr;
+        }
+        else if (!memo_pure(ty))
+        {
+            return nullptr;
+        }
+    }
+
+    symbol_p         indep = independent ? +*independent : nullptr;
+    directory_p      dir   = rt.variables(0);
+    funcall_match_fn match = funcall_match;
+    funcall_build_fn build = funcall_build;
+    uintptr_t        rs    = uintptr_t(rules);
+    uint             sh    = Settings.hash();
+    uint             h     = FNV1A_BASIS;
+    h = fnv1a(h, &rs, sizeof(rs));
+    h = fnv1a(h, &dir, sizeof(dir));
+    h = fnv1a(h, &match, sizeof(match));
+    h = fnv1a(h, &build, sizeof(build));
+    h = fnv1a(h, &sh, sizeof(sh));
+    if (indep)
+        h = fnv1a(h, indep, indep->size());
+    h = fnv1a(h, eq, sz);
+    hash = h | 1;
+
+    if (rewrite_memo *memo = RewriteMemo)
+    {
+        for (rewrite_memo::entry &e : memo->entries)
+        {
+            if (e.hash == hash && e.rules == rules && e.dir == dir &&
+                e.match == match && e.build == build &&
+                memo_same(+e.input, eq) && memo_same(+e.indep, indep))
+            {
+                record(rewrites, "Memoized %t", +e.result);
+                return e.result;
+            }
+        }
+    }
+    return nullptr;
+}
+
+
+void expression::memo_store(const byte_p rules[], uint hash,
+                            expression_p eq, expression_p result)
+// ----------------------------------------------------------------------------
+//   Remember the result of a rewrite
+// ----------------------------------------------------------------------------
+{
+    if (!hash || !result || rt.error())
+        return;
+    rewrite_memo *memo = RewriteMemo;
+    if (!memo)
+    {
+        // operator new support purposefully not linked in embedded versions
+        memo = (rewrite_memo *) malloc(sizeof(rewrite_memo));
+        if (!memo)
+            return;
+        new(memo) rewrite_memo();
+        RewriteMemo = memo;
+    }
+
+    rewrite_memo::entry &e = memo->entries[memo->next];
+    memo->next = (memo->next + 1) % rewrite_memo::ENTRIES;
+    e.rules  = rules;
+    e.hash   = hash;
+    e.dir    = rt.variables(0);
+    e.match  = funcall_match;
+    e.build  = funcall_build;
+    e.indep  = independent ? +*independent : nullptr;
+    e.input  = eq;
+    e.result = result;
+
+    // The memoized objects must survive the current command
+    cleaner::disable();
+}
+
+
+void expression::memo_flush()
+// ----------------------------------------------------------------------------
+//   Forget all memoized rewrites, e.g. when a variable changes
+// ----------------------------------------------------------------------------
+{
+    if (rewrite_memo *memo = RewriteMemo)
+    {
+        for (rewrite_memo::entry &e : memo->entries)
+        {
+            e.rules  = nullptr;
+            e.hash   = 0;
+            e.indep  = nullptr;
+            e.input  = nullptr;
+            e.result = nullptr;
+        }
+    }
+}
+
+
 expression_p expression::rewrite(expression_r from,
                                  expression_r to,
                                  expression_r cond,
@@ -1284,6 +1571,7 @@ expression_p expression::rewrite(expression_r from,
         size_t eqst = 0, fromst = 0;
 
         replaced = false;
+        matchsz  = 0;
 
         // Expand 'from' on the stack and remember where it starts
         if (!from->expand_without_size())
@@ -1298,11 +1586,20 @@ expression_p expression::rewrite(expression_r from,
         // Keep checking sub-expressions until we find a match
         size_t eqlen = eqsz;
         fromst = eqst + eqsz;
+
+        // Type of the outermost object in the pattern, if not a wildcard
+        object_p ftop = rt.stack(fromst);
+        id       fty  = ftop ? ftop->type() : ID_symbol;
+        if (fty == ID_symbol)
+            fty = ID_object;
+
         if (down)
         {
             // Check if there is a match in sub-equations going down
             for (eqsz = eqlen; eqsz; eqst++, eqsz--)
             {
+                if (fty && rt.stack(eqst)->type() != fty)
+                    continue;
                 matchsz = check_match(eqst, eqsz, fromst, fromsz,
                                       cond, locals);
                 if (matchsz || interrupted())
@@ -1317,6 +1614,8 @@ expression_p expression::rewrite(expression_r from,
             {
                 for (eqst = eqstart; eqst + eqsz <= eqlen; eqst++)
                 {
+                    if (fty && rt.stack(eqst)->type() != fty)
+                        continue;
                     matchsz = check_match(eqst, eqsz, fromst, fromsz,
                                           cond, locals);
                     if (matchsz || interrupted())
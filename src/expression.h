@@ -188,17 +188,52 @@ struct expression : program
     enum rwconds        { ALWAYS,       CONDITIONAL };
     enum rwdir          { DOWN,         UP };
 
+    struct operators
+    // ------------------------------------------------------------------------
+    //   Set of object types at the top level of an equation
+    // ------------------------------------------------------------------------
+    //   A rewrite rule can only match if the equation contains an object
+    //   of the same type as the outermost object in the rule's pattern
+    {
+        void scan(expression_p eq);
+        bool may_match(uint top) const
+        {
+            // A wildcard at the top of a pattern can match anything
+            return top == ID_symbol || (bits[top / 32] >> (top % 32)) & 1;
+        }
+        uint32_t bits[(NUM_IDS + 31) / 32];
+    };
+
+    // Memoization of the result of a set of rewrites
+    static expression_p memo_lookup(const byte_p rules[], expression_p eq,
+                                    uint &hash);
+    static void         memo_store(const byte_p rules[], uint hash,
+                                   expression_p eq, expression_p result);
+    static void         memo_flush();
+
     template<rwdir down=DOWN, rwconds conds=ALWAYS, rwrepeat rep=REPEAT>
-    expression_p do_rewrites(size_t       size,
-                             const byte_p rewrites[],
-                             uint        *count = nullptr) const
+    expression_p do_rewrites(size_t         size,
+                             const byte_p   rewrites[],
+                             const uint16_t tops[],
+                             uint          *count = nullptr) const
     // ------------------------------------------------------------------------
     //   Apply a series of rewrites
     // ------------------------------------------------------------------------
+    //   The `tops` array gives the type of the outermost object in each
+    //   pattern, which lets us skip rules that cannot match the equation
     {
+        uint         hash    = 0;
+        if (!count)
+            if (expression_p known = memo_lookup(rewrites, this, hash))
+                return known;
+
         uint         rwcount = rep ? Settings.MaxRewrites() : 1;
+        uint         cindex  = constant_index;
+        expression_g input   = this;
         expression_g eq      = this;
         expression_g last    = nullptr;
+        expression_g scanned = nullptr;
+        operators    present;
         bool         intr    = false;
         settings::SaveExplicitWildcards ewc(false);
         settings::SaveAutoSimplify as(false);
@@ -208,6 +243,13 @@ struct expression : program
 
             for (size_t i = 0; i < size; i += conds ? 3 : 2)
             {
+                if (+scanned != +eq)
+                {
+                    present.scan(eq);
+                    scanned = eq;
+                }
+                if (!present.may_match(tops[i]))
+                    continue;
                 eq = eq->rewrite(expression_p(rewrites[i+0]),
                                  expression_p(rewrites[i+1]),
                                  expression_p(conds ? rewrites[i+2] : nullptr),
@@ -224,6 +266,8 @@ struct expression : program
 
         if (rep && !rwcount)
             rt.too_many_rewrites_error();
+        else if (hash && !intr && constant_index == cindex)
+            memo_store(rewrites, hash, input, eq);
         return eq;
     }
 
@@ -231,8 +275,9 @@ struct expression : program
               typename ...args>
     expression_p rewrites(args... rest) const
     {
-        static constexpr byte_p rwdata[] = { rest.as_bytes()... };
-        return do_rewrites<down,conds,rep>(sizeof...(rest), rwdata, nullptr);
+        static constexpr byte_p   rwdata[] = { rest.as_bytes()... };
+        static constexpr uint16_t rwtops[] = { rest.outermost()... };
+        return do_rewrites<down,conds,rep>(sizeof...(rest), rwdata, rwtops);
     }
 
 
@@ -431,6 +476,49 @@ struct eq
         return expression_p(object_data);
     }
 
+    // Decode a LEB128 value in the object data
+    static constexpr uint leb_at(size_t &i)
+    {
+        uint value = 0;
+        uint shift = 0;
+        byte b     = 128;
+        while (b & 128)
+        {
+            b = object_data[i++];
+            value |= uint(b & 127) << shift;
+            shift += 7;
+        }
+        return value;
+    }
+
+    // Type of the outermost (last) object, used to index rewrite rules
+    static constexpr uint16_t outermost()
+    {
+        size_t i  = 2;
+        uint   ty = object::ID_object;
+        while (i < sizeof(object_data))
+        {
+            ty = leb_at(i);
+            switch (ty)
+            {
+            case object::ID_symbol:
+            case object::ID_funcall:
+            {
+                size_t len = leb_at(i);
+                i += len;
+                break;
+            }
+            case object::ID_integer:
+            case object::ID_neg_integer:
+                leb_at(i);
+                break;
+            default:
+                break;
+            }
+        }
+        return uint16_t(ty);
+    }
+
     // Negation operation
     eq<args..., leb(object::ID_neg)>
     operator-()         { return eq<args..., leb(object::ID_neg)>(); }
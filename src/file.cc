@@ -34,6 +34,7 @@
 #include "text.h"
 #include "utf8.h"
 
+#include <sys/stat.h>
 #include <unistd.h>
 
 
@@ -268,6 +269,38 @@ bool file::read(char *buf, size_t len)
 }
 
 
+uint file::size()
+// ----------------------------------------------------------------------------
+//   Return the size of the file
+// ----------------------------------------------------------------------------
+{
+#if SIMULATOR
+    struct stat st;
+    if (data && fstat(fileno(data), &st) == 0)
+        return st.st_size;
+    return 0;
+#else
+    return f_size(&data);
+#endif
+}
+
+
+uint file::modified()
+// ----------------------------------------------------------------------------
+//   Return the modification time of the file, 0 if not known
+// ----------------------------------------------------------------------------
+//   DMCP only exposes timestamps through a directory lookup, which is
+//   about as expensive as what we try to save, so we rely on the size
+{
+#if SIMULATOR
+    struct stat st;
+    if (data && fstat(fileno(data), &st) == 0)
+        return st.st_mtime;
+#endif
+    return 0;
+}
+
+
 char file::getchar()
 // ----------------------------------------------------------------------------
 //   Read char code at offset
@@ -62,6 +62,8 @@ struct file
     bool    put(char c);
     bool    write(const char *buf, size_t len);
     bool    read(char *buf, size_t len);
+    uint    size();
+    uint    modified();
     unicode get();
     unicode get(uint offset);
     char    getchar();
@@ -114,7 +114,7 @@ static uint32_t computed_checksum = 0;
 static byte     file_magic[]      = FILE_MAGIC;
 
 
-static uint32_t id_checksum()
+uint32_t files::id_checksum()
 // ----------------------------------------------------------------------------
 //   A checksum of all ID names, used to identify changes in binary format
 // ----------------------------------------------------------------------------
@@ -121,15 +121,39 @@ struct font_cache
 // ----------------------------------------------------------------------------
 //   A data structure to accelerate access to font offsets for a given font
 // ----------------------------------------------------------------------------
+//   There are two levels of acceleration:
+//   - A direct-mapped glyph cache, indexed by a hash of the font and code
+//     point, records the metrics and bitmap of recently used glyphs.
+//   - A glyph index, built the first time a sparse or dense font is used,
+//     records where every BLOCK_SIZE-th glyph is in the font data. On a miss
+//     in the glyph cache, we decode at most BLOCK_SIZE glyph records instead
+//     of scanning the font from the start.
+//   Both are allocated at startup, before the runtime takes the free memory.
+//   If there is no room left in the index for a font, we scan the font data.
 {
     // Use same size as font data
     using fint  = font::fint;
     using fuint = font::fuint;
 
-    enum { MAX_GLYPHS = 128 };
-
-    font_cache(): cache((data *) malloc(sizeof(data) * MAX_GLYPHS)), size(0) { }
-    ~font_cache() { free(cache); }
+    enum
+    {
+        MAX_GLYPHS = 128,       // Entries in the glyph cache
+        MAX_FONTS  = 8,         // Fonts that can be indexed
+        MAX_BLOCKS = 256,       // Index entries, shared by all fonts
+        BLOCK_SIZE = 16,        // Glyphs between two index entries
+    };
+
+    font_cache()
+        : cache((data *) calloc(MAX_GLYPHS, sizeof(data))),
+          blocks((block *) malloc(MAX_BLOCKS * sizeof(block))),
+          fonts(),
+          used(0)
+    {}
+    ~font_cache()
+    {
+        free(cache);
+        free(blocks);
+    }
 
 
     struct data
@@ -167,29 +191,49 @@ struct font_cache
     } __attribute((packed))__;
 
 
+    struct block
+    // ------------------------------------------------------------------------
+    //   An entry in the glyph index
+    // ------------------------------------------------------------------------
+    {
+        unicode  codepoint;     // First code point in the block
+        uint32_t offset;        // Offset of its glyph record in the font
+        fuint    left;          // Code points left in range, including it
+        fint     x;             // X position in bitmap (dense fonts)
+    };
+
+
+    struct index
+    // ------------------------------------------------------------------------
+    //   The glyph index for a given font
+    // ------------------------------------------------------------------------
+    {
+        font_p  font;           // Font being indexed
+        block  *first;          // First index entry for that font
+        uint    count;          // Number of entries, 0 if font not indexed
+    };
+
+
+    static size_t hash(font_p font, unicode codepoint)
+    // ------------------------------------------------------------------------
+    //   Slot in the glyph cache for a given glyph
+    // ------------------------------------------------------------------------
+    //   Consecutive code points in a font go to consecutive slots
+    {
+        return (codepoint + (uintptr_t(font) >> 4) * 37) % MAX_GLYPHS;
+    }
+
+
     data *lookup(font_p font, unicode codepoint)
     // ------------------------------------------------------------------------
-    //   Lookup data in the LRU cache
+    //   Lookup data in the glyph cache
     // ------------------------------------------------------------------------
     {
-        if (size)
-        {
-            size_t count = size < MAX_GLYPHS ? size : size_t(MAX_GLYPHS);
-            data  *last  = cache + (size + ~0) % MAX_GLYPHS;
-            data  *d     = last;
-            for (size_t i = 0; i < count; i++)
-            {
-                if (d->font == font && d->codepoint == codepoint)
-                {
-                    // Bring it back to front for faster lookup next
-                    if (i > 0)
-                        std::swap(*d, *last);
-                    return last;
-                }
-                if (d-- < cache)
-                    d = cache + count - 1;
-            }
-        }
+        if (!cache)
+            return nullptr;
+        data *d = cache + hash(font, codepoint);
+        if (d->font == font && d->codepoint == codepoint)
+            return d;
         return nullptr;
     }
 
@@ -203,17 +247,135 @@ struct font_cache
                  fuint   h,
                  fuint   advance)
     // ------------------------------------------------------------------------
-    //   Insert a new entry in the cache
+    //   Insert a new entry in the cache, replacing whatever was in the slot
+    // ------------------------------------------------------------------------
+    {
+        if (!cache)
+        {
+            // No cache: use a single entry so that the caller can proceed
+            static data single;
+            single.set(font, codepoint, bitmap, x, y, w, h, advance);
+            return &single;
+        }
+        data *d = cache + hash(font, codepoint);
+        d->set(font, codepoint, bitmap, x, y, w, h, advance);
+        return d;
+    }
+
+
+    const block *find(font_p font, byte_p ranges, bool dense, unicode cp)
+    // ------------------------------------------------------------------------
+    //   Find the last index entry at or before the given code point
     // ------------------------------------------------------------------------
+    //   The `ranges` argument points to the first code point range in the font
     {
-        data *last = cache + (size++ % MAX_GLYPHS);
-        last->set(font, codepoint, bitmap, x, y, w, h, advance);
-        return last;
+        index *ix = indexed(font, ranges, dense);
+        if (!ix)
+            return nullptr;
+
+        // Binary search for the last block starting at or before cp
+        const block *lo = ix->first;
+        const block *hi = lo + ix->count;
+        if (cp < lo->codepoint)
+            return nullptr;
+        while (hi - lo > 1)
+        {
+            const block *mid = lo + (hi - lo) / 2;
+            if (mid->codepoint <= cp)
+                lo = mid;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+
+    index *indexed(font_p font, byte_p ranges, bool dense)
+    // ------------------------------------------------------------------------
+    //   Return the index for a font, building it the first time
+    // ------------------------------------------------------------------------
+    {
+        index *last = fonts + MAX_FONTS;
+        for (index *ix = fonts; ix < last; ix++)
+        {
+            if (ix->font == font)
+                return ix->count ? ix : nullptr;
+            if (!ix->font)
+            {
+                build(ix, font, ranges, dense);
+                return ix->count ? ix : nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    void build(index *ix, font_p font, byte_p ranges, bool dense)
+    // ------------------------------------------------------------------------
+    //   Build the glyph index for a font
+    // ------------------------------------------------------------------------
+    {
+        ix->font  = font;
+        ix->first = blocks + used;
+        ix->count = 0;
+        if (!blocks)
+            return;
+
+        byte_p p = ranges;
+        fint   x = 0;
+        uint   n = 0;
+        while (true)
+        {
+            fuint firstCP = leb128<fuint>(p);
+            fuint numCPs  = leb128<fuint>(p);
+            if (!firstCP && !numCPs)
+                break;
+
+            for (fuint i = 0; i < numCPs; i++)
+            {
+                if (n++ % BLOCK_SIZE == 0)
+                {
+                    if (used >= MAX_BLOCKS)
+                    {
+                        record(font_cache,
+                               "No room to index font %p, %u glyphs indexed",
+                               font, n);
+                        used -= ix->count;
+                        ix->count = 0;
+                        return;
+                    }
+                    block &b    = blocks[used++];
+                    b.codepoint = firstCP + i;
+                    b.offset    = p - byte_p(font);
+                    b.left      = numCPs - i;
+                    b.x         = x;
+                    ix->count++;
+                }
+
+                if (dense)
+                {
+                    x += leb128<fuint>(p);
+                }
+                else
+                {
+                    leb128<fint>(p);
+                    leb128<fint>(p);
+                    fuint w = leb128<fuint>(p);
+                    fuint h = leb128<fuint>(p);
+                    leb128<fuint>(p);
+                    p += (w * h + 7) / 8;
+                }
+            }
+        }
+        record(font_cache, "Indexed font %p, %u glyphs in %u blocks",
+               font, n, ix->count);
     }
 
 private:
     data  *cache;
-    size_t size;
+    block *blocks;
+    index  fonts[MAX_FONTS];
+    uint   used;
 } FontCache;
 
 
@@ -263,45 +425,52 @@ bool sparse_font::glyph(unicode codepoint, glyph_info &g) const
     byte_p            p      = payload();
     size_t UNUSED     size   = leb128<size_t>(p);
     fuint             height = leb128<fuint>(p);
-    bool              fixed  = (codepoint <= '9' && codepoint > '0' &&
-                                Settings.FixedWidthDigits());
-    fuint             digitWidth = 0;
 
     // Check if cached
     font_cache::data *data = FontCache.lookup(this, codepoint);
 
     record(sparse_fonts, "Looking up %u, got cache %p", codepoint, data);
-    while (!data)
+    if (!data)
     {
-        // Check code point range
-        fuint firstCP = leb128<fuint>(p);
-        fuint numCPs  = leb128<fuint>(p);
-        record(sparse_fonts,
-               "  Range %u-%u (%u codepoints)",
-               firstCP, firstCP + numCPs, numCPs);
-
-        // Check end of font ranges, or if past current codepoint
-        if ((!firstCP && !numCPs) || firstCP > codepoint)
+        // Start from the closest glyph in the index, if any
+        fuint cp   = 0;
+        fuint left = 0;
+        if (const font_cache::block *b = FontCache.find(this, p, false,
+                                                        codepoint))
         {
-            record(sparse_fonts, "Code point %u not found", codepoint);
-            return false;
+            p    = byte_p(this) + b->offset;
+            cp   = b->codepoint;
+            left = b->left;
         }
 
-        // Initialize cache for range of current code point
-        fuint lastCP = firstCP + numCPs;
-        for (fuint cp = firstCP; cp < lastCP; cp++)
+        while (!data)
         {
+            if (!left)
+            {
+                // Check code point range
+                fuint firstCP = leb128<fuint>(p);
+                fuint numCPs  = leb128<fuint>(p);
+                record(sparse_fonts,
+                       "  Range %u-%u (%u codepoints)",
+                       firstCP, firstCP + numCPs, numCPs);
+
+                // Check end of font ranges, or if past current codepoint
+                if ((!firstCP && !numCPs) || firstCP > codepoint)
+                {
+                    record(sparse_fonts, "Code point %u not found", codepoint);
+                    return false;
+                }
+                cp   = firstCP;
+                left = numCPs;
+            }
+
             fint  x = leb128<fint>(p);
             fint  y = leb128<fint>(p);
             fuint w = leb128<fuint>(p);
             fuint h = leb128<fuint>(p);
             fuint a = leb128<fuint>(p);
-            if (fixed && cp >= '1' && cp <= '9')
-                a = digitWidth;
             if (cp == codepoint)
                 data = FontCache.insert(this, codepoint, p, x, y, w, h, a);
-            else if (fixed && cp == '0')
-                digitWidth = a;
 
             size_t sparseBitmapBits = w * h;
             size_t sparseBitmapBytes = (sparseBitmapBits + 7) / 8;
@@ -313,6 +482,8 @@ bool sparse_font::glyph(unicode codepoint, glyph_info &g) const
             record(sparse_fonts,
                    "  cp %u x=%u y=%u w=%u h=%u bitmap=%p %u bytes",
                    cp, x, y, w, h, p - sparseBitmapBytes, sparseBitmapBytes);
+            cp++;
+            left--;
         }
     }
 
@@ -327,6 +498,12 @@ bool sparse_font::glyph(unicode codepoint, glyph_info &g) const
     g.h       = data->h;
     g.advance = data->advance;
     g.height  = height;
+    if (codepoint > '0' && codepoint <= '9' && Settings.FixedWidthDigits())
+    {
+        glyph_info zero;
+        if (glyph('0', zero))
+            g.advance = zero.advance;
+    }
     record(sparse_fonts,
            "For glyph %u, x=%u y=%u w=%u h=%u bw=%u bh=%u adv=%u hgh=%u",
            codepoint, g.x, g.y, g.w, g.h, g.bw, g.bh, g.advance, g.height);
@@ -358,41 +535,53 @@ bool dense_font::glyph(unicode codepoint, glyph_info &g) const
     fuint             height     = leb128<fuint>(p);
     fuint             width      = leb128<fuint>(p);
     byte_p            bitmap     = p;
-    bool              fixed  = (codepoint <= '9' && codepoint > '0' &&
-                                Settings.FixedWidthDigits());
-    fuint             digitWidth = 0;
 
     // Check if cached
     font_cache::data *data = FontCache.lookup(this, codepoint);
 
     // Scan the font data
-    fint   x          = 0;
     size_t bitmapSize = (height * width + 7) / 8;
     p += bitmapSize;
-    while (!data)
+    if (!data)
     {
-        // Check code point range
-        fuint firstCP = leb128<fuint>(p);
-        fuint numCPs  = leb128<fuint>(p);
-
-        // Check end of font ranges, or if past current codepoint
-        if ((!firstCP && !numCPs) || firstCP > codepoint)
+        // Start from the closest glyph in the index, if any
+        fint  x    = 0;
+        fuint cp   = 0;
+        fuint left = 0;
+        if (const font_cache::block *b = FontCache.find(this, p, true,
+                                                        codepoint))
         {
-            record(dense_fonts, "Code point %u not found", codepoint);
-            return false;
+            p    = byte_p(this) + b->offset;
+            cp   = b->codepoint;
+            left = b->left;
+            x    = b->x;
         }
 
-        fuint lastCP = firstCP + numCPs;
-        for (fuint cp = firstCP; cp < lastCP; cp++)
+        while (!data)
         {
+            if (!left)
+            {
+                // Check code point range
+                fuint firstCP = leb128<fuint>(p);
+                fuint numCPs  = leb128<fuint>(p);
+
+                // Check end of font ranges, or if past current codepoint
+                if ((!firstCP && !numCPs) || firstCP > codepoint)
+                {
+                    record(dense_fonts, "Code point %u not found", codepoint);
+                    return false;
+                }
+                cp   = firstCP;
+                left = numCPs;
+            }
+
             fuint cw  = leb128<fuint>(p);
-            fuint adv = fixed && cp >= '1' && cp <= '9' ? digitWidth : cw;
             if (cp == codepoint)
                 data = FontCache.insert(this, cp,
-                                        bitmap, x, 0, cw, height, adv);
-            else if (fixed && cp == '0')
-                digitWidth = cw;
+                                        bitmap, x, 0, cw, height, cw);
             x += cw;
+            cp++;
+            left--;
         }
     }
     g.bitmap  = bitmap;
@@ -406,6 +595,12 @@ bool dense_font::glyph(unicode codepoint, glyph_info &g) const
     g.h       = height;
     g.advance = data->advance;
     g.height  = height;
+    if (codepoint > '0' && codepoint <= '9' && Settings.FixedWidthDigits())
+    {
+        glyph_info zero;
+        if (glyph('0', zero))
+            g.advance = zero.advance;
+    }
     return true;
 }
 
@@ -0,0 +1,73 @@
+#ifndef HASH_H
+#define HASH_H
+// ****************************************************************************
+//  hash.h                                                        DB48X project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     FNV-1a hashing, shared by the various caches, memos and indexes
+//
+//
+//
+//
+//
+//
+//
+//
+// ****************************************************************************
+//   (C) 2022 Christophe de Dinechin <christophe@dinechin.org>
+//   This software is licensed under the terms outlined in LICENSE.txt
+// ****************************************************************************
+//   This file is part of DB48X.
+//
+//   DB48X is free software: you can redistribute it and/or modify
+//   it under the terms outlined in the LICENSE.txt file
+//
+//   DB48X is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// ****************************************************************************
+//
+//   The help index is generated on the host with these functions, so the
+//   values they compute must not change.
+
+#include "types.h"
+
+#include <cstdint>
+
+
+const uint32_t FNV1A_BASIS = 0x811C9DC5U;       // FNV-1a offset basis
+const uint32_t FNV1A_PRIME = 0x01000193U;       // FNV-1a 32-bit prime
+
+
+inline uint32_t fnv1a(uint32_t hash, uint32_t value)
+// ----------------------------------------------------------------------------
+//   Mix a single value, normally a byte, into a hash
+// ----------------------------------------------------------------------------
+{
+    return (hash ^ value) * FNV1A_PRIME;
+}
+
+
+inline uint32_t fnv1a(uint32_t hash, const void *data, size_t size)
+// ----------------------------------------------------------------------------
+//   Mix some bytes into a hash
+// ----------------------------------------------------------------------------
+{
+    byte_p bytes = byte_p(data);
+    for (size_t i = 0; i < size; i++)
+        hash = fnv1a(hash, bytes[i]);
+    return hash;
+}
+
+
+inline uint32_t fnv1a(const void *data, size_t size)
+// ----------------------------------------------------------------------------
+//   Hash some bytes
+// ----------------------------------------------------------------------------
+{
+    return fnv1a(FNV1A_BASIS, data, size);
+}
+
+#endif // HASH_H
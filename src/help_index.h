@@ -0,0 +1,109 @@
+#ifndef HELP_INDEX_H
+#define HELP_INDEX_H
+// ****************************************************************************
+//  help_index.h                                                  DB48X project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Binary index of the topics in the help file
+//
+//     The index is generated at build time by tools/helpindex, and used by
+//     user_interface::load_help to find a topic with a couple of file reads
+//     instead of scanning the whole help file or a text index.
+//
+//     The file is made of 32-bit little-endian words:
+//     - The MAGIC number
+//     - The number of entries N
+//     - BUCKETS+1 bucket starts, i.e. the index of the first entry whose
+//       hash has a given top byte, followed by N
+//     - N entries, sorted by hash, level, PREFIX flag and position,
+//       so that the first match is the main section for a topic.
+//       Each entry is made of:
+//       + The hash of the topic text, see hash() below
+//       + The position of the topic line in the help file, with the
+//         PREFIX flag and the topic level in the top bits
+//
+// ****************************************************************************
+//   (C) 2024 Christophe de Dinechin <christophe@dinechin.org>
+//   This software is licensed under the terms outlined in LICENSE.txt
+// ****************************************************************************
+//   This file is part of DB48X.
+//
+//   DB48X is free software: you can redistribute it and/or modify
+//   it under the terms outlined in the LICENSE.txt file
+//
+//   DB48X is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// ****************************************************************************
+
+#include "hash.h"
+#include "types.h"
+
+
+struct help_index
+// ----------------------------------------------------------------------------
+//   Layout of the binary help index
+// ----------------------------------------------------------------------------
+//   Topics are lines beginning with one or more '#' (the level being the
+//   number of '#'), and solver variables, lines like "* `Var`" (level 0).
+//   For topics of level 2 or more, when the text begins with a word followed
+//   by more text, there is an additional PREFIX entry for that first word.
+//   This lets us find "## ABS and friends" when looking up a spelling of ABS.
+{
+    enum : uint32_t
+    {
+        MAGIC       = 0x58444948,       // "HIDX" in little-endian
+        BUCKETS     = 256,              // Buckets indexed by hash top byte
+        HEADER      = 2 + BUCKETS + 1,  // Words before the first entry
+        POSITION    = 0x07FFFFFF,       // Mask for the position in help file
+        PREFIX      = 0x08000000,       // Entry for the first word of a topic
+        LEVEL_SHIFT = 28,               // Shift for the topic level
+    };
+
+    struct entry
+    {
+        uint32_t hash;                  // Hash of the topic text
+        uint32_t data;                  // Position, flags and level
+
+        uint     position() const       { return data & POSITION; }
+        uint     level() const          { return data >> LEVEL_SHIFT; }
+        bool     prefix() const         { return data & PREFIX; }
+    };
+
+
+    static uint32_t hash(const byte *text, size_t len)
+    // ------------------------------------------------------------------------
+    //   Hash a topic, ignoring case and treating '-' like ' '
+    // ------------------------------------------------------------------------
+    //   This matches markdown hyperlink style, e.g. (#some-topic).
+    //   Solver variables like `Var` are case-sensitive and hashed as is.
+    {
+        uint32_t result = FNV1A_BASIS;
+        bool     fold   = len && text[0] != '`';
+        for (size_t i = 0; i < len; i++)
+        {
+            byte c = text[i];
+            if (!fold)
+                ;
+            else if (c >= 'A' && c <= 'Z')
+                c += 'a' - 'A';
+            else if (c == '-')
+                c = ' ';
+            result = fnv1a(result, c);
+        }
+        return result;
+    }
+
+
+    static uint bucket(uint32_t hash)
+    // ------------------------------------------------------------------------
+    //   Bucket for a given hash
+    // ------------------------------------------------------------------------
+    {
+        return hash >> 24;
+    }
+};
+
+#endif // HELP_INDEX_H
@@ -0,0 +1,571 @@
+// ****************************************************************************
+//  hwmatrix.cc                                                   DB48X project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Dense matrices of hardware floating-point values
+//
+//
+//
+//
+//
+//
+// ****************************************************************************
+//   (C) 2024 Christophe de Dinechin <christophe@dinechin.org>
+//   This software is licensed under the terms outlined in LICENSE.txt
+// ****************************************************************************
+//   This file is part of DB48X.
+//
+//   DB48X is free software: you can redistribute it and/or modify
+//   it under the terms outlined in the LICENSE.txt file
+//
+//   DB48X is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// ****************************************************************************
+//
+//   The generic array code computes with objects, creating a temporary for
+//   every intermediate scalar. Here, values are unpacked in the scratchpad
+//   and computed in place as `float` or `double`, so that the only objects
+//   created are those of the result.
+//
+//   Products and sums are accumulated in the same order as the generic code,
+//   so they give the same results. Determinant and inverse use an
+//   elimination with partial pivoting, which is more stable with floating
+//   point than the fraction-free elimination used for exact values. A zero
+//   pivot means the matrix is singular. A pivot that is tiny relative to the
+//   largest element of the matrix may be a rounding error or a genuinely
+//   small value, so in that case we leave it to the generic code.
+
+#include "hwmatrix.h"
+
+#include "hwfp.h"
+#include "integer.h"
+#include "program.h"
+#include "recorder.h"
+#include "settings.h"
+
+#include <cmath>
+#include <limits>
+
+RECORDER(hwmatrix, 16, "Packed hardware floating-point matrices");
+
+
+template <typename hw>
+struct packed
+// ----------------------------------------------------------------------------
+//   Contiguous row-major values in the scratchpad
+// ----------------------------------------------------------------------------
+//   The scratchpad moves when objects are created, so 'data' is only valid
+//   until then. Values remain accessible through 'at' after that.
+{
+    using hwfp_t = hwfp<hw>;
+
+    packed(): buffer(), offset() {}
+
+    hw *allocate(size_t count)
+    {
+        byte *p = rt.allocate(count * sizeof(hw) + sizeof(hw));
+        if (!p)
+            return nullptr;
+        offset = p - buffer.scratch();
+        offset += (sizeof(hw) - uintptr_t(p) % sizeof(hw)) % sizeof(hw);
+        return data();
+    }
+
+    hw *data()
+    {
+        return (hw *) (buffer.scratch() + offset);
+    }
+
+    hw at(size_t index)
+    {
+        hw value;
+        memcpy(&value, buffer.scratch() + offset + index * sizeof(hw),
+               sizeof(value));
+        return value;
+    }
+
+    static hw value(object_p obj)
+    {
+        return ((typename hwfp_t::hwfp_p) obj)->value();
+    }
+
+    static void unpack(array_p a, hw *out);
+    array_p     pack(size_t rows, size_t cols, size_t stride, size_t first);
+
+    scribble    buffer;
+    size_t      offset;
+};
+
+
+template <typename hw>
+void packed<hw>::unpack(array_p a, hw *out)
+// ----------------------------------------------------------------------------
+//   Unpack the values of a vector or matrix, checked with hwmatrix::type
+// ----------------------------------------------------------------------------
+{
+    for (object_p item : *a)
+    {
+        if (item->type() == object::ID_array)
+            for (object_p x : *array_p(item))
+                *out++ = value(x);
+        else
+            *out++ = value(item);
+    }
+}
+
+
+template <typename hw>
+array_p packed<hw>::pack(size_t rows, size_t cols, size_t stride, size_t first)
+// ----------------------------------------------------------------------------
+//   Build an array from packed values, a vector if cols is 0
+// ----------------------------------------------------------------------------
+{
+    scribble scr;
+    for (size_t r = 0; r < rows; r++)
+    {
+        if (cols)
+        {
+            list_g row;
+            {
+                scribble srow;
+                for (size_t c = 0; c < cols; c++)
+                {
+                    object_g it = hwfp_t::make(at(r * stride + first + c));
+                    if (program::interrupted() || !it || !rt.append(it))
+                        return nullptr;
+                }
+                row = list::make(object::ID_array,
+                                 srow.scratch(), srow.growth());
+            }
+            if (program::interrupted() || !row || !rt.append(row))
+                return nullptr;
+        }
+        else
+        {
+            object_g it = hwfp_t::make(at(r * stride + first));
+            if (program::interrupted() || !it || !rt.append(it))
+                return nullptr;
+        }
+    }
+    list_p result = list::make(object::ID_array, scr.scratch(), scr.growth());
+    return array_p(result);
+}
+
+
+template <typename hw>
+static hw tiny_pivot(const hw *m, size_t count, size_t n)
+// ----------------------------------------------------------------------------
+//   Threshold below which a pivot is too small to be trusted
+// ----------------------------------------------------------------------------
+{
+    hw largest = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        hw a = std::fabs(m[i]);
+        if (a > largest)
+            largest = a;
+    }
+    return std::numeric_limits<hw>::epsilon() * hw(n) * largest;
+}
+
+
+template <typename hw>
+static size_t pivot_row(const hw *m, size_t stride, size_t n, size_t i)
+// ----------------------------------------------------------------------------
+//   Find the row with the largest element in column i, at or below row i
+// ----------------------------------------------------------------------------
+{
+    size_t row  = i;
+    hw     best = std::fabs(m[i * stride + i]);
+    for (size_t j = i + 1; j < n; j++)
+    {
+        hw a = std::fabs(m[j * stride + i]);
+        if (a > best)
+        {
+            best = a;
+            row = j;
+        }
+    }
+    return row;
+}
+
+
+template <typename hw>
+static void swap_rows(hw *m, size_t stride, size_t a, size_t b)
+// ----------------------------------------------------------------------------
+//   Swap two rows in a packed matrix
+// ----------------------------------------------------------------------------
+{
+    hw *__restrict ra = m + a * stride;
+    hw *__restrict rb = m + b * stride;
+    for (size_t k = 0; k < stride; k++)
+    {
+        hw t = ra[k];
+        ra[k] = rb[k];
+        rb[k] = t;
+    }
+}
+
+
+template <typename hw>
+static algebraic_p determinant(array_r a, size_t n)
+// ----------------------------------------------------------------------------
+//   Compute the determinant with an LU decomposition
+// ----------------------------------------------------------------------------
+{
+    packed<hw> m;
+    hw        *d = m.allocate(n * n);
+    if (!d)
+        return nullptr;
+    packed<hw>::unpack(a, d);
+
+    hw   tiny = tiny_pivot(d, n * n, n);
+    hw   det  = 1;
+    bool neg  = false;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (program::interrupted())
+            return nullptr;
+
+        size_t p = pivot_row(d, n, n, i);
+        hw     a = std::fabs(d[p * n + i]);
+        if (a == 0)
+        {
+            record(hwmatrix, "Determinant is zero, pivot %u", i);
+            return integer::make(0);
+        }
+        if (a <= tiny)
+        {
+            record(hwmatrix, "Tiny pivot %u, using generic code", i);
+            return nullptr;
+        }
+        if (p != i)
+        {
+            swap_rows(d, n, p, i);
+            neg = !neg;
+        }
+
+        const hw *__restrict ri    = d + i * n;
+        hw                   pivot = ri[i];
+        det *= pivot;
+        for (size_t j = i + 1; j < n; j++)
+        {
+            hw *__restrict rj = d + j * n;
+            hw             f  = rj[i] / pivot;
+            if (f != 0)
+                for (size_t k = i + 1; k < n; k++)
+                    rj[k] -= f * ri[k];
+        }
+    }
+    if (neg)
+        det = -det;
+    return hwfp<hw>::make(det);
+}
+
+
+template <typename hw>
+static array_p invert(array_r a, size_t n)
+// ----------------------------------------------------------------------------
+//   Compute the inverse with a Gauss-Jordan elimination
+// ----------------------------------------------------------------------------
+//   The matrix is augmented with the identity on the right, which becomes
+//   the inverse as the left side becomes the identity.
+{
+    packed<hw> m;
+    size_t     w = 2 * n;
+    hw        *d = m.allocate(n * w);
+    if (!d)
+        return nullptr;
+
+    // Unpack the matrix as the left half, starting from the end
+    packed<hw>::unpack(a, d + n * n);
+    for (size_t i = 0; i < n; i++)
+    {
+        hw *__restrict ri = d + i * w;
+        const hw      *si = d + n * n + i * n;
+        for (size_t k = 0; k < n; k++)
+            ri[k] = si[k];
+    }
+    hw tiny = tiny_pivot(d, n, n);
+    for (size_t i = 1; i < n; i++)
+    {
+        hw rowtiny = tiny_pivot(d + i * w, n, n);
+        if (rowtiny > tiny)
+            tiny = rowtiny;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        hw *__restrict ri = d + i * w;
+        for (size_t k = n; k < w; k++)
+            ri[k] = k - n == i;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (program::interrupted())
+            return nullptr;
+
+        size_t p = pivot_row(d, w, n, i);
+        hw     a = std::fabs(d[p * w + i]);
+        if (a == 0)
+        {
+            record(hwmatrix, "Cannot invert singular matrix, pivot %u", i);
+            rt.zero_divide_error();
+            return nullptr;
+        }
+        if (a <= tiny)
+        {
+            record(hwmatrix, "Tiny pivot %u, using generic code", i);
+            return nullptr;
+        }
+        if (p != i)
+            swap_rows(d, w, p, i);
+
+        hw *__restrict ri    = d + i * w;
+        hw             pivot = ri[i];
+        for (size_t k = i; k < w; k++)
+            ri[k] /= pivot;
+        for (size_t j = 0; j < n; j++)
+        {
+            if (j == i)
+                continue;
+            hw *__restrict rj = d + j * w;
+            hw             f  = rj[i];
+            if (f != 0)
+                for (size_t k = i; k < w; k++)
+                    rj[k] -= f * ri[k];
+        }
+    }
+    return m.pack(n, n, w, n);
+}
+
+
+template <typename hw>
+static array_p mul(array_r x, array_r y, size_t rows, size_t inner, size_t cols)
+// ----------------------------------------------------------------------------
+//   Multiply a matrix by a matrix or a vector (cols == 0)
+// ----------------------------------------------------------------------------
+//   The loops are blocked so that a block of the right matrix remains in
+//   cache while it is used for all rows of the left one. The innermost
+//   loop runs along rows of the result and can be vectorized. For each
+//   element, terms are still added in increasing order.
+{
+    enum { BLOCK = 32 };
+    size_t     width = cols ? cols : 1;
+    packed<hw> m;
+    hw        *d = m.allocate(rows * inner + inner * width + rows * width);
+    if (!d)
+        return nullptr;
+
+    const hw *__restrict a = d;
+    const hw *__restrict b = d + rows * inner;
+    hw *__restrict       c = d + rows * inner + inner * width;
+    packed<hw>::unpack(x, d);
+    packed<hw>::unpack(y, d + rows * inner);
+
+    for (size_t i = 0; i < rows; i++)
+        for (size_t j = 0; j < width; j++)
+            c[i * width + j] = a[i * inner] * b[j];
+
+    for (size_t kb = 1; kb < inner; kb += BLOCK)
+    {
+        if (program::interrupted())
+            return nullptr;
+        size_t ke = kb + BLOCK < inner ? kb + BLOCK : inner;
+        for (size_t jb = 0; jb < width; jb += BLOCK)
+        {
+            size_t je = jb + BLOCK < width ? jb + BLOCK : width;
+            for (size_t i = 0; i < rows; i++)
+            {
+                hw *__restrict       ci = c + i * width;
+                const hw *__restrict ai = a + i * inner;
+                for (size_t k = kb; k < ke; k++)
+                {
+                    hw                   aik = ai[k];
+                    const hw *__restrict bk  = b + k * width;
+                    for (size_t j = jb; j < je; j++)
+                        ci[j] += aik * bk[j];
+                }
+            }
+        }
+    }
+
+    return m.pack(rows, cols, width, rows * inner + inner * width);
+}
+
+
+template <typename hw>
+static algebraic_p dot(array_r x, array_r y, size_t n)
+// ----------------------------------------------------------------------------
+//   Dot product of two vectors
+// ----------------------------------------------------------------------------
+{
+    packed<hw> m;
+    hw        *d = m.allocate(2 * n);
+    if (!d)
+        return nullptr;
+    packed<hw>::unpack(x, d);
+    packed<hw>::unpack(y, d + n);
+
+    const hw *__restrict a   = d;
+    const hw *__restrict b   = d + n;
+    hw                   sum = a[0] * b[0];
+    for (size_t k = 1; k < n; k++)
+        sum += a[k] * b[k];
+    return hwfp<hw>::make(sum);
+}
+
+
+template <typename hw>
+static array_p cross(array_r x, array_r y)
+// ----------------------------------------------------------------------------
+//   Cross product of two 3D vectors
+// ----------------------------------------------------------------------------
+{
+    packed<hw> m;
+    hw        *d = m.allocate(9);
+    if (!d)
+        return nullptr;
+    packed<hw>::unpack(x, d);
+    packed<hw>::unpack(y, d + 3);
+
+    const hw *a = d;
+    const hw *b = d + 3;
+    hw       *c = d + 6;
+    c[0] = a[1] * b[2] - a[2] * b[1];
+    c[1] = a[2] * b[0] - a[0] * b[2];
+    c[2] = a[0] * b[1] - a[1] * b[0];
+    return m.pack(3, 0, 1, 6);
+}
+
+
+
+// ============================================================================
+//
+//   Interface with arrays
+//
+// ============================================================================
+
+object::id hwmatrix::type(array_p a, size_t *rows, size_t *cols)
+// ----------------------------------------------------------------------------
+//   Check if an array only contains hardware floating-point values
+// ----------------------------------------------------------------------------
+{
+    const object::id none = object::ID_object;
+    if (!Settings.HardwareFloatingPoint() || !a)
+        return none;
+
+    object::id ty = none;
+    size_t     r  = 0;
+    size_t     c  = 0;
+    bool       matrix = false;
+    for (object_p item : *a)
+    {
+        object::id ity = item->type();
+        if (r == 0)
+        {
+            matrix = ity == object::ID_array;
+            if (!matrix)
+                ty = ity;
+        }
+        if (matrix)
+        {
+            if (ity != object::ID_array)
+                return none;
+            size_t n = 0;
+            for (object_p x : *array_p(item))
+            {
+                object::id xty = x->type();
+                if (ty == none)
+                    ty = xty;
+                if (xty != ty)
+                    return none;
+                n++;
+            }
+            if (r == 0)
+                c = n;
+            if (n != c || n == 0)
+                return none;
+        }
+        else if (ity != ty)
+        {
+            return none;
+        }
+        r++;
+    }
+
+    uint precision = Settings.Precision();
+    if (r == 0 ||
+        (ty == object::ID_hwdouble && precision > 16) ||
+        (ty == object::ID_hwfloat && precision > 7) ||
+        (ty != object::ID_hwdouble && ty != object::ID_hwfloat))
+        return none;
+
+    if (rows)
+        *rows = r;
+    if (cols)
+        *cols = c;
+    return ty;
+}
+
+
+algebraic_p hwmatrix::determinant(array_r a, object::id ty, size_t n)
+// ----------------------------------------------------------------------------
+//   Determinant of a packed square matrix
+// ----------------------------------------------------------------------------
+{
+    record(hwmatrix, "Determinant of %ux%u matrix", n, n);
+    return ty == object::ID_hwfloat
+        ? ::determinant<float>(a, n)
+        : ::determinant<double>(a, n);
+}
+
+
+array_p hwmatrix::invert(array_r a, object::id ty, size_t n)
+// ----------------------------------------------------------------------------
+//   Inverse of a packed square matrix
+// ----------------------------------------------------------------------------
+{
+    record(hwmatrix, "Inverse of %ux%u matrix", n, n);
+    return ty == object::ID_hwfloat
+        ? ::invert<float>(a, n)
+        : ::invert<double>(a, n);
+}
+
+
+array_p hwmatrix::mul(array_r x, array_r y, object::id ty,
+                      size_t rows, size_t inner, size_t cols)
+// ----------------------------------------------------------------------------
+//   Product of a packed matrix by a packed matrix or vector
+// ----------------------------------------------------------------------------
+{
+    record(hwmatrix, "Product of %ux%u by %ux%u", rows, inner, inner, cols);
+    return ty == object::ID_hwfloat
+        ? ::mul<float>(x, y, rows, inner, cols)
+        : ::mul<double>(x, y, rows, inner, cols);
+}
+
+
+algebraic_p hwmatrix::dot(array_r x, array_r y, object::id ty, size_t n)
+// ----------------------------------------------------------------------------
+//   Dot product of packed vectors
+// ----------------------------------------------------------------------------
+{
+    return ty == object::ID_hwfloat
+        ? ::dot<float>(x, y, n)
+        : ::dot<double>(x, y, n);
+}
+
+
+array_p hwmatrix::cross(array_r x, array_r y, object::id ty)
+// ----------------------------------------------------------------------------
+//   Cross product of packed 3D vectors
+// ----------------------------------------------------------------------------
+{
+    return ty == object::ID_hwfloat
+        ? ::cross<float>(x, y)
+        : ::cross<double>(x, y);
+}
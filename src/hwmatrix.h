@@ -0,0 +1,57 @@
+#ifndef HWMATRIX_H
+#define HWMATRIX_H
+// ****************************************************************************
+//  hwmatrix.h                                                    DB48X project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Dense matrices of hardware floating-point values
+//
+//     When all the elements of an array are hardware floating-point values
+//     of the same type, matrix operations unpack them into contiguous
+//     row-major storage in the scratchpad, compute there without creating
+//     any intermediate object, and pack the result back into an array.
+//
+//
+// ****************************************************************************
+//   (C) 2024 Christophe de Dinechin <christophe@dinechin.org>
+//   This software is licensed under the terms outlined in LICENSE.txt
+// ****************************************************************************
+//   This file is part of DB48X.
+//
+//   DB48X is free software: you can redistribute it and/or modify
+//   it under the terms outlined in the LICENSE.txt file
+//
+//   DB48X is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// ****************************************************************************
+
+#include "array.h"
+
+
+struct hwmatrix
+// ----------------------------------------------------------------------------
+//   Packed kernels for arrays of hwfloat or hwdouble values
+// ----------------------------------------------------------------------------
+{
+    static object::id   type(array_p a, size_t *rows, size_t *cols);
+    // ------------------------------------------------------------------------
+    //   Return ID_hwfloat or ID_hwdouble if the array can be packed
+    // ------------------------------------------------------------------------
+    //   Vectors return 0 columns. If the array cannot be packed, e.g. because
+    //   hardware floating-point is disabled, this returns ID_object.
+
+    // These must only be called on arrays that can be packed, as 'ty'
+    // Determinant and inverse return nullptr without an error when the
+    // generic code should be used instead, e.g. for a tiny pivot
+    static algebraic_p  determinant(array_r a, object::id ty, size_t n);
+    static array_p      invert(array_r a, object::id ty, size_t n);
+    static array_p      mul(array_r x, array_r y, object::id ty,
+                            size_t rows, size_t inner, size_t cols);
+    static algebraic_p  dot(array_r x, array_r y, object::id ty, size_t n);
+    static array_p      cross(array_r x, array_r y, object::id ty);
+};
+
+#endif // HWMATRIX_H
@@ -32,6 +32,7 @@
 #include "algebraic.h"
 #include "arithmetic.h"
 #include "compare.h"
+#include "compile.h"
 #include "equations.h"
 #include "expression.h"
 #include "functions.h"
@@ -96,6 +97,327 @@ NFUNCTION_BODY(Integrate)
 }
 
 
+// ============================================================================
+//
+//   Adaptive Gauss-Kronrod integration
+//
+// ============================================================================
+
+static const struct kronrod_node
+// ----------------------------------------------------------------------------
+//   Nodes and weights of the 7-point Gauss / 15-point Kronrod rule on -1..1
+// ----------------------------------------------------------------------------
+//   Each value is stored with 36 digits as three groups of 12 digits, since
+//   decimal::make() cannot take 18-digit values. Nodes are symmetric, so only
+//   nodes in 0..1 are listed. Gauss nodes are every other Kronrod node.
+{
+    large       x[3];           // Node
+    large       kronrod[3];     // Weight in the 15-point Kronrod rule
+    large       gauss[3];       // Weight in the 7-point Gauss rule, or 0
+} kronrod_nodes[] =
+{
+    { { 991455371120LL, 812639206854LL, 697526328517LL },
+      {  22935322010LL, 529224963732LL,   8058969592LL },
+      {            0LL,            0LL,            0LL } },
+    { { 949107912342LL, 758524526189LL, 684047851262LL },
+      {  63092092629LL, 978553290700LL, 663189204287LL },
+      { 129484966168LL, 869693270611LL, 432679082018LL } },
+    { { 864864423359LL, 769072789712LL, 788640926201LL },
+      { 104790010322LL, 250183839876LL, 322541518017LL },
+      {            0LL,            0LL,            0LL } },
+    { { 741531185599LL, 394439863864LL, 773280788407LL },
+      { 140653259715LL, 525918745189LL, 590510237920LL },
+      { 279705391489LL, 276667901467LL, 771423779582LL } },
+    { { 586087235467LL, 691130294144LL, 838258729598LL },
+      { 169004726639LL, 267902826583LL, 426598550284LL },
+      {            0LL,            0LL,            0LL } },
+    { { 405845151377LL, 397166906606LL, 412076961463LL },
+      { 190350578064LL, 785409913256LL, 402421013683LL },
+      { 381830050505LL, 118944950369LL, 775488975134LL } },
+    { { 207784955007LL, 898467600689LL, 403773244913LL },
+      { 204432940075LL, 298892414161LL, 999234649085LL },
+      {            0LL,            0LL,            0LL } },
+    { {            0LL,            0LL,            0LL },
+      { 209482141084LL, 727828012999LL, 174891714264LL },
+      { 417959183673LL, 469387755102LL,  40816326531LL } },
+};
+static const uint KRONROD_NODES  = sizeof(kronrod_nodes)/sizeof(*kronrod_nodes);
+static const int  KRONROD_DIGITS = 32;  // Digits we trust the rule for
+static const uint KRONROD_FIELDS = 4;   // Low, high, integral, error
+
+
+struct kronrod_rule
+// ----------------------------------------------------------------------------
+//   The Gauss-Kronrod nodes and weights, and the function to integrate
+// ----------------------------------------------------------------------------
+//   Like for Romberg, we integrate over -1..1 after a change of variable
+//   which gives less weight to the ends of the interval, see integrate().
+{
+    kronrod_rule(compiled &fn): fn(fn) {}
+
+    compiled   &fn;
+    algebraic_g x[KRONROD_NODES];
+    algebraic_g kronrod[KRONROD_NODES];
+    algebraic_g gauss[KRONROD_NODES];
+    algebraic_g lx, hl2, half, one;
+
+    static algebraic_p value(const large v[3])
+    {
+        algebraic_g high = decimal::make(v[0], -12);
+        algebraic_g mid  = decimal::make(v[1], -24);
+        algebraic_g low  = decimal::make(v[2], -36);
+        return high + mid + low;
+    }
+
+    bool init(algebraic_r low, algebraic_r high)
+    {
+        half = decimal::make(5, -1);
+        one  = integer::make(1);
+        lx   = low;
+        hl2  = half ? (high - low) * half : nullptr;
+        if (!half || !one || !hl2)
+            return false;
+        for (uint i = 0; i < KRONROD_NODES; i++)
+        {
+            x[i]       = value(kronrod_nodes[i].x);
+            kronrod[i] = value(kronrod_nodes[i].kronrod);
+            gauss[i]   = value(kronrod_nodes[i].gauss);
+            if (!x[i] || !kronrod[i] || !gauss[i])
+                return false;
+        }
+        return true;
+    }
+
+    algebraic_p sample(algebraic_r v)
+    {
+        algebraic_g u  = ((v + v + v) - v * v * v) * half; // 3/2v - 1/2v^3
+        algebraic_g du = (one - v * v) * half;              // (1-v^2)/2
+        algebraic_g x  = hl2 * (u + one) + lx;              // (b-a)(u+1)/2 + a
+        algebraic_g y  = x ? fn.evaluate(x) : nullptr;      // f(x)
+        return y ? y * hl2 * (du + du + du) : nullptr;     // f(x) dx/dv
+    }
+};
+
+
+static bool kronrod_interval(kronrod_rule &rule,
+                             algebraic_r   lx,
+                             algebraic_r   hx,
+                             algebraic_g  &integral,
+                             algebraic_g  &error)
+// ----------------------------------------------------------------------------
+//   Apply the Gauss-Kronrod rule on one interval
+// ----------------------------------------------------------------------------
+//   The error estimate is the difference between the Gauss and Kronrod
+//   results. It is pessimistic, since the Kronrod result is much more
+//   precise than the Gauss one, but it costs no additional evaluation.
+{
+    algebraic_g c    = (lx + hx) * rule.half;
+    algebraic_g h    = (hx - lx) * rule.half;
+    algebraic_g y    = c ? rule.sample(c) : nullptr;
+    algebraic_g sk, sg, x, dx;
+    uint        last = KRONROD_NODES - 1;
+    if (!y || !h)
+        return false;
+
+    // Center node is both a Gauss and Kronrod node
+    sk = rule.kronrod[last] * y;
+    sg = rule.gauss[last] * y;
+    for (uint i = 0; i < last && sk && sg; i++)
+    {
+        // Evaluate the function on symmetric nodes
+        dx = h * rule.x[i];
+        x  = c - dx;
+        y  = x ? rule.sample(x) : nullptr;
+        x  = c + dx;
+        x  = x && y ? rule.sample(x) : nullptr;
+        y  = x ? y + x : nullptr;
+        if (!y)
+            return false;
+
+        sk = sk + rule.kronrod[i] * y;
+        if (i & 1)
+            sg = sg + rule.gauss[i] * y;
+    }
+    integral = sk ? sk * h : nullptr;
+    error    = sg && integral ? abs::evaluate(integral - sg * h) : nullptr;
+    record(integrate, "Interval %t-%t integral %t error %t",
+           +lx, +hx, +integral, +error);
+    return integral && error;
+}
+
+
+static algebraic_p kronrod_field(size_t base, size_t entry, uint field)
+// ----------------------------------------------------------------------------
+//   Return a field of an interval in the priority queue on the stack
+// ----------------------------------------------------------------------------
+{
+    size_t index = base + entry * KRONROD_FIELDS + field;
+    return algebraic_p(rt.stack(rt.depth() - 1 - index));
+}
+
+
+static void kronrod_swap(size_t base, size_t i, size_t j)
+// ----------------------------------------------------------------------------
+//   Swap two intervals in the priority queue
+// ----------------------------------------------------------------------------
+{
+    size_t top = rt.depth() - 1 - base;
+    for (uint f = 0; f < KRONROD_FIELDS; f++)
+    {
+        uint     ii  = top - (i * KRONROD_FIELDS + f);
+        uint     ij  = top - (j * KRONROD_FIELDS + f);
+        object_p tmp = rt.stack(ii);
+        rt.stack(ii, rt.stack(ij));
+        rt.stack(ij, tmp);
+    }
+}
+
+
+static bool kronrod_push(size_t       base,
+                         algebraic_r  lx,
+                         algebraic_r  hx,
+                         algebraic_r  integral,
+                         algebraic_r  error)
+// ----------------------------------------------------------------------------
+//   Add an interval to the priority queue, a heap sorted by largest error
+// ----------------------------------------------------------------------------
+{
+    if (!rt.push(+lx) || !rt.push(+hx) ||
+        !rt.push(+integral) || !rt.push(+error))
+        return false;
+
+    size_t entry = (rt.depth() - base) / KRONROD_FIELDS - 1;
+    while (entry)
+    {
+        size_t      parent = (entry - 1) / 2;
+        algebraic_g perr   = kronrod_field(base, parent, 3);
+        if (!smaller_magnitude(perr, error))
+            break;
+        kronrod_swap(base, entry, parent);
+        entry = parent;
+    }
+    return true;
+}
+
+
+static void kronrod_pop(size_t base)
+// ----------------------------------------------------------------------------
+//   Remove the interval with the largest error from the priority queue
+// ----------------------------------------------------------------------------
+{
+    size_t count = (rt.depth() - base) / KRONROD_FIELDS - 1;
+    kronrod_swap(base, 0, count);
+    rt.drop(KRONROD_FIELDS);
+
+    size_t entry = 0;
+    while (true)
+    {
+        size_t largest = entry;
+        for (size_t child = 2 * entry + 1; child <= 2 * entry + 2; child++)
+        {
+            if (child >= count)
+                break;
+            algebraic_g lerr = kronrod_field(base, largest, 3);
+            algebraic_g cerr = kronrod_field(base, child, 3);
+            if (smaller_magnitude(lerr, cerr))
+                largest = child;
+        }
+        if (largest == entry)
+            break;
+        kronrod_swap(base, entry, largest);
+        entry = largest;
+    }
+}
+
+
+static algebraic_p kronrod_integrate(compiled   &fn,
+                                     algebraic_r lx,
+                                     algebraic_r hx,
+                                     algebraic_r eps)
+// ----------------------------------------------------------------------------
+//   Adaptive integration using the Gauss-Kronrod rule
+// ----------------------------------------------------------------------------
+//   The intervals are kept on the stack in a priority queue sorted by error
+//   estimate. The interval with the largest error is split in two until the
+//   sum of all errors is small enough relative to the integral.
+{
+    kronrod_rule rule(fn);
+    algebraic_g  total, errors, integral, ierr;
+    if (!rule.init(lx, hx))
+        return nullptr;
+
+    // Evaluate the whole interval first
+    algebraic_g hv    = rule.one;
+    algebraic_g lv    = -hv;
+    size_t      depth = rt.depth();
+    if (!lv ||
+        !kronrod_interval(rule, lv, hv, total, errors) ||
+        !kronrod_push(depth, lv, hv, total, errors))
+        goto error;
+
+    {
+        // Like for Romberg, allow about 2^IntegrationIterations samples
+        uint   iter    = Settings.IntegrationIterations();
+        ularge samples = 2 * KRONROD_NODES - 1;
+        ularge maximum = ularge(1) << iter;
+        while (!program::interrupted())
+        {
+            // Check if we converged
+            algebraic_g limit = total * eps;
+            if (!limit)
+                goto error;
+            if (errors->is_zero(false) || smaller_magnitude(errors, limit))
+            {
+                // Sum the integrals again to minimize rounding errors
+                total = integer::make(0);
+                size_t count = (rt.depth() - depth) / KRONROD_FIELDS;
+                for (size_t i = 0; i < count && total; i++)
+                {
+                    integral = kronrod_field(depth, i, 2);
+                    total = total + integral;
+                }
+                rt.drop(rt.depth() - depth);
+                record(integrate, "Converged after %llu samples, %t",
+                       samples, +total);
+                return total;
+            }
+            if (samples + 4 * KRONROD_NODES - 2 > maximum)
+                break;
+
+            // Split the interval with the largest error
+            algebraic_g low  = kronrod_field(depth, 0, 0);
+            algebraic_g high = kronrod_field(depth, 0, 1);
+            algebraic_g mid  = (low + high) * rule.half;
+            integral = kronrod_field(depth, 0, 2);
+            ierr = kronrod_field(depth, 0, 3);
+            total = total - integral;
+            errors = errors - ierr;
+            kronrod_pop(depth);
+            if (!mid || !total || !errors)
+                goto error;
+            if (!kronrod_interval(rule, low, mid, integral, ierr) ||
+                !kronrod_push(depth, low, mid, integral, ierr))
+                goto error;
+            total = total + integral;
+            errors = errors + ierr;
+            if (!kronrod_interval(rule, mid, high, integral, ierr) ||
+                !kronrod_push(depth, mid, high, integral, ierr))
+                goto error;
+            total = total + integral;
+            errors = errors + ierr;
+            samples += 4 * KRONROD_NODES - 2;
+            if (!total || !errors)
+                goto error;
+        }
+    }
+    rt.precision_loss_error();
+
+error:
+    rt.drop(rt.depth() - depth);
+    return nullptr;
+}
+
+
 algebraic_p integrate(program_g   eq,
                       symbol_g    name,
                       algebraic_g lx,
@@ -103,6 +425,9 @@ algebraic_p integrate(program_g   eq,
 // ----------------------------------------------------------------------------
 //   Romberg algorithm - The core of the integration function
 // ----------------------------------------------------------------------------
+//   If AdaptiveIntegration is set, use kronrod_integrate() instead, unless
+//   the requested accuracy exceeds that of the Gauss-Kronrod constants.
+//
 //   The Romberg algorithm uses two buffers, one keeping the approximations
 //   from the previous loop, called P, and one for the current loop, called C.
 //   At each step, the size of C is one more than P.
@@ -148,6 +473,13 @@ algebraic_p integrate(program_g   eq,
     // Select numerical computations (doing this with fraction is slow)
     settings::SaveNumericalResults snr(true);
 
+    // Compile the function once for all samples
+    compiled fn(eq);
+
+    // Use adaptive Gauss-Kronrod integration if selected
+    if (Settings.AdaptiveIntegration() && dig <= KRONROD_DIGITS)
+        return kronrod_integrate(fn, lx, hx, eps);
+
     // Initial integration step and first trapezoidal step
     dv = two;
     algebraic_g hl2 = (hx - lx) * half;
@@ -182,7 +514,7 @@ algebraic_p integrate(program_g   eq,
             dx = hl2 * du;                        // (b-a)/2 du
 
             // Evaluate equation
-            y  = algebraic::evaluate_function(eq, x);
+            y  = fn.evaluate(x);
 
             // Sum elements, and approximate when necessary
             sy = sy + y * dx;
@@ -1120,6 +1120,30 @@ COMMAND_BODY(GetI)
 }
 
 
+static object_p element(object_p items, object_p index)
+// ----------------------------------------------------------------------------
+//   Find the element for a numerical index or a list of numerical indexes
+// ----------------------------------------------------------------------------
+{
+    if (list_p idxlist = index->as<list>())
+    {
+        if (!idxlist->head())
+            return nullptr;
+        for (object_p idx : *idxlist)
+            if (idx->type() != object::ID_integer ||
+                !(items = element(items, idx)))
+                return nullptr;
+        return items;
+    }
+
+    list_p list = items->as_array_or_list();
+    if (!list || index->type() != object::ID_integer)
+        return nullptr;
+    size_t idx = index->as_uint32(0, false);
+    return idx ? list->at(idx - 1) : nullptr;
+}
+
+
 static object::result put(bool increment)
 // ----------------------------------------------------------------------------
 //   Put element in structure, incrementing index or not
@@ -1136,7 +1160,19 @@ static object::result put(bool increment)
                 return object::ERROR;
         }
 
-        if (object_g result = items->at(rt.stack(1), rt.top()))
+        // Overwrite an element of a global variable in place if possible
+        bool     inplace = false;
+        object_g result  = nullptr;
+        if (name)
+            if (object_p old = element(items, rt.stack(1)))
+                if (directory::overwrite(items, old, rt.top()))
+                    inplace = true;
+        if (inplace)
+            result = items;
+        else if (!rt.error())
+            result = items->at(rt.stack(1), rt.top());
+
+        if (result)
         {
             if (increment)
             {
@@ -1151,7 +1187,7 @@ static object::result put(bool increment)
             if (name)
             {
                 name = rt.stack(2)->as_quoted<symbol>();
-                if (directory::update(name, result))
+                if (inplace || directory::update(name, result))
                 {
                     rt.drop(increment ? 1 : 3);
                     return object::OK;
@@ -1415,6 +1451,39 @@ list_p list::tail() const
 }
 
 
+object_p list::indexed(size_t index) const
+// ----------------------------------------------------------------------------
+//   Return the n-th element using an offset index built on first use
+// ----------------------------------------------------------------------------
+//   Otherwise, reaching an element requires skipping all elements before it,
+//   so that a loop getting or putting every element of a list is quadratic
+{
+    size_t   size  = 0;
+    object_p first = objects(&size);
+    size_t   count = 0;
+    if (const uint32_t *offsets = rt.offsets(this, &count))
+        return index < count ? first + offsets[index] : nullptr;
+
+    for (size_t o = 0; o < size; o += (first + o)->size())
+        count++;
+    if (index >= count)
+        return nullptr;
+    if (!rt.is_indexable(this))
+        return *iterator(this, index);
+
+    // operator new support purposefully not linked in embedded versions
+    uint32_t *offsets = (uint32_t *) malloc(count * sizeof(uint32_t));
+    if (!offsets)
+        return *iterator(this, index);
+    count = 0;
+    for (size_t o = 0; o < size; o += (first + o)->size())
+        offsets[count++] = o;
+    record(list, "Indexed %p with %u items", this, count);
+    rt.offsets(this, offsets, count);
+    return first + offsets[index];
+}
+
+
 list_p list::map(object_p prgobj) const
 // ----------------------------------------------------------------------------
 //   Apply an RPL object (nominally a program) on all elements in the list
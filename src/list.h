@@ -246,9 +246,17 @@ struct list : text
     //   Return the n-th element in the list
     // ------------------------------------------------------------------------
     {
+        if (index >= INDEXED)
+            return indexed(index);
         return *iterator(this, index);
     }
 
+    enum { INDEXED = 16 };
+    object_p indexed(size_t index) const;
+    // ------------------------------------------------------------------------
+    //   Return the n-th element using an offset index built on first use
+    // ------------------------------------------------------------------------
+
 
     template<typename ...args>
     object_p at(size_t index, args... rest) const
@@ -1658,7 +1658,11 @@ MENU(MemoryMenu,
      "Incr",    ID_Increment,
      "Decr",    ID_Decrement,
      "Vars",    ID_Vars,
-     "TVars",   ID_TVars);
+     "TVars",   ID_TVars,
+
+     "ProfOn",  ID_ProfileStart,
+     "ProfOff", ID_ProfileStop,
+     "Profile", ID_ProfileReport);
 
 
 MENU(TimeMenu,
@@ -63,6 +63,7 @@
 #include "parser.h"
 #include "plot.h"
 #include "polynomial.h"
+#include "profile.h"
 #include "program.h"
 #include "renderer.h"
 #include "runtime.h"
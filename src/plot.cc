@@ -31,6 +31,7 @@
 
 #include "arithmetic.h"
 #include "compare.h"
+#include "compile.h"
 #include "equations.h"
 #include "expression.h"
 #include "functions.h"
@@ -246,6 +247,7 @@ object::result draw_plot(object::id                  kind,
     size    lw           = Settings.LineWidth();
     pattern fg           = Settings.Foreground();
     pattern errbg        = Settings.PlotErrorBackground();
+    compiled fn(eq);
 
     while (!program::interrupted())
     {
@@ -254,7 +256,7 @@ object::result draw_plot(object::id                  kind,
         uint  dcount = 1;
         if (dname == object::ID_Equation)
         {
-            y = algebraic::evaluate_function(eq, x);
+            y = fn.evaluate(x);
         }
         else
         {
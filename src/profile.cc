@@ -0,0 +1,392 @@
+// ****************************************************************************
+//  profile.cc                                                    DB48X project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Profiler for RPL programs
+//
+//
+//
+//
+//
+//
+// ****************************************************************************
+//   (C) 2024 Christophe de Dinechin <christophe@dinechin.org>
+//   This software is licensed under the terms outlined in LICENSE.txt
+// ****************************************************************************
+//   This file is part of DB48X.
+//
+//   DB48X is free software: you can redistribute it and/or modify
+//   it under the terms outlined in the LICENSE.txt file
+//
+//   DB48X is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// ****************************************************************************
+//
+//   The program loop only calls profile::evaluate when the profiler is
+//   active, so that there is no cost when it is not.
+//
+//   Time is charged to the innermost evaluation that is running, so that the
+//   time of a nested evaluation is not counted twice. Garbage collection
+//   happens inside the evaluation that allocates, so it is charged there.
+//
+//   Calling a global name that contains a program pushes the program body on
+//   the call stack. The profiler records a frame with the call depth at that
+//   point, and charges everything running deeper to that name, until the
+//   call depth goes back up. Time spent in names it calls in turn is only
+//   charged to these names.
+
+#include "profile.h"
+
+#include "dmcp.h"
+#include "integer.h"
+#include "list.h"
+#include "recorder.h"
+#include "runtime.h"
+#include "symbol.h"
+#include "tag.h"
+#include "unit.h"
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+RECORDER(profile, 16, "Profiler for RPL programs");
+
+
+struct profile_data
+// ----------------------------------------------------------------------------
+//   Profiling statistics, allocated the first time profiling starts
+// ----------------------------------------------------------------------------
+{
+    enum : uint { ENTRIES = 64, FRAMES = 16, NAME = 15, NONE = ~0U };
+
+    struct entry
+    {
+        uint        count;          // Number of evaluations or calls
+        uint        time;           // Time spent, in ms
+        uint        gc;             // Time spent collecting garbage, in ms
+        object::id  type;           // Type evaluated (ID_symbol for names)
+        byte        length;         // Length of the name, 0 for types
+        byte        name[NAME];     // Global name, possibly truncated
+    };
+
+    struct frame
+    {
+        size_t      depth;          // Call depth of the body of the name
+        uint        entry;          // Entry for the name
+        bool        ran;            // Something was charged to the name
+    };
+
+    profile_data(): entries(), frames(), used(), nframes(),
+                    current(NONE), caller(NONE), stamp(), gcstamp(),
+                    after(), level(), after_level(NONE),
+                    dropped(), generation()
+    {}
+
+    uint            lookup(object::id type, utf8 name, size_t len);
+    void            charge();
+
+    entry           entries[ENTRIES];
+    frame           frames[FRAMES];
+    uint            used;           // Number of entries in use
+    uint            nframes;        // Number of frames in use
+    uint            current;        // Entry being charged
+    uint            caller;         // Name entry being charged
+    uint            stamp;          // Time when last charged
+    size_t          gcstamp;        // Garbage collection time when charged
+    size_t          after;          // Call depth after last evaluation
+    uint            level;          // Nesting level of evaluations
+    uint            after_level;    // Nesting level for 'after'
+    uint            dropped;        // Evaluations not counted (table full)
+    uint            generation;     // Incremented when restarting
+};
+static profile_data *Profile = nullptr;
+bool profile::active = false;
+
+
+uint profile_data::lookup(object::id type, utf8 name, size_t len)
+// ----------------------------------------------------------------------------
+//   Find or create the entry for a type or a name
+// ----------------------------------------------------------------------------
+{
+    // Truncate long names on a character boundary
+    if (len > NAME)
+    {
+        len = NAME;
+        while (len && (name[len] & 0xC0) == 0x80)
+            len--;
+    }
+
+    for (uint i = 0; i < used; i++)
+    {
+        entry &e = entries[i];
+        if (e.type == type && e.length == len &&
+            (!len || memcmp(e.name, name, len) == 0))
+            return i;
+    }
+    if (used >= ENTRIES)
+    {
+        dropped++;
+        return NONE;
+    }
+
+    entry &e = entries[used];
+    e = entry();
+    e.type = type;
+    e.length = len;
+    if (len)
+        memcpy(e.name, name, len);
+    return used++;
+}
+
+
+void profile_data::charge()
+// ----------------------------------------------------------------------------
+//   Charge the time elapsed since last call to the current entries
+// ----------------------------------------------------------------------------
+{
+    uint   now = sys_current_ms();
+    size_t gc  = rt.gc_duration();
+    uint   dt  = now - stamp;
+    uint   dgc = gc >= gcstamp ? gc - gcstamp : gc; // Statistics were cleared
+    if (current != NONE)
+    {
+        entries[current].time += dt;
+        entries[current].gc += dgc;
+    }
+    if (caller != NONE)
+    {
+        entries[caller].time += dt;
+        entries[caller].gc += dgc;
+    }
+    stamp = now;
+    gcstamp = gc;
+}
+
+
+bool profile::start()
+// ----------------------------------------------------------------------------
+//   Clear the statistics and start profiling
+// ----------------------------------------------------------------------------
+{
+    profile_data *p = Profile;
+    if (!p)
+    {
+        // operator new support purposefully not linked in embedded versions
+        p = (profile_data *) malloc(sizeof(profile_data));
+        if (!p)
+            return false;
+        Profile = p;
+    }
+    uint generation = p->generation;
+    new(p) profile_data();
+    p->generation = generation + 1;
+    p->stamp = sys_current_ms();
+    p->gcstamp = rt.gc_duration();
+    active = true;
+    record(profile, "Start profiling, generation %u", p->generation);
+    return true;
+}
+
+
+void profile::stop()
+// ----------------------------------------------------------------------------
+//   Stop profiling, keeping the statistics
+// ----------------------------------------------------------------------------
+{
+    if (active)
+        Profile->charge();
+    active = false;
+    record(profile, "Stop profiling");
+}
+
+
+object::result profile::evaluate(object_g obj)
+// ----------------------------------------------------------------------------
+//   Evaluate an object and record statistics about it
+// ----------------------------------------------------------------------------
+{
+    profile_data *p = Profile;
+    if (!p)
+        return obj->evaluate();
+
+    // Leave the names whose body is done, charge what ran until now.
+    // Fetching the last object of a body pops it, so we check the depth
+    // before the fetch, unless this is the first object of a nested loop.
+    size_t depth  = rt.call_depth();
+    size_t before = p->after_level == p->level ? p->after : depth;
+    while (p->nframes && p->frames[p->nframes - 1].depth > before)
+        p->nframes--;
+    p->charge();
+
+    const uint NONE    = profile_data::NONE;
+    uint       current = p->current;
+    uint       caller  = p->caller;
+    object::id ty      = obj->type();
+    p->current = p->lookup(ty, nullptr, 0);
+    if (p->current != NONE)
+        p->entries[p->current].count++;
+    if (uint n = p->nframes)
+    {
+        p->caller = p->frames[n - 1].entry;
+        p->frames[n - 1].ran = true;
+    }
+    else
+    {
+        p->caller = NONE;
+    }
+
+    // A global name may run a program, record a frame for its body
+    uint nframe = p->nframes;
+    uint used   = p->used;
+    uint named  = NONE;
+    bool framed = false;
+    if (ty == object::ID_symbol)
+    {
+        size_t len  = 0;
+        utf8   name = symbol_p(object_p(obj))->value(&len);
+        named = p->lookup(ty, name, len);
+        framed = named != NONE && nframe < profile_data::FRAMES;
+        if (framed)
+        {
+            p->frames[nframe] = { depth + 1, named, false };
+            p->nframes = nframe + 1;
+        }
+    }
+
+    uint           generation = p->generation;
+    p->level++;
+    object::result result     = obj->evaluate();
+    if (p->generation != generation)
+        return result;              // Profiling was restarted meanwhile
+    p->level--;
+
+    p->charge();
+    p->current = current;
+    p->caller = caller;
+
+    if (named != NONE)
+    {
+        // Only count names that ran something, e.g. not undefined names
+        bool pending = rt.call_depth() > depth;
+        if (pending || (framed && p->frames[nframe].ran))
+            p->entries[named].count++;
+        else if (named == used && used + 1 == p->used)
+            p->used = used;         // Release the entry we just created
+        if (framed && !pending)
+            p->nframes = nframe;
+    }
+    p->after = rt.call_depth();
+    p->after_level = p->level;
+    return result;
+}
+
+
+list_p profile::report()
+// ----------------------------------------------------------------------------
+//   Build a list with the statistics, sorted by decreasing time
+// ----------------------------------------------------------------------------
+{
+    profile_data *p = Profile;
+    if (active)
+        p->charge();
+
+    // Sort the entries by decreasing time, then decreasing count
+    uint index[profile_data::ENTRIES];
+    uint count = 0;
+    for (uint i = 0; p && i < p->used; i++)
+    {
+        profile_data::entry &e = p->entries[i];
+        if (!e.count)
+            continue;
+        uint j = count++;
+        for (; j > 0; j--)
+        {
+            profile_data::entry &o = p->entries[index[j-1]];
+            if (o.time > e.time || (o.time == e.time && o.count >= e.count))
+                break;
+            index[j] = index[j-1];
+        }
+        index[j] = i;
+    }
+
+    algebraic_g ms = +symbol::make("ms");
+    scribble    scr;
+    for (uint i = 0; i < count; i++)
+    {
+        profile_data::entry &e = p->entries[index[i]];
+        utf8   label = e.name;
+        size_t len   = e.length;
+        if (!len)
+        {
+            label = object::name(e.type);
+            len = label ? strlen(cstring(label)) : 0;
+        }
+
+        integer_g   calls = integer::make(e.count);
+        algebraic_g time  = integer::make(e.time);
+        algebraic_g gc    = integer::make(e.gc);
+        time = unit::make(time, ms);
+        gc = unit::make(gc, ms);
+        if (!calls || !time || !gc)
+            return nullptr;
+
+        object_g values = list::make(calls, time, gc);
+        tag_g  item   = values ? tag::make(label, len, values) : nullptr;
+        if (!item || !rt.append(item))
+            return nullptr;
+    }
+    if (p && p->dropped)
+    {
+        tag_g dropped = tag::make("Dropped", integer::make(p->dropped));
+        if (!dropped || !rt.append(dropped))
+            return nullptr;
+    }
+    return list::make(scr.scratch(), scr.growth());
+}
+
+
+
+// ============================================================================
+//
+//   User commands
+//
+// ============================================================================
+
+COMMAND_BODY(ProfileStart)
+// ----------------------------------------------------------------------------
+//   Start profiling, clearing previous statistics
+// ----------------------------------------------------------------------------
+{
+    if (!profile::start())
+    {
+        rt.out_of_memory_error();
+        return ERROR;
+    }
+    return OK;
+}
+
+
+COMMAND_BODY(ProfileStop)
+// ----------------------------------------------------------------------------
+//   Stop profiling
+// ----------------------------------------------------------------------------
+{
+    profile::stop();
+    return OK;
+}
+
+
+COMMAND_BODY(ProfileReport)
+// ----------------------------------------------------------------------------
+//   Return the profiling statistics
+// ----------------------------------------------------------------------------
+{
+    if (list_p report = profile::report())
+        if (rt.push(report))
+            return OK;
+    return ERROR;
+}
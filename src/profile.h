@@ -0,0 +1,54 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+// ****************************************************************************
+//  profile.h                                                     DB48X project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Profiler for RPL programs
+//
+//     When active, the profiler counts how many times each type of object is
+//     evaluated, and how many times each global name is called, along with
+//     the time spent there. The time is only measured in milliseconds, so it
+//     is a statistical sample: each tick is attributed to the command that
+//     was running when it occurred.
+//
+//
+// ****************************************************************************
+//   (C) 2024 Christophe de Dinechin <christophe@dinechin.org>
+//   This software is licensed under the terms outlined in LICENSE.txt
+// ****************************************************************************
+//   This file is part of DB48X.
+//
+//   DB48X is free software: you can redistribute it and/or modify
+//   it under the terms outlined in the LICENSE.txt file
+//
+//   DB48X is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// ****************************************************************************
+
+#include "command.h"
+#include "list.h"
+
+
+struct profile
+// ----------------------------------------------------------------------------
+//   Collect per-command and per-name execution statistics
+// ----------------------------------------------------------------------------
+{
+    static bool         active;
+
+    static bool         start();
+    static void         stop();
+    static list_p       report();
+    static object::result evaluate(object_g obj);
+};
+
+
+COMMAND_DECLARE(ProfileStart,0);
+COMMAND_DECLARE(ProfileStop,0);
+COMMAND_DECLARE(ProfileReport,0);
+
+#endif // PROFILE_H
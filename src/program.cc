@@ -28,8 +28,10 @@
 
 #include "program.h"
 
+#include "arithmetic.h"
 #include "dmcp.h"
 #include "parser.h"
+#include "profile.h"
 #include "settings.h"
 #include "sysmenu.h"
 #include "tag.h"
@@ -195,7 +197,7 @@ object::result program::run_loop(size_t depth)
         }
         if (last_args)
             rt.need_save();
-        result = obj->evaluate();
+        result = profile::active ? profile::evaluate(obj) : obj->evaluate();
 
         if (result != OK)
         {
@@ -529,6 +531,14 @@ COMMAND_BODY(RuntimeStatistics)
         tag::make("Refresh",
                   unit::make(integer::make(program::refresh_time), ms));
     tag_g runcycles = tag::make("Runs", integer::make(program::run_cycles));
+    tag_g fasthits =
+        tag::make("FastHits", integer::make(arithmetic::fast_hits));
+    tag_g fastmisses =
+        tag::make("FastMisses", integer::make(arithmetic::fast_misses));
+    tag_g renderhits =
+        tag::make("RenderHits", integer::make(rt.CacheHits));
+    tag_g rendermisses =
+        tag::make("RenderMisses", integer::make(rt.CacheMisses));
 
     if (running && sleeping && runcycles)
     {
@@ -538,7 +548,11 @@ COMMAND_BODY(RuntimeStatistics)
             rt.append(display)   &&
             rt.append(stack)     &&
             rt.append(refresh)   &&
-            rt.append(runcycles))
+            rt.append(runcycles) &&
+            rt.append(fasthits)  &&
+            rt.append(fastmisses) &&
+            rt.append(renderhits) &&
+            rt.append(rendermisses))
         {
             size_t sz = scr.growth();
             gcbytes data = scr.scratch();
@@ -554,6 +568,10 @@ COMMAND_BODY(RuntimeStatistics)
                         program::stack_display_time = 0;
                         program::refresh_time       = 0;
                         program::run_cycles         = 0;
+                        arithmetic::fast_hits       = 0;
+                        arithmetic::fast_misses     = 0;
+                        rt.CacheHits                = 0;
+                        rt.CacheMisses              = 0;
                     }
                     return OK;
                 }
@@ -33,13 +33,17 @@
 #include "compare.h"
 #include "constants.h"
 #include "expression.h"
+#include "hash.h"
 #include "integer.h"
 #include "object.h"
 #include "program.h"
+#include "unit.h"
 #include "user_interface.h"
 #include "variables.h"
 
+#include <algorithm>
 #include <cstring>
+#include <stdlib.h>
 
 
 
@@ -70,8 +74,8 @@ void runtime_invariants::check_invariants()
     ASSERT(rt.XLibs <= rt.Constants);
     ASSERT(rt.Constants <= rt.CallStack);
     ASSERT(rt.Directories <= rt.XLibs);
-    ASSERT(rt.Locals <= rt.Directories);
-    ASSERT(rt.Undo <= rt.Locals);
+    ASSERT(rt.Undo <= rt.Directories);
+    ASSERT(!rt.Frame || (rt.Frame >= rt.Returns && rt.Frame < rt.HighMem));
     ASSERT(rt.Args <= rt.Undo);
     ASSERT(rt.Stack <= rt.Args);
 };
@@ -102,21 +106,28 @@ runtime::runtime(byte *mem, size_t size)
       Stack(),
       Args(),
       Undo(),
-      Locals(),
       Directories(),
       XLibs(),
       Constants(),
       CallStack(),
       Returns(),
+      Frame(),
       HighMem(),
       Cache(),
       CacheIndex(),
+      CacheHits(),
+      CacheMisses(),
+      Index(),
+      IndexIndex(),
       GCCycles(),
       GCPurged(),
       GCDuration(),
       GCLPurged(),
       GCLDuration(),
       GCCleared(),
+      GCLObjects(),
+      GCLRoots(),
+      GCLPasses(),
       GCUnclear(),
       SaveArgs(false)
 {
@@ -140,12 +151,17 @@ void runtime::memory(byte *memory, size_t size)
     Constants = CallStack;                      // No Constants loaded
     XLibs = Constants;                          // No XLibs loaded
     Directories = XLibs - 1;                    // Make room for one path
-    Locals = Directories;                       // No locals
-    Args = Locals;                              // No args
-    Undo = Locals;                              // No undo stack
-    Stack = Locals;                             // Empty stack
+    Args = Directories;                         // No args
+    Undo = Directories;                         // No undo stack
+    Stack = Directories;                        // Empty stack
+    Frame = nullptr;                            // No locals
 
     // Stuff at bottom of memory
+    uncache();
+    unindex();
+    directory::unindex();
+    expression::memo_flush();
+    unit::memo_flush();
     Globals = LowMem;
     directory_p home = new((void *) Globals) directory();   // Home directory
     *Directories = (object_p) home;             // Current search path
@@ -202,6 +218,16 @@ size_t runtime::available(size_t size)
     {
         gc();
         size_t avail = available();
+        if (avail < size)
+        {
+            // Release caches, rewrites and units before giving up
+            uncache();
+            unindex();
+            expression::memo_flush();
+            unit::memo_flush();
+            gc();
+            avail = available();
+        }
         if (avail < size)
             out_of_memory_error();
         return avail;
@@ -361,88 +387,463 @@ runtime::gcptr::~gcptr()
 }
 
 
-object_p runtime::cached(bool level0, object_p key)
+object_p runtime::cached(bool level0, object_p key, uint settings)
 // ----------------------------------------------------------------------------
-//   Check if there is a value associated to this object
+//   Check if there is a rendering for an object with the same contents
 // ----------------------------------------------------------------------------
 {
-    size_t max = sizeof(Cache[level0]) / sizeof(Cache[level0][0]);
-    for (uint i = 0; i < max; i += 2)
+    const uint max  = sizeof(Cache[level0]) / sizeof(Cache[level0][0]);
+    size_t     size = 0;
+    uint       hash = 0;
+    for (uint i = 0; i < max; i++)
     {
-        uint j = (CacheIndex - i) % max;
-        if (Cache[level0][j] == key)
+        uint         j = (CacheIndex + max - i) % max;
+        cache_entry &e = Cache[level0][j];
+        if (!e.key || e.settings != settings)
+            continue;
+        if (e.key != key)
         {
-            record(cache, "Got %p for %p at %u.%u",
-                   Cache[level0][j+1], key, level0, j);
-            return Cache[level0][j+1];
+            if (!size)
+            {
+                size = key->size();
+                hash = fnv1a(key, size);
+            }
+            if (e.hash != hash || e.key->size() != size ||
+                memcmp(e.key, key, size) != 0)
+                continue;
         }
+        record(cache, "Got %p for %p at %u.%u", e.value, key, level0, j);
+        CacheHits++;
+        return e.value;
     }
     record(cache, "Did not find %p", key);
+    CacheMisses++;
     return nullptr;
 }
 
 
-bool runtime::cache(bool level0, object_p key, object_p value)
+bool runtime::cache(bool level0, object_p key, uint settings, object_p value)
 // ----------------------------------------------------------------------------
-//   Cache the value
+//   Cache the rendering of an object
 // ----------------------------------------------------------------------------
 {
-    size_t max = sizeof(Cache[level0]) / sizeof(Cache[level0][0]);
-    for (uint i = 0; i < max; i += 2)
+    const uint max = sizeof(Cache[level0]) / sizeof(Cache[level0][0]);
+    for (uint i = 0; i < max; i++)
     {
-        uint j = (CacheIndex - i) % max;
-        if (Cache[level0][j] == key)
+        uint         j = (CacheIndex + max - i) % max;
+        cache_entry &e = Cache[level0][j];
+        if (e.key == key && e.settings == settings)
         {
             record(cache, "Replace %p with %p for %p at %u.%u",
-                   Cache[level0][j+1], value, key, level0, j);
-            Cache[level0][j+1] = value;
+                   e.value, value, key, level0, j);
+            e.value = value;
             return true;
         }
     }
-    CacheIndex = (CacheIndex + 2) % max;
+    CacheIndex = (CacheIndex + 1) % max;
+    cache_entry &e = Cache[level0][CacheIndex];
     record(cache, "Set  %p for %p at %u.%u, erasing %p",
-           value, key, level0, CacheIndex, Cache[level0][CacheIndex+1]);
-    Cache[level0][CacheIndex] = key;
-    Cache[level0][CacheIndex + 1] = value;
+           value, key, level0, CacheIndex, e.value);
+    e.key      = key;
+    e.value    = value;
+    e.hash     = fnv1a(key, key->size());
+    e.settings = settings;
+
+    // Cached values must survive temporaries cleanup
+    cleaner::disable();
     return false;
 }
 
 
 void runtime::uncache(object_p start, size_t sz)
 // ----------------------------------------------------------------------------
-//   Drop the whole cache
-// ------------------]----------------------------------------------------------
+//   Drop cache entries that refer to the given range
+// ----------------------------------------------------------------------------
 {
     object_p end = start + sz;
     record(cache, "Clear cache %p-%p sz %u", start, end, sz);
     for (uint l = 0; l < 2; l++)
     {
-        const uint max = sizeof(Cache[0]) / sizeof(Cache[0][0]);
-        for (uint i = 0; i < max; i++)
+        for (cache_entry &e : Cache[l])
+        {
+            if ((e.key >= start && e.key < end) ||
+                (e.value >= start && e.value < end))
+            {
+                e.key = nullptr;
+                e.value = nullptr;
+            }
+        }
+    }
+}
+
+
+const uint32_t *runtime::offsets(object_p key, size_t *count)
+// ----------------------------------------------------------------------------
+//   Return the element offsets for a list or array if they were recorded
+// ----------------------------------------------------------------------------
+{
+    for (index_entry &e : Index)
+    {
+        if (e.key == key)
+        {
+            record(cache, "Offsets for %p: %u items", key, e.count);
+            *count = e.count;
+            return e.offsets;
+        }
+    }
+    return nullptr;
+}
+
+
+void runtime::offsets(object_p key, uint32_t *table, size_t count)
+// ----------------------------------------------------------------------------
+//   Record the element offsets for a list, taking ownership of the table
+// ----------------------------------------------------------------------------
+{
+    const uint max = sizeof(Index) / sizeof(Index[0]);
+    IndexIndex = (IndexIndex + 1) % max;
+    index_entry &e = Index[IndexIndex];
+    record(cache, "Index %p with %u items at %u, erasing %p",
+           key, count, IndexIndex, e.key);
+    ::free(e.offsets);
+    e.key     = key;
+    e.offsets = table;
+    e.count   = count;
+
+    // Indexed objects must survive temporaries cleanup
+    cleaner::disable();
+}
+
+
+void runtime::unindex(object_p start, size_t sz)
+// ----------------------------------------------------------------------------
+//   Drop the element offsets for objects in the given range
+// ----------------------------------------------------------------------------
+{
+    object_p end = start + sz;
+    record(cache, "Clear index %p-%p sz %u", start, end, sz);
+    for (index_entry &e : Index)
+    {
+        if (e.key >= start && e.key < end)
+        {
+            ::free(e.offsets);
+            e.key = nullptr;
+            e.offsets = nullptr;
+            e.count = 0;
+        }
+    }
+}
+
+
+template <typename Fn>
+void runtime::safe_roots(Fn &fn)
+// ----------------------------------------------------------------------------
+//   Enumerate the GC-safe pointers, the only ones that can point to scratch
+// ----------------------------------------------------------------------------
+//   The editor and scratchpad are only referenced through GC-safe pointers,
+//   so moving them does not need to walk the stack and caches
+{
+    for (gcptr *p = GCSafe; p; p = p->next)
+        fn(&p->safe, true);
+}
+
+
+template <typename Fn>
+void runtime::roots(Fn &fn)
+// ----------------------------------------------------------------------------
+//   Enumerate all the pointers that may reference temporaries
+// ----------------------------------------------------------------------------
+//   The second argument to fn is true for GC-safe pointers, which may point
+//   one byte past the object they protect, and may point inside the editor
+//   or scratchpad, e.g. while a composite object is being built there
+{
+    // GC-safe pointers
+    safe_roots(fn);
+
+    // Stack, last args, undo, directories and return stack with locals
+    // Walk from the bottom, where the oldest objects are usually found,
+    // so that the GC sees mostly increasing addresses
+    for (object_p *s = HighMem; s > Stack; s--)
+        fn((byte **) s - 1, false);
+
+    // Error messages
+    fn((byte **) &Error, false);
+    fn((byte **) &ErrorSave, false);
+    fn((byte **) &ErrorSource, false);
+    fn((byte **) &ErrorCommand, false);
+
+    // User interface
+    fn((byte **) &ui.command, false);
+    fn((byte **) &ui.keymap, false);
+    fn((byte **) &ui.validate_input, false);
+
+    byte **label = (byte **) &ui.menuLabel[0][0];
+    for (uint l = 0; l < ui.NUM_MENUS; l++)
+        fn(label + l, false);
+
+    byte **functions = (byte **) &ui.function[0][0];
+    const uint max = sizeof(ui.function) / sizeof(ui.function[0][0]);
+    for (uint k = 0; k < max; k++)
+        fn(functions + k, false);
+
+    // Stack rendering cache
+    for (uint l = 0; l < 2; l++)
+    {
+        for (cache_entry &e : Cache[l])
         {
-            object_p &ptr = Cache[l][i];
-            if (ptr >= start && ptr < end)
-                ptr = nullptr;
+            fn((byte **) &e.key, false);
+            fn((byte **) &e.value, false);
         }
     }
+
+    // Element offset index
+    for (index_entry &e : Index)
+        fn((byte **) &e.key, false);
 }
 
 
+struct gc_sweep
+// ----------------------------------------------------------------------------
+//   Walk temporaries in address order, marking and compacting in one sweep
+// ----------------------------------------------------------------------------
+//   Marks must be given in increasing address order. An object is finalized
+//   once no future mark can fall in it, at which point it is either slid
+//   down over the space recycled so far, or its size is added to recycled.
+//   Contiguous live objects are moved with a single memmove.
+{
+    gc_sweep(object_p first, object_p last)
+        : obj(first), next(first < last ? first->skip() : first), last(last),
+          run(nullptr), recycled(0), objects(0), live(false)
+    {}
+
+    void mark(byte_p at)
+    // ------------------------------------------------------------------------
+    //   Mark the object containing the given address
+    // ------------------------------------------------------------------------
+    {
+        advance(at);
+        if (obj < last && at >= byte_p(obj))
+            live = true;
+    }
+
+    void advance(byte_p to)
+    // ------------------------------------------------------------------------
+    //   Finalize all objects that end at or before the given address
+    // ------------------------------------------------------------------------
+    {
+        while (obj < last && byte_p(next) <= to)
+        {
+            if (live)
+            {
+                if (!run)
+                    run = obj;
+            }
+            else
+            {
+                flush();
+                recycled += next - obj;
+                record(gc_details, "Recycling %p size %u total %u",
+                       obj, next - obj, recycled);
+            }
+            obj = next;
+            next = obj < last ? obj->skip() : obj;
+            live = false;
+            objects++;
+        }
+    }
+
+    void flush()
+    // ------------------------------------------------------------------------
+    //   Move the current run of live objects to its final location
+    // ------------------------------------------------------------------------
+    {
+        if (run)
+        {
+            if (recycled)
+            {
+                record(gc_details, "Moving %p-%p to %p",
+                       run, obj, run - recycled);
+                memmove((byte *) run - recycled, run, obj - run);
+            }
+            run = nullptr;
+        }
+    }
+
+    size_t finish()
+    // ------------------------------------------------------------------------
+    //   Finalize all remaining objects, return the total size recycled
+    // ------------------------------------------------------------------------
+    {
+        advance(byte_p(last));
+        flush();
+        return recycled;
+    }
+
+    object_p obj;               // Object being scanned (original address)
+    object_p next;              // End of object being scanned
+    object_p last;              // End of temporaries
+    object_p run;               // Start of current run of live objects
+    size_t   recycled;          // Bytes recycled below obj
+    size_t   objects;           // Number of objects finalized
+    bool     live;              // Object being scanned is referenced
+};
+
+
+struct gc_roots
+// ----------------------------------------------------------------------------
+//   Select the next batch of roots, in increasing order of target address
+// ----------------------------------------------------------------------------
+//   Entries in the table are root slot addresses, with the low bit set for
+//   GC-safe pointers (slots are pointer-aligned, so that bit is free).
+//   A batch always holds all the roots pointing to its highest address,
+//   so that the sweep can finalize everything up to that address.
+{
+    gc_roots(uintptr_t *table, size_t capacity,
+             byte_p first, byte_p last, byte_p scratch)
+        : table(table), capacity(capacity), count(0),
+          first(first), last(last), scratch(scratch),
+          above(nullptr), top(nullptr), overflow(false), scanned(0)
+    {}
+
+    static byte **slot(uintptr_t entry)
+    {
+        return (byte **) (entry & ~uintptr_t(1));
+    }
+    static byte_p value(uintptr_t entry)
+    {
+        return *slot(entry);
+    }
+    static bool gcsafe(uintptr_t entry)
+    {
+        return entry & 1;
+    }
+    bool candidate(byte_p ptr, bool safe) const
+    {
+        return ptr >= first && (safe ? ptr <= scratch : ptr < last)
+            && (!above || ptr > above);
+    }
+    static bool before(uintptr_t x, uintptr_t y)
+    {
+        return value(x) < value(y);
+    }
+
+    void operator()(byte **where, bool safe)
+    // ------------------------------------------------------------------------
+    //   Insert a root in the batch, keeping the lowest addresses in a heap
+    // ------------------------------------------------------------------------
+    {
+        scanned++;
+        byte_p ptr = *where;
+        if (!candidate(ptr, safe))
+            return;
+        uintptr_t entry = uintptr_t(where) | uintptr_t(safe);
+        if (count < capacity)
+        {
+            table[count++] = entry;
+            std::push_heap(table, table + count, before);
+        }
+        else if (ptr < value(table[0]))
+        {
+            overflow = true;
+            std::pop_heap(table, table + count, before);
+            table[count-1] = entry;
+            std::push_heap(table, table + count, before);
+        }
+        else
+        {
+            overflow = true;
+        }
+    }
+
+    bool select()
+    // ------------------------------------------------------------------------
+    //   Select the next batch, return false if no roots remain
+    // ------------------------------------------------------------------------
+    {
+        count = 0;
+        overflow = false;
+        top = nullptr;
+        rt.roots(*this);
+        if (!count)
+            return false;
+
+        // If some roots were left out, drop the entries for the highest
+        // address, since some other roots may point there as well
+        top = value(table[0]);
+        if (overflow)
+        {
+            while (count && value(table[0]) == top)
+                std::pop_heap(table, table + count--, before);
+            if (count)
+                top = value(table[0]);
+        }
+        std::sort_heap(table, table + count, before);
+        return true;
+    }
+
+    uintptr_t *table;           // Table of selected root slots
+    size_t     capacity;        // Maximum number of entries in table
+    size_t     count;           // Number of entries in current batch
+    byte_p     first;           // Start of garbage-collected area
+    byte_p     last;            // End of temporaries
+    byte_p     scratch;         // End of scratchpad
+    byte_p     above;           // All roots up to this address were done
+    byte_p     top;             // Highest address in the current batch
+    bool       overflow;        // Some candidates did not fit in batch
+    size_t     scanned;         // Number of root slots visited
+};
+
+
+struct gc_forward
+// ----------------------------------------------------------------------------
+//   Mark and forward all the roots pointing to a single address
+// ----------------------------------------------------------------------------
+//   This is used when there are more such roots than fit in the batch table
+{
+    gc_forward(gc_roots &batch, byte_p target)
+        : batch(batch), target(target), delta(0),
+          gcsafe(false), forwarding(false)
+    {}
+
+    void operator()(byte **where, bool safe)
+    {
+        batch.scanned++;
+        if (*where == target && batch.candidate(target, safe))
+        {
+            if (forwarding)
+                *where -= delta;
+            else
+                gcsafe = gcsafe || safe;
+        }
+    }
+
+    gc_roots &batch;
+    byte_p    target;
+    size_t    delta;
+    bool      gcsafe;
+    bool      forwarding;
+};
+
+
 size_t runtime::gc()
 // ----------------------------------------------------------------------------
 //   Recycle unused temporaries
 // ----------------------------------------------------------------------------
 //   Temporaries can only be referenced from the stack
 //   Objects in the global area are copied there, so they need no recycling
-//   This algorithm is linear in number of objects and moves only live data
+//
+//   The roots are gathered in batches sorted by the address they point to,
+//   using the free space above the scratchpad to hold the batch.
+//   Each batch is merged with a single walk of the temporaries that marks
+//   live objects, slides them down over recycled space, and forwards the
+//   roots of the batch. When memory is plentiful, there is a single batch,
+//   and the whole collection is linear in number of objects and roots.
 {
     lock     it;
     uint     now      = sys_current_ms();
-    size_t   recycled = 0;
     object_p first    = (object_p) Globals;
     object_p last     = Temporaries;
-    object_p free     = first;
-    object_p next;
+    size_t   above    = Editing + Scratch;
 
     ui.draw_busy(L'●', Settings.GCIconForeground());
 
@@ -463,81 +864,71 @@ size_t runtime::gc()
                          first, last, Stack, XLibs);
 #endif // SIMULATOR
 
-    object_p *firstobjptr = Stack;
-    object_p *lastobjptr = HighMem;
+    // Use the free space between scratchpad and stack for the root table
+    const size_t minimum = 16;
+    uintptr_t    spare[minimum];
+    byte_p       scratch  = byte_p(last) + above;
+    uintptr_t    aligned  = (uintptr_t(scratch) + sizeof(uintptr_t) - 1)
+                          & ~(sizeof(uintptr_t) - 1);
+    uintptr_t   *table    = (uintptr_t *) aligned;
+    size_t       capacity = (object_p *) Stack - (object_p *) table;
+    if (aligned > uintptr_t(Stack) || capacity < minimum)
+    {
+        table = spare;
+        capacity = minimum;
+    }
 
-    for (object_p obj = first; obj < last; obj = next)
+    gc_sweep sweep(first, last);
+    gc_roots batch(table, capacity, byte_p(first), byte_p(last), scratch);
+    size_t   passes = 0;
+    while (batch.select())
     {
-        bool found = false;
-        next = obj->skip();
-        record(gc_details, "Scanning object %p (ends at %p)", obj, next);
-        for (object_p *s = firstobjptr; s < lastobjptr && !found; s++)
+        passes++;
+        if (!batch.count)
         {
-            found = *s >= obj && *s < next;
-            if (found)
-                record(gc_details, "Found %p at stack level %u",
-                       obj, s - firstobjptr);
+            // Too many roots pointing to the same address: handle it alone
+            gc_forward forward(batch, batch.top);
+            roots(forward);
+            if (forward.gcsafe && batch.top > byte_p(first))
+                sweep.mark(batch.top - 1);
+            sweep.mark(batch.top);
+            forward.delta = sweep.recycled;
+            forward.forwarding = true;
+            roots(forward);
+            passes += 2;
         }
-        if (!found)
-        {
-            for (gcptr *p = GCSafe; p && !found; p = p->next)
-            {
-                found = p->safe >= (byte *) obj && p->safe <= (byte *) next;
-                if (found)
-                    record(gc_details, "Found %p in GC-safe pointer %p (%p)",
-                           obj, p->safe, p);
-            }
-        }
-        if (!found)
+        else
         {
-            // Check if some of the error information was user-supplied
-            utf8 start = utf8(obj);
-            utf8 end = utf8(next);
-            found = (Error         >= start && Error         < end)
-                ||  (ErrorSave     >= start && ErrorSave     < end)
-                ||  (ErrorSource   >= start && ErrorSource   < end)
-                ||  (ErrorCommand  >= obj   && ErrorCommand  < next)
-                ||  (ui.command    >= start && ui.command    < end)
-                ||  (ui.keymap     >= obj   && ui.keymap     < next);
-            if (!found)
+            for (size_t i = 0; i < batch.count; )
             {
-                utf8 *label = (utf8 *) &ui.menuLabel[0][0];
-                for (uint l = 0; !found && l < ui.NUM_MENUS; l++)
-                    found = label[l] >= start && label[l] < end;
-
-                object_p *functions = &ui.function[0][0];
-                const uint max = sizeof(ui.function)/sizeof(ui.function[0][0]);
-                for (uint k = 0; !found && k < max; k++)
-                    found = functions[k] >= obj && functions[k] < next;
-
-                if (!found)
-                {
-                    object_p vi = object_p(ui.validate_input);
-                    found = (vi >= obj && vi < next);
-                }
+                // Process all roots pointing to the same address
+                byte_p target = gc_roots::value(batch.table[i]);
+                size_t end = i;
+                bool   safe = false;
+                while (end < batch.count &&
+                       gc_roots::value(batch.table[end]) == target)
+                    safe = gc_roots::gcsafe(batch.table[end++]) || safe;
+
+                // GC-safe pointers also protect the object they end
+                if (safe && target > byte_p(first))
+                    sweep.mark(target - 1);
+                sweep.mark(target);
+
+                // Forward the roots to the final location of the object
+                size_t delta = sweep.recycled;
+                for (; i < end; i++)
+                    *gc_roots::slot(batch.table[i]) -= delta;
             }
         }
-
-        if (found)
-        {
-            // Move object to free space
-            record(gc_details, "Moving %p-%p to %p", obj, next, free);
-            move(free, obj, next - obj);
-            free += next - obj;
-        }
-        else
-        {
-            recycled += next - obj;
-            record(gc_details, "Recycling %p size %u total %u",
-                   obj, next - obj, recycled);
-        }
+        batch.above = batch.top;
     }
+    size_t recycled = sweep.finish();
 
     // Move the command line and scratch buffer
-    if (Editing + Scratch)
+    if (above && recycled)
     {
         object_p edit = Temporaries;
-        move(edit - recycled, edit, Editing + Scratch, 1, true);
+        memmove((byte *) edit - recycled, edit, above);
     }
 
     // Adjust Temporaries
@@ -559,14 +950,12 @@ size_t runtime::gc()
                          Stack, XLibs);
 #endif // SIMULATOR
 
-    record(gc, "Garbage collection done, purged %u, available %u",
-           recycled, available());
+    record(gc, "Garbage collection done, purged %u, available %u, "
+           "%u objects, %u roots in %u passes",
+           recycled, available(), sweep.objects, batch.scanned, passes);
 
     ui.draw_busy();
 
-    // Clear the cache
-    uncache();
-
     // Update statistics
     uint duration = sys_current_ms() - now;
     GCCycles += 1;
@@ -574,19 +963,52 @@ size_t runtime::gc()
     GCLDuration = duration;
     GCPurged += recycled;
     GCDuration += duration;
+    GCLObjects = sweep.objects;
+    GCLRoots = batch.scanned;
+    GCLPasses = passes;
 
     return recycled;
 }
 
 
+struct gc_move
+// ----------------------------------------------------------------------------
+//   Adjust the roots pointing into a memory range that was moved
+// ----------------------------------------------------------------------------
+{
+    gc_move(object_p from, object_p last, int delta, bool scratch)
+        : from(byte_p(from)), last(byte_p(last)), delta(delta),
+          scratch(scratch)
+    {}
+
+    void operator()(byte **where, bool safe)
+    {
+        // With scratch, only adjust the GC-safe pointers
+        if (safe || !scratch)
+        {
+            byte *ptr = *where;
+            if (ptr >= from && ptr < last)
+            {
+                record(gc_details, "Adjusting %p from %p to %p",
+                       where, ptr, ptr + delta);
+                *where = ptr + delta;
+            }
+        }
+    }
+
+    byte_p from;
+    byte_p last;
+    int    delta;
+    bool   scratch;
+};
+
+
 void runtime::move(object_p to, object_p from,
                    size_t size, size_t overscan, bool scratch)
 // ----------------------------------------------------------------------------
 //   Move objects in memory to a new location, adjusting pointers
 // ----------------------------------------------------------------------------
 //   This is called from various places that need to move memory.
-//   - During garbage collection, when we move an object to its new location.
-//     In that case, we don't want to move a pointer that is outside of object.
 //   - When writing a global variable and moving everything above it.
 //     In that case, we need to move everything up to the end of temporaries.
 //   - When building temporary objects in the scratchpad
@@ -596,6 +1018,7 @@ void runtime::move(object_p to, object_p from,
 //   we don't need to adjust stack or function pointers, only gc-safe pointers.
 //   Furthermore, scratch pointers may (temporarily) be above the scratch area.
 //   See list parser for an example.
+//   Pointers are adjusted using the same root enumeration as the GC.
 {
     int delta = to - from;
     if (!delta)
@@ -608,68 +1031,11 @@ void runtime::move(object_p to, object_p from,
     object_p last = from + size + overscan;
     record(gc_details, "Move %p to %p size %u, %+s",
            from, to, size, scratch ? "scratch" : "no scratch");
-    for (gcptr *p = GCSafe; p; p = p->next)
-    {
-        if (p->safe >= (byte *) from && p->safe < (byte *) last)
-        {
-            if ((long(p->safe) & 0xffffff) == 0x23ffa)
-                record(gc_details, "Badaboom");
-            record(gc_details, "Adjusting GC-safe %p from %p to %p",
-                   p, p->safe, p->safe + delta);
-            p->safe += delta;
-        }
-    }
-
-    // No need to walk the stack pointers and function pointers
+    gc_move adjust(from, last, delta, scratch);
     if (scratch)
-        return;
-
-    // Adjust the stack pointers
-    object_p *firstobjptr = Stack;
-    object_p *lastobjptr = HighMem;
-    for (object_p *s = firstobjptr; s < lastobjptr; s++)
-    {
-        if (*s >= from && *s < last)
-        {
-            record(gc_details, "Adjusting stack level %u from %p to %p",
-                   s - firstobjptr, *s, *s + delta);
-            *s += delta;
-        }
-    }
-
-    // Adjust error messages
-    utf8 start = utf8(from);
-    utf8 end   = utf8(last);
-    if (Error >= start && Error < end)
-        Error += delta;
-    if (ErrorSave >= start && ErrorSave < end)
-        ErrorSave += delta;
-    if (ErrorSource >= start && ErrorSource < end)
-        ErrorSource += delta;
-    if (ErrorCommand >= from && ErrorCommand < last)
-        ErrorCommand += delta;
-    if (ui.command >= start && ui.command < end)
-        ui.command += delta;
-    if (object_p vi = object_p(ui.validate_input))
-        if (vi >= from && vi < last)
-            ui.validate_input = (typeof(ui.validate_input))(vi + delta);
-
-    // Adjust menu labels
-    utf8 *label = (utf8 *) &ui.menuLabel[0][0];
-    for (uint l = 0; l < ui.NUM_MENUS; l++)
-        if (label[l] >= start && label[l] < end)
-            label[l] += delta;
-
-    // Adjust keymap
-    if (ui.keymap >= from && ui.keymap < last)
-        ui.keymap = list_p(object_p(ui.keymap) + delta);
-
-    // Adjust functions
-    object_p *functions = &ui.function[0][0];
-    const uint max = sizeof(ui.function) / sizeof(ui.function[0][0]);
-    for (uint k = 0; k < max; k++)
-        if (functions[k] >= from && functions[k] < last)
-            functions[k] += delta;
+        safe_roots(adjust);
+    else
+        roots(adjust);
 }
 
 
@@ -683,6 +1049,13 @@ void runtime::move_globals(object_p to, object_p from)
     object_p last = (object_p) scratchpad() + allocated();
     object_p first = to < from ? to : from;
     size_t moving = last - from;
+
+    // Remove cached entries for objects that are about to be overwritten
+    if (to < from)
+    {
+        uncache(to, from - to);
+        unindex(to, from - to);
+    }
     move(to, from, moving, 1);
 
     // Adjust Globals and Temporaries (for Temporaries, must be <=, not <)
@@ -691,8 +1064,8 @@ void runtime::move_globals(object_p to, object_p from)
         Globals += delta;
     Temporaries += delta;
 
-    // Remove all cached entries, they may be covered by what we moved
-    uncache(from, moving);
+    directory::reindex(to, from);
+    expression::memo_flush();
 }
 
 #ifdef DM42
@@ -712,6 +1085,8 @@ size_t runtime::insert(size_t offset, utf8 data, size_t len)
 // ----------------------------------------------------------------------------
 //   Insert data in the editor, return size inserted
 // ----------------------------------------------------------------------------
+//   The text after the offset and the scratchpad are still moved, so the
+//   cost is linear in their size, but only GC-safe pointers are adjusted
 {
     record(editor,
            "Insert %u bytes at offset %u starting with %c, %u available",
@@ -722,7 +1097,7 @@ size_t runtime::insert(size_t offset, utf8 data, size_t len)
         {
             size_t moved = Scratch + Editing - offset;
             byte_p edr = (byte_p) editor() + offset;
-            move(object_p(edr + len), object_p(edr), moved);
+            move(object_p(edr + len), object_p(edr), moved, 0, true);
             memcpy(editor() + offset, data, len);
             Editing += len;
             return len;
@@ -742,6 +1117,7 @@ size_t runtime::remove(size_t offset, size_t len)
 // ----------------------------------------------------------------------------
 //   Remove characers from the editor
 // ----------------------------------------------------------------------------
+//   Like insert(), this moves the rest of the editor and the scratchpad
 {
     record(editor, "Removing %u bytes at offset %u", len, offset);
     size_t end = offset + len;
@@ -752,7 +1128,7 @@ size_t runtime::remove(size_t offset, size_t len)
     len = end - offset;
     size_t moving = Scratch + Editing - end;
     byte_p edr = (byte_p) editor() + offset;
-    move(object_p(edr), object_p(edr + len), moving);
+    move(object_p(edr), object_p(edr + len), moving, 0, true);
     Editing -= len;
     return len;
 }
@@ -981,7 +1357,7 @@ object_p runtime::clone_global(object_p global, size_t sz)
     object_p  cloned = nullptr;
     object_p *begin  = Stack;
     object_p *end    = HighMem;
-    uncache(global);
+    uncache(global, sz);
     for (object_p *s = begin; s < end; s++)
     {
         if (*s >= global && *s < global + sz)
@@ -1375,19 +1751,32 @@ runtime &runtime::command(object_p cmd)
 //
 // ============================================================================
 
+object_p *runtime::local_slot(uint index)
+// ----------------------------------------------------------------------------
+//   Find where the local at given index is stored, walking enclosing frames
+// ----------------------------------------------------------------------------
+{
+    for (object_p *frame = Frame; frame; frame = (object_p *) frame[0])
+    {
+        object_p *outer = (object_p *) frame[0];
+        size_t    count = size_t(frame[1]) - (outer ? size_t(outer[1]) : 0);
+        if (index < count)
+            return frame + 2 + index;
+        index -= count;
+    }
+    undefined_local_name_error();
+    return nullptr;
+}
+
+
 object_p runtime::local(uint index)
 // ----------------------------------------------------------------------------
 //   Fetch local at given index
 // ----------------------------------------------------------------------------
 {
     runtime_invariants check;
-    size_t count = Directories - Locals;
-    if (index >= count)
-    {
-        undefined_local_name_error();
-        return nullptr;
-    }
-    return Locals[index];
+    object_p *slot = local_slot(index);
+    return slot ? *slot : nullptr;
 }
 
 
@@ -1396,26 +1785,31 @@ object_p runtime::local(uint index, object_p obj)
 //   Set a local in the local stack
 // ----------------------------------------------------------------------------
 {
-    runtime_invariants check
-;
-    size_t count = Directories - Locals;
-    if (index >= count || !obj)
+    runtime_invariants check;
+    if (!obj)
     {
         undefined_local_name_error();
         return nullptr;
     }
-    Locals[index] = obj;
+    object_p *slot = local_slot(index);
+    if (!slot)
+        return nullptr;
+    *slot = obj;
     return obj;
 }
 
 
 bool runtime::locals(size_t count)
 // ----------------------------------------------------------------------------
-//   Allocate the given number of locals from stack
+//   Move the given number of values from the stack into a local frame
 // ----------------------------------------------------------------------------
+//   The frame is allocated on the return stack, so that the cost does not
+//   depend on the depth of the user stack. If the innermost frame is at the
+//   top of the return stack, it grows instead, so that successive bindings,
+//   e.g. for the wildcards of a rewrite rule, stay in a single frame
 {
-    runtime_invariants check
-;
+    runtime_invariants check;
+
     // We need that many arguments
     if (count > depth())
     {
@@ -1423,24 +1817,31 @@ bool runtime::locals(size_t count)
         return false;
     }
 
-    // Check if we have the memory
-    size_t req = count * sizeof(void *);
-    if (available(req) < req)
-        return false;
+    // Make room for the locals and the frame header
+    bool   grow = Frame && Frame == Returns;
+    size_t size = grow ? count : count + 2;
+    while (size_t(Returns - CallStack) < size)
+    {
+        object_p next = nullptr;
+        object_p end = nullptr;
+        if (!call_stack_grow(next, end))
+            return false;
+    }
 
-    // Move pointers down
-    Stack -= count;
-    Args -= count;
-    Undo -= count;
-    Locals -= count;
-    size_t moving = Locals - Stack;
-    for (size_t i = 0; i < moving; i++)
-        Stack[i] = Stack[i + count];
+    // When growing, the old header is overwritten by the last new locals
+    object_p  outer = grow ? Frame[0] : object_p(Frame);
+    size_t    total = locals() + count;
+    object_p *frame = Returns - size;
+    frame[0] = outer;
+    frame[1] = object_p(total);
 
     // In `→ X Y « X Y - X Y +`, X is level 1 of the stack, Y is level 0
+    object_p *values = frame + 2;
     for (size_t var = 0; var < count; var++)
-        Locals[count - 1 - var] = *Stack++;
+        values[count - 1 - var] = *Stack++;
 
+    Returns = frame;
+    Frame = frame;
     return true;
 }
 
@@ -1449,27 +1850,48 @@ bool runtime::unlocals(size_t count)
 // ----------------------------------------------------------------------------
 //    Free the given number of locals
 // ----------------------------------------------------------------------------
+//    The innermost frame is normally at the top of the return stack.
+//    If a halted program left entries above it, they are moved up.
 {
     runtime_invariants check;
-    if (count)
+
+    // Sanity check on what we remove
+    if (count > locals())
+    {
+        undefined_local_name_error();
+        return false;
+    }
+
+    while (count)
     {
-        // Sanity check on what we remove
-        if (count > size_t(Directories - Locals))
+        object_p *frame = Frame;
+        object_p *outer = (object_p *) frame[0];
+        size_t    total = size_t(frame[1]);
+        size_t    fsize = total - (outer ? size_t(outer[1]) : 0);
+        size_t    words = fsize + 2;
+        if (count < fsize)
         {
-            undefined_local_name_error();
-            return false;
+            // Only remove the innermost locals, keep a smaller frame
+            words = count;
+            Frame = frame + words;
+            Frame[0] = object_p(outer);
+            Frame[1] = object_p(total - count);
+            count = 0;
         }
+        else
+        {
+            Frame = outer;
+            count -= fsize;
+        }
+
+        if (frame > Returns)
+            memmove(Returns + words, Returns,
+                    (frame - Returns) * sizeof(object_p));
 
-        // Move pointers up
-        object_p *oldp = Locals;
-        Stack += count;
-        Args += count;
-        Undo += count;
-        Locals += count;
-        object_p *newp = Locals;
-        size_t moving = Locals - Stack;
-        for (size_t i = 0; i < moving; i++)
-            *(--newp) = *(--oldp);
+        // Clear what we free, since the GC scans the call stack reserve
+        for (size_t w = 0; w < words; w++)
+            Returns[w] = nullptr;
+        call_stack_drop(words);
     }
 
     return true;
@@ -1517,7 +1939,6 @@ bool runtime::enter(directory_p dir)
     Stack--;
     Args--;
     Undo--;
-    Locals--;
     Directories--;
 
     size_t moving = Directories - Stack;
@@ -1548,7 +1969,6 @@ bool runtime::updir(size_t count)
     Stack += count;
     Args += count;
     Undo += count;
-    Locals += count;
     Directories += count;
 
     object_p *newp = Directories;
@@ -1594,7 +2014,6 @@ bool runtime::attach(size_t nentries)
         Stack       -= count;
         Args        -= count;
         Undo        -= count;
-        Locals      -= count;
         Directories -= count;
         XLibs       -= count;
     }
@@ -1630,7 +2049,6 @@ bool runtime::constants(size_t nentries)
         Stack       -= count;
         Args        -= count;
         Undo        -= count;
-        Locals      -= count;
         Directories -= count;
         XLibs       -= count;
         Constants   -= count;
@@ -1906,7 +2324,6 @@ bool runtime::call_stack_grow(object_p &next, object_p &end)
     Stack -= CALLS_BLOCK;
     Args -= CALLS_BLOCK;
     Undo -= CALLS_BLOCK;
-    Locals -= CALLS_BLOCK;
     Directories -= CALLS_BLOCK;
     XLibs -= CALLS_BLOCK;
     Constants -= CALLS_BLOCK;
@@ -1926,7 +2343,6 @@ void runtime::call_stack_drop()
     Stack += CALLS_BLOCK;
     Args += CALLS_BLOCK;
     Undo += CALLS_BLOCK;
-    Locals += CALLS_BLOCK;
     Directories += CALLS_BLOCK;
     XLibs += CALLS_BLOCK;
     Constants += CALLS_BLOCK;
@@ -32,7 +32,7 @@
 //
 //      HighMem         End of usable memory
 //        [Pointer to return address N]
-//        [... intermediate return addresses ...]
+//        [... intermediate return addresses and local frames ...]
 //        [Pointer to return address 0]
 //      Returns
 //        [... Returns reserve]
@@ -45,10 +45,6 @@
 //        [ ... intermediate directory pointers ...]
 //        [Pointer to innermost directory in path]
 //      Directories     Bottom of stack, start of global
-//        [Local N]
-//        [...]
-//        [Local 0]
-//      Locals
 //        [Last stack from command-line evaluation]
 //      Undo
 //        [Arguments to last command]
@@ -77,7 +73,17 @@
 //   Everything above Stack is word-aligned
 //   Everything below Temporaries is byte-aligned
 //   Stack elements point to temporaries, globals or robjects (read-only)
-//   Everything above Stack is pointers to garbage-collected RPL objects
+//   Everything above Stack is pointers to garbage-collected RPL objects,
+//   except for markers and frame headers in the return stack
+//
+//   Local variables live in frames on the return stack, so that creating
+//   or removing them does not move the user stack. A frame is laid out as:
+//        [Local N-1]
+//        [...]
+//        [Local 0]
+//        [Total number of locals, including enclosing frames]
+//        [Pointer to the enclosing frame, or null]
+//      Frame           Innermost frame
 
 #include "recorder.h"
 #include "types.h"
@@ -338,13 +344,25 @@ struct runtime
     //
     // ========================================================================
 
-    object_p cached(bool level0, object_p key);
-    bool     cache(bool level0, object_p key, object_p value);
+    object_p cached(bool level0, object_p key, uint settings);
+    bool     cache(bool level0, object_p key, uint settings, object_p value);
     void     uncache(object_p key, size_t sz);
     void     uncache(object_p key)      { uncache(key, 1); }
     void     uncache()                  { uncache(nullptr, ~0UL); }
 
 
+    // ========================================================================
+    //
+    //   Element offset index (for random access in large lists)
+    //
+    // ========================================================================
+
+    const uint32_t *offsets(object_p key, size_t *count);
+    void     offsets(object_p key, uint32_t *table, size_t count);
+    void     unindex(object_p key, size_t sz);
+    void     unindex()                  { unindex(nullptr, ~0UL); }
+
+
     // ========================================================================
     //
     //   Object management
@@ -356,6 +374,28 @@ struct runtime
     //   Garbage collector (purge unused objects from memory to make space)
     // ------------------------------------------------------------------------
 
+    // Statistics used to measure memory activity, e.g. in benchmarks
+    size_t gc_cycles() const    { return GCCycles; }
+    size_t gc_purged() const    { return GCPurged; }
+    size_t gc_duration() const  { return GCDuration; }
+    size_t temporaries() const
+    {
+        return (byte_p) Temporaries - (byte_p) Globals;
+    }
+
+
+    template <typename Fn>
+    void roots(Fn &fn);
+    // ------------------------------------------------------------------------
+    //   Invoke fn(slot, gcsafe) for every pointer that references objects
+    // ------------------------------------------------------------------------
+
+    template <typename Fn>
+    void safe_roots(Fn &fn);
+    // ------------------------------------------------------------------------
+    //   Invoke fn(slot, true) for GC-safe pointers only
+    // ------------------------------------------------------------------------
+
 
     void move(object_p to, object_p from,
               size_t sz, size_t overscan = 0, bool scratch=false);
@@ -569,7 +609,7 @@ struct runtime
     // ------------------------------------------------------------------------
     {
         runtime_invariants check;
-        if (Returns <= CallStack)
+        if (Returns < CallStack + 2)        // Local frames can be odd-sized
             if (!call_stack_grow(next, end))
                 return false;
         *(--Returns) = end;
@@ -617,7 +657,11 @@ struct runtime
                         call_stack_drop(2);
                     return next;
                 }
+
+                // End of a local scope: the frame is just below the marker
+                call_stack_drop(2);
                 unlocals(size_t(end) - 1);
+                continue;
             }
 
             call_stack_drop(2);
@@ -682,9 +726,11 @@ struct runtime
     // ------------------------------------------------------------------------
     //  Manage the call stack in blocks
     // ------------------------------------------------------------------------
+    //  Keep one spare block, so that entering and leaving a call or local
+    //  frame at a block boundary does not move the user stack every time
     {
         Returns += n;
-        if (Returns >= CallStack + CALLS_BLOCK)
+        if (Returns >= CallStack + 2 * CALLS_BLOCK)
             call_stack_drop();
     }
 
@@ -809,7 +855,7 @@ struct runtime
     //   Return the size of the stack save area
     // ------------------------------------------------------------------------
     {
-        return Locals - Undo;
+        return Directories - Undo;
     }
 
     bool undo();
@@ -837,7 +883,7 @@ struct runtime
 
     bool locals(size_t count);
     // ------------------------------------------------------------------------
-    //   Allocate the given number of locals from stack
+    //   Move the given number of values from the stack into a new local frame
     // ------------------------------------------------------------------------
 
     bool unlocals(size_t count);
@@ -850,9 +896,14 @@ struct runtime
     //   Return the number of locals
     // ------------------------------------------------------------------------
     {
-        return Directories - Locals;
+        return Frame ? size_t(Frame[1]) : 0;
     }
 
+    object_p *local_slot(uint index);
+    // ------------------------------------------------------------------------
+    //   Find where the local at the given index is stored
+    // ------------------------------------------------------------------------
+
 
 
     // ========================================================================
@@ -1070,6 +1121,22 @@ struct runtime
     // ------------------------------------------------------------------------
 
 
+    bool is_global(object_p obj)
+    // ------------------------------------------------------------------------
+    //   Check if an object lives in the globals area
+    // ------------------------------------------------------------------------
+    {
+        return obj >= LowMem && obj < Globals;
+    }
+
+    bool is_indexable(object_p obj)
+    // ------------------------------------------------------------------------
+    //   Check if an object can be indexed, i.e. not in editor or scratchpad
+    // ------------------------------------------------------------------------
+    {
+        return obj < Temporaries || obj >= object_p(HighMem);
+    }
+
     bool is_user_command(utf8 cmd)
     // ------------------------------------------------------------------------
     //   Check if the command is a user-defined command
@@ -1109,6 +1176,37 @@ struct runtime
 #include "errors.tbl"
 
 
+protected:
+    struct cache_entry
+    // ------------------------------------------------------------------------
+    //   An entry in the stack rendering cache
+    // ------------------------------------------------------------------------
+    //   The key and value are GC roots, so they are adjusted (not dropped)
+    //   when the garbage collector or global variables move objects around.
+    //   Lookup is by content, so that a rendering can be reused for a copy.
+    //   The price is that up to 32 renderings and the objects they came from
+    //   stay alive even once dropped from the stack. available() releases
+    //   them before its last garbage collection when memory runs short.
+    {
+        object_p key;       // Object that was rendered
+        object_p value;     // Resulting text or graphic
+        uint     hash;      // Hash of the contents of the key
+        uint     settings;  // Hash of the settings used for rendering
+    };
+
+    struct index_entry
+    // ------------------------------------------------------------------------
+    //   Offsets of the elements of a large list or array
+    // ------------------------------------------------------------------------
+    //   The key is a GC root, so the index follows the object when it moves.
+    //   Offsets are relative to the first element, and the table is
+    //   allocated with malloc, since it is not an RPL object.
+    {
+        object_p  key;      // List or array that was indexed
+        uint32_t *offsets;  // Offset of each element
+        size_t    count;    // Number of elements
+    };
+
 protected:
     utf8      Error;        // Error message if any
     utf8      ErrorSave;    // Last error message (for ERRM)
@@ -1123,21 +1221,28 @@ protected:
     object_p *Stack;        // Top of user stack
     object_p *Args;         // Start of save area for last arguments
     object_p *Undo;         // Start of undo stack
-    object_p *Locals;       // Start of locals
     object_p *Directories;  // Start of directories
     object_p *XLibs;        // Start of xlibs (which can be null)
     object_p *Constants;    // Start of constants (which can be null)
     object_p *CallStack;    // Start of call stack (rounded 16 entries)
-    object_p *Returns;      // Start of return stack, end of locals
+    object_p *Returns;      // Start of return stack
+    object_p *Frame;        // Innermost frame of locals, in return stack
     object_p *HighMem;      // End of available memory
-    object_p  Cache[2][32]; // 16 Key/Value pairs for stack acceleration
+    cache_entry Cache[2][16]; // Rendering cache for stack acceleration
     uint      CacheIndex;   // Index of latest entry in cache
+    size_t    CacheHits;    // Stack renderings found in cache
+    size_t    CacheMisses;  // Stack renderings not found in cache
+    index_entry Index[4]; // Element offsets for large lists and arrays
+    uint      IndexIndex;   // Index of latest entry in the offset index
     size_t    GCCycles;     // Number of garbage collection cycles
     size_t    GCPurged;     // Number of bytes collected by the GC
     size_t    GCDuration;   // Total duration of GC execution
     size_t    GCLPurged;    // Number of bytes collected during last GC
     size_t    GCLDuration;  // Duration of last GC execution
     size_t    GCCleared;    // Cleaned automatically by `clearer`
+    size_t    GCLObjects;   // Objects scanned during last GC
+    size_t    GCLRoots;     // Root pointers scanned during last GC
+    size_t    GCLPasses;    // Passes over the roots during last GC
     size_t    GCUnclear;    // Disable 'clearer' class
     bool      SaveArgs;     // Save arguents (LastArgs)
 
@@ -1145,8 +1250,10 @@ protected:
     static gcptr *GCSafe;
 
     friend struct GarbageCollectorStatistics;
+    friend struct RuntimeStatistics;
     friend struct cleaner;
     friend struct runtime_invariants;
+    friend struct snapshot;
 };
 
 template<typename T>
@@ -0,0 +1,291 @@
+// ****************************************************************************
+//  snapshot.cc                                                   DB48X project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Binary snapshots of the calculator state
+//
+//
+//
+//
+//
+//
+// ****************************************************************************
+//   (C) 2024 Christophe de Dinechin <christophe@dinechin.org>
+//   This software is licensed under the terms outlined in LICENSE.txt
+// ****************************************************************************
+//   This file is part of DB48X.
+//
+//   DB48X is free software: you can redistribute it and/or modify
+//   it under the terms outlined in the LICENSE.txt file
+//
+//   DB48X is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// ****************************************************************************
+
+#include "snapshot.h"
+
+#include "file.h"
+#include "files.h"
+#include "recorder.h"
+#include "runtime.h"
+#include "settings.h"
+#include "variables.h"
+
+#include <strings.h>
+
+RECORDER(snapshot,       16, "Binary snapshots of the calculator state");
+RECORDER(snapshot_error, 16, "Errors in binary snapshots");
+
+
+uint32_t snapshot::checksum(uint32_t sum, const void *data, size_t size)
+// ----------------------------------------------------------------------------
+//   Accumulate a checksum over some data
+// ----------------------------------------------------------------------------
+{
+    byte_p ptr = byte_p(data);
+    for (size_t i = 0; i < size; i++)
+        sum = 0x1081 * sum ^ ptr[i];
+    return sum;
+}
+
+
+bool snapshot::verify(file &f, const header &h)
+// ----------------------------------------------------------------------------
+//   Check the size and checksum of the file before we touch the state
+// ----------------------------------------------------------------------------
+//   The data is read in small chunks, since there is no room for it yet
+{
+    size_t body = h.settings + h.globals + h.stack + h.path * sizeof(uint32_t);
+    if (f.size() != sizeof(h) + body)
+    {
+        record(snapshot_error, "File size %u, expected %u",
+               f.size(), sizeof(h) + body);
+        return false;
+    }
+
+    uint32_t sum = 0;
+    char     buffer[64];
+    while (body)
+    {
+        size_t chunk = body < sizeof(buffer) ? body : sizeof(buffer);
+        if (!f.read(buffer, chunk))
+            return false;
+        sum = checksum(sum, buffer, chunk);
+        body -= chunk;
+    }
+    f.seek(sizeof(h));
+    if (sum != h.checksum)
+        record(snapshot_error, "Checksum %08X, expected %08X", sum, h.checksum);
+    return sum == h.checksum;
+}
+
+
+bool snapshot::is_snapshot(cstring path)
+// ----------------------------------------------------------------------------
+//   Check if a file name is that of a binary snapshot (.48B)
+// ----------------------------------------------------------------------------
+{
+    if (cstring ext = file::extension(path))
+        return strcasecmp(ext, ".48b") == 0;
+    return false;
+}
+
+
+bool snapshot::save(cstring path)
+// ----------------------------------------------------------------------------
+//   Save the current state as a binary snapshot
+// ----------------------------------------------------------------------------
+{
+    file f(path, file::WRITING);
+    if (!f.valid())
+    {
+        rt.error(f.error());
+        return false;
+    }
+
+    // Global objects are the home directory, which starts at LowMem
+    byte_p   globals = byte_p(rt.LowMem);
+    header   h       = { FILE_MAGIC };
+    h.tag            = TAG;
+    h.version        = VERSION;
+    h.ids            = files::id_checksum();
+    h.settings       = sizeof(Settings);
+    h.globals        = byte_p(rt.Globals) - globals;
+    h.stack          = 0;
+    h.depth          = rt.depth();
+    h.path           = rt.directories() - 1;
+
+    uint32_t sum = checksum(0, &Settings, sizeof(Settings));
+    sum = checksum(sum, globals, h.globals);
+    for (uint i = h.depth; i--; )
+    {
+        object_p obj = rt.stack(i);
+        size_t   sz  = obj->size();
+        sum = checksum(sum, obj, sz);
+        h.stack += sz;
+    }
+    for (uint i = h.path; i--; )
+    {
+        uint32_t offset = byte_p(rt.variables(i)) - globals;
+        sum = checksum(sum, &offset, sizeof(offset));
+    }
+    h.checksum = sum;
+
+    bool ok = f.write(cstring(&h), sizeof(h))
+        && f.write(cstring(&Settings), sizeof(Settings))
+        && f.write(cstring(globals), h.globals);
+    for (uint i = h.depth; ok && i--; )
+    {
+        object_p obj = rt.stack(i);
+        ok = f.write(cstring(obj), obj->size());
+    }
+    for (uint i = h.path; ok && i--; )
+    {
+        uint32_t offset = byte_p(rt.variables(i)) - globals;
+        ok = f.write(cstring(&offset), sizeof(offset));
+    }
+    if (!ok)
+        rt.error(f.error());
+
+    record(snapshot, "Saved %s globals %u stack %u depth %u path %u: %+s",
+           path, h.globals, h.stack, h.depth, h.path, ok ? "OK" : "failed");
+    return ok;
+}
+
+
+bool snapshot::load(cstring path)
+// ----------------------------------------------------------------------------
+//   Replace the current state with a binary snapshot
+// ----------------------------------------------------------------------------
+//   The global objects are read in place, the stack objects as temporaries.
+//   Only the current path holds pointers, stored as offsets in the globals.
+//   A truncated or corrupt file is rejected before the state is cleared.
+//   If anything goes wrong after that, we reset it again.
+{
+    file f(path, file::READING);
+    if (!f.valid())
+    {
+        rt.error(f.error());
+        return false;
+    }
+
+    header h;
+    byte   magic[] = FILE_MAGIC;
+    if (!f.read((char *) &h, sizeof(h)))
+    {
+        rt.error(f.error());
+        return false;
+    }
+    if (memcmp(h.magic, magic, sizeof(magic)) != 0 || h.tag != TAG)
+    {
+        rt.invalid_magic_number_error();
+        return false;
+    }
+    if (h.version  != VERSION                   ||
+        h.ids      != files::id_checksum()      ||
+        h.settings != sizeof(settings))
+    {
+        record(snapshot_error, "Incompatible version %u ids %08X settings %u",
+               h.version, h.ids, h.settings);
+        rt.incompatible_binary_error();
+        return false;
+    }
+    if (!verify(f, h))
+    {
+        rt.invalid_object_in_file_error();
+        return false;
+    }
+
+    // Check that the snapshot fits in memory
+    rt.reset();
+    size_t paths   = h.path * sizeof(uint32_t);
+    size_t needed  = h.globals + h.stack + paths
+                   + (h.depth + h.path) * sizeof(object_p) + rt.redzone;
+    byte  *globals = (byte *) rt.LowMem;
+    if (needed > size_t(byte_p(rt.Stack) - globals))
+    {
+        rt.out_of_memory_error();
+        return false;
+    }
+
+    // Read the settings, the global objects in place, then the stack and path
+    settings loaded;
+    bool     ok = f.read((char *) &loaded, sizeof(loaded))
+        && f.read((char *) globals, h.globals);
+    if (ok)
+    {
+        rt.Globals = rt.Temporaries = object_p(globals + h.globals);
+        object_p home = object_p(globals);
+        ok = home->type() == object::ID_directory && home->skip() == rt.Globals;
+    }
+
+    byte *stack = ok ? rt.allocate(h.stack + paths) : nullptr;
+    byte *dirs  = stack ? stack + h.stack : nullptr;
+    ok = stack
+        && f.read((char *) stack, h.stack)
+        && f.read((char *) dirs, paths);
+
+    // Verify the checksum, then that the objects look sane
+    if (ok)
+    {
+        uint32_t sum = checksum(0, &loaded, sizeof(loaded));
+        sum = checksum(sum, globals, h.globals);
+        sum = checksum(sum, stack, h.stack + paths);
+        ok = sum == h.checksum;
+    }
+    if (ok)
+    {
+        byte_p end = stack + h.stack;
+        byte_p obj = stack;
+        for (uint i = 0; ok && i < h.depth; i++)
+        {
+            ok = object_p(obj)->type() < object::NUM_IDS;
+            if (ok)
+                obj = byte_p(object_p(obj)->skip());
+            ok = ok && obj <= end;
+        }
+        ok = ok && obj == end;
+    }
+
+    // Enter the directories in the path, from the outermost one
+    for (uint i = 0; ok && i < h.path; i++)
+    {
+        uint32_t offset;
+        memcpy(&offset, dirs + i * sizeof(offset), sizeof(offset));
+        ok = offset < h.globals;
+        if (ok)
+        {
+            directory_p dir = directory_p(globals + offset);
+            ok = dir->type() == object::ID_directory && rt.enter(dir);
+        }
+    }
+
+    // Turn the stack objects into temporaries and push them
+    if (ok)
+    {
+        rt.free(paths);
+        object_p obj = h.depth ? rt.temporary() : nullptr;
+        for (uint i = 0; ok && i < h.depth; i++)
+        {
+            ok = rt.push(obj);
+            obj = obj->skip();
+        }
+    }
+
+    if (!ok)
+    {
+        record(snapshot_error, "Failed to load %s", path);
+        rt.reset();
+        if (!rt.error())
+            rt.invalid_object_in_file_error();
+        return false;
+    }
+
+    Settings = loaded;
+    record(snapshot, "Loaded %s globals %u stack %u depth %u path %u",
+           path, h.globals, h.stack, h.depth, h.path);
+    return true;
+}
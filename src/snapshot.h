@@ -0,0 +1,78 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+// ****************************************************************************
+//  snapshot.h                                                    DB48X project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Binary snapshots of the calculator state
+//
+//     A snapshot is a raw copy of the global objects, the stack, the settings
+//     and the current path. Restoring it takes a few reads and relocating the
+//     path, instead of parsing the text of a .48S state file.
+//
+//     Snapshots depend on the firmware version and target, so the text state
+//     file remains the portable format to exchange states.
+//
+// ****************************************************************************
+//   (C) 2024 Christophe de Dinechin <christophe@dinechin.org>
+//   This software is licensed under the terms outlined in LICENSE.txt
+// ****************************************************************************
+//   This file is part of DB48X.
+//
+//   DB48X is free software: you can redistribute it and/or modify
+//   it under the terms outlined in the LICENSE.txt file
+//
+//   DB48X is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// ****************************************************************************
+//
+//   The file is made of a header, followed by:
+//   - The raw bytes of the settings
+//   - The global objects, i.e. the home directory
+//   - The objects on the stack, from the deepest level to level 1
+//   - The offset of each directory in the current path, relative to the
+//     start of the global objects, from the outermost to the innermost one
+//   The header contains the sizes of each section, and a checksum of them.
+
+#include "types.h"
+
+struct file;
+
+struct snapshot
+// ----------------------------------------------------------------------------
+//   Save and restore the calculator state in binary form
+// ----------------------------------------------------------------------------
+{
+    enum : uint32_t
+    {
+        TAG     = 0x50414E53,           // "SNAP" in little-endian
+        VERSION = 1,                    // Bump when layout changes
+    };
+
+    struct header
+    {
+        byte     magic[4];              // Same magic as binary object files
+        uint32_t tag;                   // TAG, identifies a snapshot
+        uint32_t version;               // VERSION
+        uint32_t ids;                   // files::id_checksum()
+        uint32_t settings;              // Size of the settings
+        uint32_t globals;               // Size of global objects
+        uint32_t stack;                 // Size of the stack objects
+        uint32_t depth;                 // Number of stack levels
+        uint32_t path;                  // Number of directories in path
+        uint32_t checksum;              // Checksum of what follows
+    };
+
+    static bool save(cstring path);
+    static bool load(cstring path);
+    static bool is_snapshot(cstring path);
+
+protected:
+    static uint32_t checksum(uint32_t sum, const void *data, size_t size);
+    static bool     verify(file &f, const header &h);
+};
+
+#endif // SNAPSHOT_H
@@ -33,6 +33,7 @@
 #include "arithmetic.h"
 #include "array.h"
 #include "compare.h"
+#include "compile.h"
 #include "equations.h"
 #include "expression.h"
 #include "finance.h"
@@ -107,6 +108,7 @@ algebraic_p Root::solve(program_r pgm, algebraic_r goal, algebraic_r guess)
     algebraic_g y, dy, ly, hy;  // Current, delta, low, high for f(x)
     algebraic_g nx, px;         // x where f(x) is negative and positive
     algebraic_g sy;
+    algebraic_g dydx, ldydx;    // Derivative of f at x and lx, if known
     id          gty = guess->type();
     save<bool>  nodates(unit::nodates, true);
 
@@ -259,6 +261,9 @@ algebraic_p Root::solve(program_r pgm, algebraic_r goal, algebraic_r guess)
         }
     }
 
+    // Compile the function once for all iterations
+    compiled fn(eq);
+
     for (uint i = 0; i < max && !program::interrupted(); i++)
     {
         // If we failed during evaluation of x, break
@@ -276,8 +281,8 @@ algebraic_p Root::solve(program_r pgm, algebraic_r goal, algebraic_r guess)
             return nullptr;
         }
 
-        // Evaluate equation
-        y = algebraic::evaluate_function(eq, x);
+        // Evaluate equation, and its derivative if possible
+        y = fn.evaluate(x, dydx);
 
         // If the function evaluates as 10^23 and eps=10^-18, use 10^(23-18)
         if (!i && y && !y->is_zero())
@@ -333,6 +338,7 @@ algebraic_p Root::solve(program_r pgm, algebraic_r goal, algebraic_r guess)
                     px = x;
                 ly = y;
                 lx = x;
+                ldydx = dydx;
                 x  = hx;
                 continue;
             }
@@ -344,6 +350,7 @@ algebraic_p Root::solve(program_r pgm, algebraic_r goal, algebraic_r guess)
                 hy = ly;
                 lx = x;
                 ly = y;
+                ldydx = dydx;
                 degraded = 0;
             }
             else if (!hy)
@@ -435,7 +442,6 @@ algebraic_p Root::solve(program_r pgm, algebraic_r goal, algebraic_r guess)
                     record(solve, "[%u] Moving to %t - %t * %t / %t",
                            i, +lx, +y, +dx, +dy);
                     is_constant = false;
-
                     sy = y / dy;
                     if (!sy || smaller_magnitude(maxscale, sy))
                     {
@@ -469,8 +475,28 @@ algebraic_p Root::solve(program_r pgm, algebraic_r goal, algebraic_r guess)
             // Check if we crossed and the new x does not look good
             if (nx && px)
             {
-                // Try to bisect
-                x = (nx + px) / two;
+                // If we know the derivative at the best point, take a
+                // Newton step from there, as long as it remains in the sign
+                // change interval, where it does not go very far, unlike
+                // e.g. for tan(x). The derivative is only computed with
+                // double precision, so this only narrows the interval, and
+                // the interpolation above refines the result.
+                algebraic_g nlx;
+                if (ldydx && !ldydx->is_zero(false))
+                {
+                    dy = ly;
+                    if (unit_p lyu = unit::get(dy))
+                        dy = lyu->value();
+                    nlx = lx - dy / ldydx;
+                    dy = nlx ? (nlx - nx) * (nlx - px) : nullptr;
+                    if (!dy || !dy->is_negative(false) ||
+                        (x && nlx->is_same_as(x)))
+                        nlx = nullptr;
+                    record(solve, "[%u] Newton step to %t", i, +nlx);
+                }
+
+                // Otherwise, try to bisect
+                x = nlx ? nlx : (nx + px) / two;
                 if (!x)
                 {
                     store(nx);
@@ -525,7 +551,8 @@ algebraic_p Root::solve(program_r pgm, algebraic_r goal, algebraic_r guess)
 
 algebraic_p Root::solve(algebraic_g &eq,
                         algebraic_g &var,
-                        algebraic_g &guess)
+                        algebraic_g &guess,
+                        bool         simultaneous)
 // ----------------------------------------------------------------------------
 //   Internal solver code
 // ----------------------------------------------------------------------------
@@ -544,7 +571,9 @@ algebraic_p Root::solve(algebraic_g &eq,
 //      meaning that we can find the value of the variable by invoking the
 //      single-expression solver.
 //   3- Multi-solver, similar to HP's MSLV, with conditions 2a, 2b and 2c.
-//      In this case, we use a multi-dimensional Newton-Raphson.
+//      In this case, we use a multi-dimensional Newton-Raphson, see
+//      simultaneous_solver(). This is selected by `simultaneous`, or when
+//      the equations in mode 2 are coupled, i.e. condition 2d fails.
 {
     if (!eq || !var || !guess)
         return nullptr;
@@ -582,7 +611,9 @@ algebraic_p Root::solve(algebraic_g &eq,
             vars = list::make(ID_list, var);
         if (!guesses)
             guesses = list::make(ID_list, guess);
-        algebraic_g r = multiple_equation_solver(eqs, vars, guesses);
+        algebraic_g r = simultaneous
+            ? simultaneous_solver(eqs, vars, guesses)
+            : multiple_equation_solver(eqs, vars, guesses);
         if (r && onevar)
             if (list_p lst = r->as_array_or_list())
                 if (lst->items() == 1)
@@ -613,6 +644,60 @@ algebraic_p Root::solve(algebraic_g &eq,
 }
 
 
+static bool multiple_equation_check(list_r eqs)
+// ----------------------------------------------------------------------------
+//   Check that values found one equation at a time satisfy all equations
+// ----------------------------------------------------------------------------
+//   When variables already have values, an equation can be solved for one
+//   variable even if it is coupled with others, and solving the next one
+//   then invalidates it. The tolerance is relative to the size of the sides
+{
+    settings::PrepareForSolveFunctionEvaluation willEvaluateForSolve;
+    settings::SaveNumericalConstants snc(true);
+    save<bool> nodates(unit::nodates, true);
+
+    int         prec = Settings.Precision() - Settings.SolverImprecision();
+    algebraic_g yeps = decimal::make(1, prec <= 0 ? -1 : -prec);
+    algebraic_g one  = integer::make(1);
+    for (object_p obj : *eqs)
+    {
+        expression_g eq = expression::get(obj);
+        expression_g left, right;
+        if (!eq)
+            return false;
+        if (!eq->split_equation(left, right))
+            left = eq;
+        algebraic_g l     = left->evaluate();
+        algebraic_g r     = right && l ? right->evaluate() : nullptr;
+        algebraic_g d     = r ? l - r : l;
+        algebraic_g scale = l ? abs::evaluate(l) : nullptr;
+        if (r && scale)
+            if (algebraic_g ar = abs::evaluate(r))
+                scale = scale + ar;
+        d = d ? abs::evaluate(d) : nullptr;
+        if (!d || !scale || rt.error())
+        {
+            rt.clear_error();
+            return false;
+        }
+        if (unit_p u = unit::get(d))
+            d = u->value();
+        if (unit_p u = unit::get(scale))
+            scale = u->value();
+        algebraic_g tol = yeps;
+        if (!smaller_magnitude(scale, one))
+            tol = scale * yeps;
+        if (!tol || smaller_magnitude(tol, d))
+        {
+            record(solve, "Equation %t residual %t above %t", obj, +d, +tol);
+            rt.clear_error();
+            return false;
+        }
+    }
+    return true;
+}
+
+
 list_p Root::multiple_equation_solver(list_r eqs, list_r names, list_r guesses)
 // ----------------------------------------------------------------------------
 //   Solve multiple equations in sequence (equivalent to HP's MES)
@@ -674,9 +759,12 @@ list_p Root::multiple_equation_solver(list_r eqs, list_r names, list_r guesses)
     }
 
     // Looks good: loop on equations trying to find one we can solve
-    size_t ecount = eqs->items();
-    list_g vars   = names;
-    list_g eqns   = eqs;
+    size_t ecount  = eqs->items();
+    list_g vars    = names;
+    list_g eqns    = eqs;
+    list_g initial = gvalues;
+    bool   square  = ecount == vcount;
+    bool   checked = false;
 
     // While there are variables to solve for
     while (vcount && ecount)
@@ -762,6 +850,19 @@ list_p Root::multiple_equation_solver(list_r eqs, list_r names, list_r guesses)
             ++gi;
         }
 
+        // Remaining equations are coupled, try solving them together
+        if (!found && ecount == vcount)
+        {
+            record(solve, "Coupled equations %t for %t", +eqns, +vars);
+            if (!simultaneous_solver(eqns, vars, gvalues))
+            {
+                solver_command_error();
+                return nullptr;
+            }
+            checked = vcount == names->items();
+            break;
+        }
+
         // This algorithm does not apply, some variables were not found
         if (!found)
         {
@@ -771,11 +872,426 @@ list_p Root::multiple_equation_solver(list_r eqs, list_r names, list_r guesses)
         }
     }
 
+    // Values found in sequence may not solve coupled equations together
+    if (square && !checked && !multiple_equation_check(eqs))
+    {
+        record(solve, "Sequential solution failed, solving %t together", +eqs);
+        if (!simultaneous_solver(eqs, names, initial))
+        {
+            solver_command_error();
+            return nullptr;
+        }
+    }
+
     list_g result = names->map(recall);
     return result;
 }
 
 
+struct simultaneous_data
+// ----------------------------------------------------------------------------
+//   Data shared by the functions of the simultaneous solver
+// ----------------------------------------------------------------------------
+{
+    list_g      eqs;            // Equations, as differences to zero
+    list_g      names;          // Symbols of the variables
+    list_g      uexprs;         // Unit of each variable, 1 if none
+    size_t      count;          // Number of variables and equations
+};
+
+
+static array_p simultaneous_values(simultaneous_data &sd, array_r x)
+// ----------------------------------------------------------------------------
+//   Store the variables, then evaluate the equations
+// ----------------------------------------------------------------------------
+{
+    list::iterator ni = sd.names->begin();
+    list::iterator ui = sd.uexprs->begin();
+    for (object_p obj : *x)
+    {
+        symbol_p    name  = symbol_p(*ni);
+        algebraic_g uexpr = algebraic_p(*ui);
+        algebraic_g value = algebraic_p(obj);
+        if (!uexpr->is_one(false))
+            value = unit::simple(value, uexpr);
+        if (!value || !directory::store_here(name, value))
+            return nullptr;
+        ++ni;
+        ++ui;
+    }
+
+    scribble scr;
+    for (object_p obj : *sd.eqs)
+    {
+        algebraic_g y = algebraic_p(obj)->evaluate();
+        if (!y)
+            return nullptr;
+        if (unit_p u = unit::get(y))
+            y = u->value();
+        if (!y->is_real() && !y->is_complex())
+        {
+            rt.invalid_function_error();
+            return nullptr;
+        }
+        if (!rt.append(y))
+            return nullptr;
+    }
+    return array_p(list::make(object::ID_array, scr.scratch(), scr.growth()));
+}
+
+
+static algebraic_p simultaneous_norm(object_p v)
+// ----------------------------------------------------------------------------
+//   Return the sum of the squares of the magnitudes in a vector
+// ----------------------------------------------------------------------------
+//   Newton steps always reduce this, unlike for example the largest value
+{
+    array_g     a   = v ? v->as<array>() : nullptr;
+    algebraic_g sum = integer::make(0);
+    if (!a)
+        return nullptr;
+    for (object_p obj : *a)
+    {
+        algebraic_g m = obj->as_algebraic();
+        m = m ? abs::evaluate(m) : nullptr;
+        sum = m ? sum + m * m : nullptr;
+        if (!sum)
+            return nullptr;
+    }
+    return sum;
+}
+
+
+static object_p simultaneous_transpose(size_t, size_t,
+                                       size_t row, size_t column,
+                                       void *data)
+// ----------------------------------------------------------------------------
+//   Build the Jacobian from its columns
+// ----------------------------------------------------------------------------
+{
+    list_g &columns = *((list_g *) data);
+    return columns->at(column, row);
+}
+
+
+static array_p simultaneous_jacobian(simultaneous_data &sd,
+                                     array_r x, array_r fx,
+                                     algebraic_r eps)
+// ----------------------------------------------------------------------------
+//   Compute the Jacobian at x using forward differences
+// ----------------------------------------------------------------------------
+{
+    size_t   n = sd.count;
+    scribble scr;
+    for (size_t c = 0; c < n; c++)
+    {
+        // Move variable c by h, proportional to its magnitude
+        algebraic_g h = algebraic_p(x->at(c));
+        if (!h)
+            return nullptr;
+        h = abs::evaluate(h);
+        if (!h || h->is_zero(false) || smaller_magnitude(h, eps))
+            h = eps;
+        else
+            h = h * eps;
+
+        array_g xh;
+        {
+            scribble sx;
+            size_t   r = 0;
+            for (object_p obj : *x)
+            {
+                algebraic_g v = algebraic_p(obj);
+                if (r++ == c)
+                    v = v + h;
+                if (!v || !rt.append(v))
+                    return nullptr;
+            }
+            xh = array_p(list::make(object::ID_array,
+                                    sx.scratch(), sx.growth()));
+        }
+        if (!xh)
+            return nullptr;
+
+        algebraic_g fh = simultaneous_values(sd, xh);
+        algebraic_g f0 = +fx;
+        algebraic_g column = fh ? (fh - f0) / h : nullptr;
+        if (!column || !rt.append(column))
+            return nullptr;
+    }
+
+    list_g columns = list::make(object::ID_list, scr.scratch(), scr.growth());
+    if (!columns)
+        return nullptr;
+    return array::build(n, n, simultaneous_transpose, &columns);
+}
+
+
+static array_p simultaneous_nudge(array_r x)
+// ----------------------------------------------------------------------------
+//   Move away from a point where the Jacobian is singular
+// ----------------------------------------------------------------------------
+//   Each variable moves by a different amount, since singular points are
+//   often symmetric, e.g. X=Y=1 for X*Y=6 and X+Y=5
+{
+    scribble    scr;
+    algebraic_g one = integer::make(1);
+    uint        idx = 0;
+    for (object_p obj : *x)
+    {
+        algebraic_g v     = algebraic_p(obj);
+        algebraic_g scale = abs::evaluate(v);
+        if (!scale || smaller_magnitude(scale, one))
+            scale = one;
+        algebraic_g delta = fraction::make(integer::make(++idx),
+                                           integer::make(97));
+        v = v + scale * delta;
+        if (!v || !rt.append(v))
+            return nullptr;
+    }
+    return array_p(list::make(object::ID_array, scr.scratch(), scr.growth()));
+}
+
+
+static object_p simultaneous_outer(size_t, size_t,
+                                   size_t row, size_t column,
+                                   void *data)
+// ----------------------------------------------------------------------------
+//   Build the rank-one update u * dx^T of Broyden's method
+// ----------------------------------------------------------------------------
+{
+    array_g    *vectors = (array_g *) data;
+    algebraic_g u       = algebraic_p(vectors[0]->at(row));
+    algebraic_g dx      = algebraic_p(vectors[1]->at(column));
+    return u && dx ? +(u * dx) : nullptr;
+}
+
+
+list_p Root::simultaneous_solver(list_r eqs, list_r names, list_r guesses)
+// ----------------------------------------------------------------------------
+//   Solve coupled equations together (equivalent to HP's MSLV)
+// ----------------------------------------------------------------------------
+//   This uses Broyden's method: the Jacobian is computed once using finite
+//   differences, then adjusted with a rank-one update after each step.
+//   Steps are solved using array division, and halved if they do not
+//   reduce the residuals. If that fails, the Jacobian is computed again.
+{
+    if (!eqs || !names || !guesses)
+        return nullptr;
+
+    // There must be as many equations and guesses as variables
+    simultaneous_data sd;
+    size_t            n = names->items();
+    sd.count = n;
+    if (!n || eqs->items() != n || guesses->items() != n)
+    {
+        rt.dimension_error();
+        return nullptr;
+    }
+
+    // Collect the symbols, their units and the initial values
+    array_g x;
+    {
+        scribble sn;
+        for (object_p obj : *names)
+        {
+            if (unit_p u = unit::get(obj))
+                obj = u->value();
+            symbol_p name = obj->as_quoted<symbol>();
+            if (!name)
+            {
+                rt.type_error();
+                return nullptr;
+            }
+            if (!rt.append(name))
+                return nullptr;
+        }
+        sd.names = list::make(ID_list, sn.scratch(), sn.growth());
+
+        scribble       su;
+        list::iterator gi = guesses->begin();
+        for (object_p obj : *names)
+        {
+            algebraic_g uexpr = integer::make(1);
+            if (unit_p u = unit::get(obj))
+                uexpr = u->uexpr();
+            else if (unit_p gu = unit::get(*gi))
+                uexpr = gu->uexpr();
+            if (!uexpr || !rt.append(uexpr))
+                return nullptr;
+            ++gi;
+        }
+        sd.uexprs = list::make(ID_list, su.scratch(), su.growth());
+
+        scribble sg;
+        gi = guesses->begin();
+        for (object_p obj : *names)
+        {
+            algebraic_g guess = algebraic_p(*gi);
+            if (guess->type() == ID_expression)
+                guess = guess->evaluate();
+            if (!guess)
+                return nullptr;
+            if (unit_g ug = unit::get(guess))
+            {
+                if (unit_p un = unit::get(obj))
+                    if (!un->convert(ug))
+                        return nullptr;
+                guess = ug->value();
+            }
+            if (!guess || (!guess->is_real() && !guess->is_complex()))
+            {
+                rt.type_error();
+                return nullptr;
+            }
+            if (!rt.append(guess))
+                return nullptr;
+            ++gi;
+        }
+        x = array_p(list::make(ID_array, sg.scratch(), sg.growth()));
+    }
+
+    // Convert A=B into A-(B)
+    {
+        scribble se;
+        for (object_p obj : *eqs)
+        {
+            if (equation_p libeq = obj->as_quoted<equation>())
+                obj = libeq->value();
+            expression_g eq = obj ? expression::get(obj) : nullptr;
+            if (!eq)
+            {
+                if (!rt.error())
+                    rt.invalid_equation_error();
+                return nullptr;
+            }
+            if (expression_g diff = eq->as_difference_for_solve())
+                eq = diff;
+            if (!rt.append(+eq))
+                return nullptr;
+        }
+        sd.eqs = list::make(ID_list, se.scratch(), se.growth());
+    }
+    if (!x || !sd.names || !sd.uexprs || !sd.eqs)
+        return nullptr;
+
+    // We will run programs, do not save stack, etc.
+    settings::PrepareForSolveFunctionEvaluation willEvaluateForSolve;
+    settings::SaveNumericalConstants snc(true);
+    save<bool> nodates(unit::nodates, true);
+
+    // Tolerance is squared, since we compare sums of squares
+    int         prec = Settings.Precision() - Settings.SolverImprecision();
+    algebraic_g eps2 = decimal::make(1, prec <= 0 ? -2 : -2 * prec);
+    algebraic_g heps = decimal::make(1, -int(Settings.Precision() / 2));
+    algebraic_g two  = integer::make(2);
+    uint        max  = Settings.SolverIterations();
+    array_g     fx   = simultaneous_values(sd, x);
+    array_g     jac  = fx ? simultaneous_jacobian(sd, x, fx, heps) : nullptr;
+    bool        fresh = true;
+    bool        solved = false;
+    record(solve, "Simultaneous solve %t for %t from %t",
+           +sd.eqs, +sd.names, +x);
+
+    for (uint i = 0; !solved && i < max && !program::interrupted(); i++)
+    {
+        if (!fx || !jac)
+            break;
+
+        // Check if the residuals are small enough
+        algebraic_g nfx = simultaneous_norm(+fx);
+        if (!nfx)
+            break;
+        if (nfx->is_zero(false) || smaller_magnitude(nfx, eps2))
+        {
+            solved = true;
+            break;
+        }
+
+        // Newton step, halved until the residuals decrease
+        algebraic_g f  = +fx;
+        algebraic_g j  = +jac;
+        algebraic_g dx = f / j;
+        array_g     nx, nf;
+        if (!dx)
+        {
+            // Singular Jacobian: restart from a nearby point
+            record(solve, "[%u] Singular Jacobian %t", i, +j);
+            rt.clear_error();
+            x = simultaneous_nudge(x);
+            fx = x ? simultaneous_values(sd, x) : nullptr;
+            jac = fx ? simultaneous_jacobian(sd, x, fx, heps) : nullptr;
+            fresh = true;
+            continue;
+        }
+        for (uint h = 0; dx && h < 20 && !program::interrupted(); h++)
+        {
+            algebraic_g xa = +x;
+            algebraic_g xn = xa - dx;
+            nx = xn ? xn->as<array>() : nullptr;
+            nf = nx ? simultaneous_values(sd, nx) : nullptr;
+            algebraic_g nfn = nf ? simultaneous_norm(+nf) : nullptr;
+            if (nfn && smaller_magnitude(nfn, nfx))
+                break;
+            rt.clear_error();
+            nf = nullptr;
+            dx = dx / two;
+        }
+        record(solve, "[%u] Step %t residual %t", i, +dx, +nf);
+
+        if (!nf)
+        {
+            // No progress: use a fresh Jacobian, or give up if we had one
+            rt.clear_error();
+            if (fresh)
+                break;
+            fx = simultaneous_values(sd, x);
+            jac = fx ? simultaneous_jacobian(sd, x, fx, heps) : nullptr;
+            fresh = true;
+            continue;
+        }
+
+        // Check if the step became too small to improve things
+        algebraic_g nxn = simultaneous_norm(+nx);
+        algebraic_g ndx = simultaneous_norm(+dx);
+        if (!nxn || !ndx)
+            break;
+        if (ndx->is_zero(false) || smaller_magnitude(ndx, nxn * eps2))
+            solved = true;
+
+        // Broyden update: J += (df - J * s) * s^T / (s . s), with s = -dx
+        algebraic_g fn = +nf;
+        algebraic_g s  = -dx;
+        algebraic_g df = fn - f;
+        algebraic_g js = j * s;
+        array_g     sa = s ? s->as<array>() : nullptr;
+        algebraic_g ss = sa ? array::dot(sa, sa) : nullptr;
+        algebraic_g u  = js && ss ? (df - js) / ss : nullptr;
+        array_g     vectors[2] = { u ? u->as<array>() : nullptr, sa };
+        if (!vectors[0] || !vectors[1])
+            break;
+        array_g     outer = array::build(n, n, simultaneous_outer, vectors);
+        algebraic_g upd   = outer ? +outer : nullptr;
+        j = upd ? j + upd : nullptr;
+        jac = j ? j->as<array>() : nullptr;
+        x = nx;
+        fx = nf;
+        fresh = false;
+    }
+
+    // Leave the variables with the best values we found
+    if (x && !simultaneous_values(sd, x))
+        return nullptr;
+    if (!solved)
+    {
+        if (!rt.error())
+            rt.no_solution_error();
+        return nullptr;
+    }
+    return names->map(recall);
+}
+
+
 expression_p Root::isolate(expression_p eq, symbol_p name)
 // ----------------------------------------------------------------------------
 //   Attempt to isolate without emitting an error
@@ -816,11 +1332,16 @@ NFUNCTION_BODY(Root)
 
 NFUNCTION_BODY(MultipleEquationsSolver)
 // ----------------------------------------------------------------------------
-//   Solve a set of equations one at a time
+//   Solve a set of equations simultaneously
 // ----------------------------------------------------------------------------
-//   On DB48X, there is no difference between `MSLV` and `ROOT`
 {
-    return Root::evaluate(op, args, arity);
+    algebraic_g &eqobj    = args[2];
+    algebraic_g &variable = args[1];
+    algebraic_g &guess    = args[0];
+    algebraic_g result = Root::solve(eqobj, variable, guess, true);
+    if (!result)
+        solver_command_error();
+    return result;
 }
 
 
@@ -44,10 +44,14 @@ NFUNCTION(Root,3,
                                    algebraic_r guess);
           static algebraic_p solve(algebraic_g &eq,
                                    algebraic_g &vars,
-                                   algebraic_g &guess);
+                                   algebraic_g &guess,
+                                   bool simultaneous = false);
           static list_p multiple_equation_solver(list_r eqs,
                                                  list_r names,
                                                  list_r guesses);
+          static list_p simultaneous_solver(list_r eqs,
+                                            list_r names,
+                                            list_r guesses);
           static expression_p isolate(expression_p eq, symbol_p name);
     );
 NFUNCTION(MultipleEquationsSolver,3,
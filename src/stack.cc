@@ -144,14 +144,8 @@ uint stack::draw_stack()
     object_g cached;
     char     buf[16];
 
-    // Invalidate cache if settings changed
-    static uint settingsHash = 0;
+    // Renderings are cached for the current settings
     uint hash = Settings.hash() ^ (interactive ? 0x4242 : 0) ;
-    if (hash != settingsHash)
-    {
-        rt.uncache();
-        settingsHash = hash;
-    }
 
     for (uint level = interactive_base; level < depth; level++)
     {
@@ -159,7 +153,7 @@ uint stack::draw_stack()
             break;
 
         obj        = rt.stack(level);
-        cached     = rt.cached(level == 0, +obj);
+        cached     = rt.cached(level == 0, +obj, hash);
 
         size     w = 0;
         if (!interactive && (level ? sgraph : sgraph))
@@ -189,9 +183,9 @@ uint stack::draw_stack()
 
                 if (graph)
                 {
-                    rt.cache(level == 0, +obj, +graph);
+                    rt.cache(level == 0, +obj, hash, +graph);
                     if (rgraph == sgraph && rfont == sfont)
-                        rt.cache(level != 0, +obj, +graph);
+                        rt.cache(level != 0, +obj, hash, +graph);
                 }
             }
             if (graph)
@@ -254,9 +248,9 @@ uint stack::draw_stack()
                 rendered = text::make(out, len);
                 if (rendered)
                 {
-                    rt.cache(level == 0, +obj, +rendered);
+                    rt.cache(level == 0, +obj, hash, +rendered);
                     if (rml == sml)
-                        rt.cache(level != 0, +obj, +rendered);
+                        rt.cache(level != 0, +obj, hash, +rendered);
                 }
                 out = saveOut;
             }
@@ -29,13 +29,16 @@
 
 #include "tests.h"
 
+#include "decimal.h"
 #include "dmcp.h"
 #include "equations.h"
 #include "list.h"
 #include "recorder.h"
 #include "settings.h"
 #include "sim-dmcp.h"
+#include "snapshot.h"
 #include "stack.h"
+#include "text.h"
 #include "types.h"
 #include "user_interface.h"
 
@@ -1127,6 +1130,13 @@ void tests::editor_operations()
         .test(CLEAR, "ABCD").editor("ABCD")
         .test(EXIT).editor("").noerror()
         .test(RSHIFT, UP).editor("ABCD");
+    step("Moving cursor between lines")
+        .test(CLEAR, "AAAA\nAA\nAAAA", SHIFT, UP, "A")
+        .editor("AAAA\nAAA\nAAAA")
+        .test(SHIFT, UP, "B")
+        .editor("AAABA\nAAA\nAAAA")
+        .test(SHIFT, DOWN, SHIFT, DOWN, SHIFT, DOWN, "C")
+        .editor("AAABA\nAAA\nAAAAC");
     step("End of editor")
         .test(CLEAR);
 
@@ -1685,6 +1695,46 @@ void tests::stack_operations()
         .test("3", ID_StackMenu, ID_Pick).expect("333")
         .test(ID_LastArg, ID_Depth, ID_ListMenu, ID_ToList)
         .expect("{ 111 222 333 444 555 333 3 }");
+
+    step("Render cache statistics")
+        .test(CLEAR, "\"Rendered\"", ENTER, "1", ENTER, BSP)
+        .expect("\"Rendered\"")
+        .test(CLEAR, "RuntimeStatistics 9 GET OBJ→", ENTER)
+        .expect("\"RenderHits\"")
+        .test(BSP, "0 >", ENTER).expect("True")
+        .test(CLEAR, "RuntimeStatistics 10 GET OBJ→", ENTER)
+        .expect("\"RenderMisses\"");
+
+    step("Render cache lookups survive garbage collection");
+    {
+        const uint settings = 0x5EED1E55;
+        auto       matches  = [](object_p obj, cstring expected)
+        {
+            if (!obj || obj->type() != object::ID_text)
+                return false;
+            size_t len = 0;
+            utf8   val = text_p(obj)->value(&len);
+            return len == strlen(expected) && !memcmp(val, expected, len);
+        };
+        text_g pad = text::make("Garbage that moves the cached objects");
+        text_g key = text::make("Render cache key");
+        text_g val = text::make("Render cache value");
+        rt.cache(false, key, settings, val);
+        check(matches(rt.cached(false, key, settings), "Render cache value"));
+
+        // Only the cache keeps the original key and value alive now
+        pad = nullptr;
+        val = nullptr;
+        key = text::make("Render cache key");
+        rt.gc();
+        check(matches(rt.cached(false, key, settings), "Render cache value"));
+        check(!rt.cached(true, key, settings));
+        check(!rt.cached(false, key, settings + 1));
+
+        step("Invalidating the render cache");
+        rt.uncache();
+        check(!rt.cached(false, key, settings));
+    }
 }
 
 
@@ -1837,6 +1887,20 @@ void tests::arithmetic()
         .test(CLEAR, 2, ENTER, 256, ID_pow)
         .expect("115 792 089 237 316 195 423 570 985 008 687 907 853 269 984 "
                 "665 640 564 039 457 584 007 913 129 639 936");
+    step("Large multiplication and division")
+        .test(CLEAR, "2 3000 ^ 1 - 2 1500 ^ 1 + MOD", ENTER)
+        .expect("0")
+        .test(CLEAR, "2 2000 ^ 1 + 2 1000 ^ 1 + MOD", ENTER)
+        .expect("2")
+        .test(CLEAR, "3 1000 ^ 7 500 ^ * 7 500 ^ / 3 1000 ^ -", ENTER)
+        .expect("0")
+        .test(CLEAR, "2 1000 ^ 3 300 ^ 1 - * 3 300 ^ 1 - MOD", ENTER)
+        .expect("0");
+    step("Rendering large integers")
+        .test(CLEAR, "10 900 ^ →STR SIZE", ENTER)
+        .expect("1 201")
+        .test(CLEAR, "10 900 ^ 1 - →STR SIZE", ENTER)
+        .expect("1 199");
     step("Sign of modulo and remainder");
     test(CLEAR, " 7  3 MOD", ENTER).expect(1);
     test(CLEAR, " 7 -3 MOD", ENTER).expect(1);
@@ -1971,6 +2035,26 @@ void tests::global_variables()
         .expect("34")
         .test(BSP).expect("923");
 
+    step("Garbage collector statistics")
+        .test(CLEAR, "GarbageCollect Drop GCStats Size", ENTER)
+        .expect("{ 9 }");
+
+    step("Profiler counts calls to global names")
+        .test(CLEAR,
+              "« 1 + » 'PrInc' STO "
+              "ProfileStart 1 PrInc PrInc PrInc ProfileStop "
+              "ProfileReport "
+              "« Obj→ \"PrInc\" == « 1 Get » « Drop 0 » IFTE » Map ΣList "
+              "'PrInc' Purge", ENTER)
+        .expect("3")
+        .test(BSP).expect("4");
+
+    step("Garbage collection with many roots")
+        .test(CLEAR,
+              "1 500 FOR i i NEXT 500 →List "
+              "GarbageCollect Drop ΣList", ENTER)
+        .expect("125 250");
+
     step("Memory menu")
         .test(CLEAR, ID_MemoryMenu, RSHIFT, RUNSTOP,
               F1, F2, F3, F4, F5,
@@ -1998,7 +2082,12 @@ void tests::global_variables()
         .test(RSHIFT, RUNSTOP,
               RSHIFT, F1, RSHIFT, F2, RSHIFT, F3, RSHIFT, F4, RSHIFT, F5,
               ENTER)
-        .expect("{ ▶ Increment Decrement Variables TypedVariables }");
+        .expect("{ ▶ Increment Decrement Variables TypedVariables }")
+        .test(F6,
+              RSHIFT, RUNSTOP,
+              F1, F2, F3,
+              ENTER)
+        .expect("{ ProfileStart ProfileStop ProfileReport }");
 
     step("Store in long-name global variable");
     test(CLEAR, "\"Hello World\"", ENTER, XEQ, "SomeLongVariable", ENTER, STO)
@@ -2163,6 +2252,32 @@ void tests::global_variables()
         .test(NOSHIFT, BSP).expect("11")
         .test(NOSHIFT, BSP).expect("{ 11 23 34 44 }");
 
+    step("Large directory uses name index")
+        .test(CLEAR, "'IdxTest' CRDIR IdxTest "
+              "1 300 FOR i i \"'V\" i + \"'\" + STR→ STO NEXT", ENTER)
+        .noerror()
+        .test(CLEAR, "V1 V150 V300 + +", ENTER).expect("451")
+        .test(CLEAR, "'v42' RCL", ENTER).expect("42")
+        .test(CLEAR, "V301", ENTER).expect("'V301'");
+    step("Name index after store and purge")
+        .test(CLEAR, "\"Long text value\" 'V7' STO V7 V8", ENTER)
+        .expect("8")
+        .test(CLEAR, "{ V2 V3 } PURGE V1 V4 +", ENTER).expect("5")
+        .test(CLEAR, "V2", ENTER).expect("'V2'")
+        .test(CLEAR, "77 'NewVar' STO NewVar V299 +", ENTER).expect("376");
+    step("Name index for nested directories")
+        .test(CLEAR, "'Inner' CRDIR Inner "
+              "1 100 FOR i i NEG \"'V\" i + \"'\" + STR→ STO NEXT "
+              "V50 V250 +", ENTER).expect("200")
+        .test(CLEAR, "UPDIR 'Inner' PURGEALL V50 V9 +", ENTER).expect("59")
+        .test(CLEAR, "Inner", ENTER).expect("'Inner'");
+    step("Name index with case-sensitive names")
+        .test(CLEAR, "DistinguishSymbolCase 'v42' RCL", ENTER)
+        .error("Undefined name")
+        .test(CLEAR, "-42 'v42' STO v42 V42 +", ENTER).expect("0")
+        .test(CLEAR, "IgnoreSymbolCase UPDIR 'IdxTest' PURGEALL", ENTER)
+        .noerror();
+
     step("Save to file as text")
         .test(CLEAR, "1.42 \"Hello.txt\"", NOSHIFT, G).noerror();
     step("Restore from file as text")
@@ -2182,6 +2297,64 @@ void tests::global_variables()
         .test(CLEAR, EXIT, "\"Hello.bmp\" RCL", ENTER).noerror()
         .image_noheader("rcl-bmp");
 
+    step("Binary snapshot of the calculator state")
+        .test(CLEAR, "RAD Home 'SnapDir' CRDIR SnapDir 'Inner' CRDIR Inner "
+              "42 'SnapV' STO", ENTER).noerror()
+        .test(CLEAR, "2.5 \"Snap\" { 1 2 }", ENTER).expect("{ 1 2 }")
+        .check(snapshot::save("state/SnapTest.48b"));
+    step("Changing the state after taking the snapshot")
+        .test(CLEAR, "DEG Home 'SnapDir' PURGEALL 'SnapDir' RCL", ENTER)
+        .error("Undefined name")
+        .test(CLEAR, "7", ENTER).expect("7");
+    step("Restoring the binary snapshot")
+        .check(snapshot::load("state/SnapTest.48b"))
+        .test("DEPTH", ENTER).expect("3")
+        .test(BSP).expect("{ 1 2 }")
+        .test(BSP).expect("\"Snap\"")
+        .test(BSP).expect("2.5")
+        .test(CLEAR, "PATH", ENTER).expect("{ HomeDirectory SnapDir Inner }")
+        .test(CLEAR, "SnapV", ENTER).expect("42")
+        .test(CLEAR, "90 SIN", ENTER).expect("0.89399 66636 01");
+
+    step("Rejecting a truncated or corrupt binary snapshot");
+    {
+        FILE *in = fopen("state/SnapTest.48b", "rb");
+        check(in != nullptr);
+        std::string data;
+        if (in)
+        {
+            char   buffer[256];
+            size_t len;
+            while ((len = fread(buffer, 1, sizeof(buffer), in)) > 0)
+                data.append(buffer, len);
+            fclose(in);
+        }
+        if (FILE *out = fopen("state/SnapTruncated.48b", "wb"))
+        {
+            fwrite(data.data(), 1, data.size() / 2, out);
+            fclose(out);
+        }
+        data[data.size() / 2] ^= 0x5A;
+        if (FILE *out = fopen("state/SnapCorrupt.48b", "wb"))
+        {
+            fwrite(data.data(), 1, data.size(), out);
+            fclose(out);
+        }
+    }
+    test(CLEAR, "DEG Home 'SnapDir' PURGEALL 1 2", ENTER).expect("2")
+        .check(!snapshot::load("state/SnapTruncated.48b"))
+        .error("File contains no valid object")
+        .test(CLEARERR, "DEPTH", ENTER).expect("2")
+        .check(!snapshot::load("state/SnapCorrupt.48b"))
+        .error("File contains no valid object")
+        .test(CLEARERR, "DEPTH", ENTER).expect("3")
+        .test(CLEAR, "90 SIN", ENTER).expect("1")
+        .test(CLEAR, "'SnapDir' RCL", ENTER).error("Undefined name")
+        .test(CLEAR);
+    remove("state/SnapTest.48b");
+    remove("state/SnapTruncated.48b");
+    remove("state/SnapCorrupt.48b");
+
     step("Allowing command names in quotes")
         .test(CLEAR, "'bar'", ENTER)
         .expect("'BarPlot'");
@@ -2218,6 +2391,25 @@ void tests::local_variables()
          "LocTest", ENTER)
         .expect("'(X+Y)·(X-Y)÷((Y+Z)·(Y-Z))'");
 
+    step("Nested local blocks");
+    test(CLEAR, "2 3 → A B « 10 → C « A B C × + » »", ENTER).expect("32");
+
+    step("Recursive local blocks with a deep stack");
+    test(CLEAR,
+         "« → N « IF N 1 ≤ THEN 1 ELSE N 1 - LocFact N × END » » "
+         "'LocFact' STO", ENTER).noerror();
+    test(CLEAR, "1 500 FOR I I NEXT 20 LocFact", ENTER)
+        .expect("2 432 902 008 176 640 000")
+        .test("DEPTH", ENTER).expect("501")
+        .test(CLEAR, "'LocFact' PURGE", ENTER).noerror();
+
+    step("Rewrite rule bindings inside a local block");
+    test(CLEAR,
+         "5 → A « 'X*(Y+Z)' { 'x*(y+z)' 'x*y+x*z' } ↓MATCH DROP A »",
+         ENTER)
+        .expect("5")
+        .test(BSP).expect("'X·Y+X·Z'");
+
     step("Cleanup");
     test(CLEAR, XEQ, "LocTest", ENTER, "PurgeAll", ENTER).noerror();
 }
@@ -3272,6 +3464,8 @@ void tests::decimal_numerical_functions()
         .test(CLEAR, "1.23 -2.34", ID_subtract).expect("3.57")
         .test(CLEAR, "-1.23 2.34", ID_subtract).expect("-3.57")
         .test(CLEAR, "-1.23 -2.34", ID_subtract).expect("1.11")
+        .test(CLEAR, "0. 0.001", ID_subtract).expect("-0.001")
+        .test(CLEAR, "0.5 1.5", ID_subtract).expect("-1.")
         .test(CLEAR, "1.234 SIN 2.34", ID_subtract).expect("-2.31846 43020 38138 43148 37899 51665 08279")
         .test(CLEAR, "1.23 COS -2.34", ID_subtract).expect("3.33976 95810 02165 19469 27543 75622 13147")
         .test(CLEAR, "-1.23 TAN 2.34", ID_subtract).expect("-2.36147 08482 21760 19788 59087 67485 91594")
@@ -3811,6 +4005,46 @@ void tests::double_numerical_functions()
         .error("Numerical overflow")
         .test(CLEAR, "'OverflowError' Purge", ENTER).noerror();;
 
+    step("Cached fast paths follow precision changes")
+        .test(CLEAR, "(1.1;2.2) (3.3;4.4) *", ENTER)
+        .expect("-6.05000 00000 00001 6D+ⅈ12.10000 00000 00001 4D")
+        .test(CLEAR, "24 PRECISION (1.1;2.2) (3.3;4.4) *", ENTER)
+        .expect("-6.05+ⅈ12.1");
+
+    step("Matrix operations on packed hardware floating-point values")
+        .test(CLEAR, "16 PRECISION [[2. 3.][4. 5.]] 1. - DET", ENTER)
+        .expect("-2.D")
+        .test(CLEAR, "[[5. 3.][3. 3.]] 1. - INV", ENTER)
+        .expect("[[ 0.5D -0.5D ] [ -0.5D 1.D ]]")
+        .test(CLEAR, "[[2. 3.][4. 5.]] 1. - [[6. 7.][8. 9.]] 1. - *", ENTER)
+        .expect("[[ 19.D 22.D ] [ 43.D 50.D ]]")
+        .test(CLEAR, "[[2. 3.][4. 5.]] 1. - [6. 7.] 1. - *", ENTER)
+        .expect("[ 17.D 39.D ]")
+        .test(CLEAR, "[[2. 3. 4.][5. 6. 7.]] 1. - "
+              "[[8. 9.][10. 11.][12. 13.]] 1. - *", ENTER)
+        .expect("[[ 58.D 64.D ] [ 139.D 154.D ]]")
+        .test(CLEAR, "[2. 3. 4.] 1. - [5. 6. 7.] 1. - DOT", ENTER)
+        .expect("32.D")
+        .test(CLEAR, "[2. 3. 4.] 1. - [5. 6. 7.] 1. - CROSS", ENTER)
+        .expect("[ -3.D 6.D -3.D ]");
+    step("Sum and difference of packed matrices are element-wise")
+        .test(CLEAR, "[[2. 3.][4. 5.]] 1. - [[6. 7.][8. 9.]] 1. - +", ENTER)
+        .expect("[[ 6.D 8.D ] [ 10.D 12.D ]]")
+        .test(CLEAR, "[[2. 3.][4. 5.]] 1. - [[6. 7.][8. 9.]] 1. - -", ENTER)
+        .expect("[[ -4.D -4.D ] [ -4.D -4.D ]]")
+        .test(CLEAR, "[[2. 3.][4. 5.]] 1. - [[6. 7.][8. 9.]] 1. - ×", ENTER)
+        .expect("[[ 19.D 22.D ] [ 43.D 50.D ]]");
+    step("Singular packed hardware floating-point matrix")
+        .test(CLEAR, "[[2. 3.][3. 5.]] 1. - DET", ENTER)
+        .expect("0")
+        .test(CLEAR, "[[2. 3.][3. 5.]] 1. - INV", ENTER)
+        .error("Divide by zero");
+    step("Tiny pivot in packed hardware floating-point matrix")
+        .test(CLEAR, "[[1.D 0.D][0.D 1E-17D]] DET", ENTER)
+        .expect("1.00000 00000 00000 07⁳-17D")
+        .test(CLEAR, "[[1.D 0.D][0.D 1E-17D]] INV", ENTER)
+        .expect("[[ 1 0 ] [ 0 1.⁳17D ]]");
+
     step("Restore default 24-digit precision");
     test(CLEAR, "24 PRECISION 12 SIG SoftFP", ENTER).noerror();
 }
@@ -3975,6 +4209,126 @@ void tests::high_precision_numerical_functions()
         .test(CLEAR, "-3.21 -1.23 atan2", ENTER)
         .expect("-1.93671 70284 36984 00445 39742 77784 19614 09228 14972 69013 57207 96225 22144 30998 44778 15307 33025 32493 05294 47540 14534 16384 29680 297 r");
 
+    step("Long mantissa multiplication and division")
+        .test(CLEAR, "300 PRECISION 299 SIG", ENTER).noerror()
+        .test(CLEAR, "1. 7. / 7. *", ENTER).expect("1.")
+        .test(CLEAR, "1. 3. / 3. *", ENTER).expect("1.")
+        .test(CLEAR, "600 PRECISION 599 SIG", ENTER).noerror()
+        .test(CLEAR, "2 SQRT DUP * 1000000 * IP", ENTER).expect("1 999 999.")
+        .test(CLEAR, "120 PRECISION 119 SIG", ENTER).noerror();
+    step("Rounding of long mantissa division")
+        // At 300 digits, division uses Newton's method, which computes the
+        // exact quotient with guard digits. The 299 digits shown are rounded
+        // to nearest, ties away from zero: 1.000...0005 rounds up, and
+        // -1.000...0005 down, while 1.000...00025 is truncated to 1.
+        .test(CLEAR, "300 PRECISION 299 SIG", ENTER).noerror()
+        .test(CLEAR, "4. 2E-298 + 4 /", ENTER)
+        .expect("1.00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 001")
+        .test(CLEAR, "-8. 4E-298 - 8 /", ENTER)
+        .expect("-1.00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 00000 001")
+        .test(CLEAR, "4. 1E-298 + 4 /", ENTER)
+        .expect("1.")
+        .test(CLEAR, "2. 3. /", ENTER)
+        .expect("0.66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 66666 6667")
+        .test(CLEAR, "120 PRECISION 119 SIG", ENTER).noerror();
+
+    step("Newton's method and long division give the same quotients");
+    {
+        // Compute each quotient with Newton's method, then again with long
+        // division by raising the threshold, and compare the two results
+        cstring cases[] = {
+            "2. 3.",                    "1. 7.",
+            "4. 2E-298 + 4",            "-8. 4E-298 - 8",
+            "0.498 0.008",              "123456789.123456789 9.87654321E-5",
+            "2 √ 3 √",                  "10 LN 0.007",
+            "1 EXP 1.001",              "1 7 / 3 √",
+        };
+        size_t newton = decimal::newton_kigits;
+        test(CLEAR, "300 PRECISION", ENTER).noerror();
+        for (cstring operands : cases)
+        {
+            test(CLEAR, operands, " /", ENTER).noerror();
+            decimal::newton_kigits = ~size_t(0);
+            test(operands, " /", ENTER).noerror()
+                .test("SAME", ENTER).expect("True");
+            decimal::newton_kigits = newton;
+        }
+    }
+
+    step("Series functions give the same results at several precisions")
+        // Reference values computed before the series were evaluated in an
+        // unpacked accumulator, which must not change any digit
+        .test(CLEAR, "RAD", ENTER).noerror()
+        .test(CLEAR, "12 PRECISION 11 SIG", ENTER).noerror()
+        .test(CLEAR, "0.5 EXP", ENTER)
+        .expect("1.64872 12707")
+        .test(CLEAR, "-7.125 EXP", ENTER)
+        .expect("0.00080 47330 1")
+        .test(CLEAR, "1E-5 LNP1", ENTER)
+        .expect("0.00000 99999 5")
+        .test(CLEAR, "2.25 LNP1", ENTER)
+        .expect("1.17865 49963")
+        .test(CLEAR, "2.25 SIN", ENTER)
+        .expect("0.77807 31968 8")
+        .test(CLEAR, "-0.3 SIN", ENTER)
+        .expect("-0.29552 02066 6")
+        .test(CLEAR, "7.125 COS", ENTER)
+        .expect("0.66611 04290 4")
+        .test(CLEAR, "0.5 erf", ENTER)
+        .expect("0.52049 98776 3")
+        .test(CLEAR, "-3.75 erf", ENTER)
+        .expect("-0.99999 98862 8")
+        .test(CLEAR, "7.125 lgamma", ENTER)
+        .expect("6.81454 12383")
+        .test(CLEAR, "0.3 lgamma", ENTER)
+        .expect("1.09579 79948")
+        .test(CLEAR, "34 PRECISION 33 SIG", ENTER).noerror()
+        .test(CLEAR, "0.5 EXP", ENTER)
+        .expect("1.64872 12707 00128 14684 86507 87814 16")
+        .test(CLEAR, "-7.125 EXP", ENTER)
+        .expect("0.00080 47330 10124 61327 06901 27303 869")
+        .test(CLEAR, "1E-5 LNP1", ENTER)
+        .expect("0.00000 99999 50000 33333 08333 53333 167")
+        .test(CLEAR, "2.25 LNP1", ENTER)
+        .expect("1.17865 49963 41646 11721 90231 98648 97")
+        .test(CLEAR, "2.25 SIN", ENTER)
+        .expect("0.77807 31968 87921 24141 09666 75587 757")
+        .test(CLEAR, "-0.3 SIN", ENTER)
+        .expect("-0.29552 02066 61339 57510 53207 45685 027")
+        .test(CLEAR, "7.125 COS", ENTER)
+        .expect("0.66611 04290 45426 56750 34998 45505 961")
+        .test(CLEAR, "0.5 erf", ENTER)
+        .expect("0.52049 98778 13046 53768 27466 53891 965")
+        .test(CLEAR, "-3.75 erf", ENTER)
+        .expect("-0.99999 98871 81273 01670 45531 34797 336")
+        .test(CLEAR, "7.125 lgamma", ENTER)
+        .expect("6.81454 12383 36995 70933 46174 03527 37")
+        .test(CLEAR, "0.3 lgamma", ENTER)
+        .expect("1.09579 79948 18075 52167 71681 42370 11")
+        .test(CLEAR, "100 PRECISION 99 SIG", ENTER).noerror()
+        .test(CLEAR, "0.5 EXP", ENTER)
+        .expect("1.64872 12707 00128 14684 86507 87814 16357 16537 76100 71014 80115 75079 31164 06610 21194 21560 86327 76520 05636 664")
+        .test(CLEAR, "-7.125 EXP", ENTER)
+        .expect("0.00080 47330 10124 61327 06901 27303 86907 63164 57332 48992 62360 79271 24402 26599 27880 60935 40685 03186 57285 1651")
+        .test(CLEAR, "1E-5 LNP1", ENTER)
+        .expect("0.00000 99999 50000 33333 08333 53333 16666 80952 25595 34920 53492 15440 03210 75513 30408 54707 45220 81029 37253 3222")
+        .test(CLEAR, "2.25 LNP1", ENTER)
+        .expect("1.17865 49963 41646 11721 90231 98648 96546 86542 67676 03969 66081 77685 49167 66774 23385 02074 81878 48009 44765 211")
+        .test(CLEAR, "2.25 SIN", ENTER)
+        .expect("0.77807 31968 87921 24141 09666 75587 75732 08044 60742 91022 14174 52527 80204 26422 39190 99486 45813 88115 21972 6116")
+        .test(CLEAR, "-0.3 SIN", ENTER)
+        .expect("-0.29552 02066 61339 57510 53207 45685 02737 36778 32111 74261 84485 01531 03617 32619 33959 74630 66093 16478 90788 4938")
+        .test(CLEAR, "7.125 COS", ENTER)
+        .expect("0.66611 04290 45426 56750 34998 45505 96133 47272 31859 50258 12985 17190 35796 49713 40737 00138 84026 81209 60623 4093")
+        .test(CLEAR, "0.5 erf", ENTER)
+        .expect("0.52049 98778 13046 53768 27466 53891 96452 87364 51575 75796 37000 58805 72564 71935 21716 85357 09147 88218 73478 7757")
+        .test(CLEAR, "-3.75 erf", ENTER)
+        .expect("-1.19429 35812 62614 38088 27429 68942 16418 00935 34988 50162 02748 54993 77987 14555 01056 58437 43591 98377 18659 281⁳³⁴")
+        .test(CLEAR, "7.125 lgamma", ENTER)
+        .expect("6.81454 12383 36995 70933 46174 03527 36693 64169 42307 66055 90406 80912 11432 68942 94541 99984 35050 28184 81697 068")
+        .test(CLEAR, "0.3 lgamma", ENTER)
+        .expect("1.09579 79948 18075 52167 71681 42370 10727 84451 48450 76420 34066 38623 64319 82548 35730 89833 42519 33314 87041 042");
+
     step("Restore default 24-digit precision");
     test(CLEAR, "24 PRECISION 12 SIG", ENTER).noerror();
 }
@@ -5314,6 +5668,17 @@ void tests::units_and_conversions()
               KEY2, F2,         // Enter 2_lb
               LSHIFT, F1)       // Convert to USD
         .expect("2.14 USD");
+    step("Repeated conversions use the current precision")
+        .test(CLEAR, "2.5_km 1_mi CONVERT", ENTER)
+        .expect("1.55342 79805 9 mi")
+        .test(CLEAR, "6 PRECISION 2.5_km 1_mi CONVERT", ENTER)
+        .expect("1.55343 mi")
+        .test(CLEAR, "24 PRECISION 2.5_km 1_mi CONVERT", ENTER)
+        .expect("1.55342 79805 9 mi");
+
+    step("Units looked up while factoring are not reused for conversions")
+        .test(CLEAR, "ⒸVm →NUM", ENTER)
+        .expect("0.02241 39695 45 m↑3/mol");
 
     step("Temperature conversions forward, simple case")
         .test(CLEAR, "100_°C 1_K CONVERT", ENTER)
@@ -5525,6 +5890,16 @@ void tests::list_functions()
     step("Index error when putting out of range with PUTI")
         .test(CLEAR, "{ 11 22 33 } 5 55 PUTI", ENTER)
         .error("Index out of range");
+    step("Indexed access to large lists")
+        .test(CLEAR, "1 40 FOR i i NEXT 40 →List 'L' STO", ENTER).noerror()
+        .test("L 25 GET", ENTER).expect("25")
+        .test("L 41 GET", ENTER).error("Index out of range");
+    step("Putting in place in a variable preserves copies")
+        .test(CLEAR, "L 'L' 25 99 PUT L 25 GET SWAP 25 GET", ENTER)
+        .expect("25")
+        .test(BSP).expect("99")
+        .test(CLEAR, "'L' { 25 } 1 PUT 'L' 25 GET", ENTER).expect("1")
+        .test(CLEAR, "'L' PURGE", ENTER).noerror();
 
     step("Concatenation of lists");
     test(CLEAR, "{ A B C D } { F G H I } +", ENTER)
@@ -5751,6 +6126,10 @@ void tests::sorting_functions()
         .test(CLEAR, "1.23 4.56 MIN", ENTER).expect("1.23");
     step("Max function (decimal)")
         .test(CLEAR, "1.23 4.56 MAX", ENTER).expect("4.56");
+    step("Min and max functions (decimal and zero)")
+        .test(CLEAR, "0. 0.05 MIN", ENTER).expect("0.")
+        .test(CLEAR, "0. 0.05 MAX", ENTER).expect("0.05")
+        .test(CLEAR, "0 0.05 <", ENTER).expect("True");
     step("Min function (fraction)")
         .test(CLEAR, "1/23 4/56 MIN", ENTER).expect("¹/₂₃");
     step("Max function (fraction)")
@@ -6491,6 +6870,29 @@ void tests::solver_testing()
     step("Solver with slow slope 2")
         .test(CLEAR, "'tan(x)=224' 'x' 0 ROOT", ENTER)
         .expect("x=89.74421 69693");
+    step("Solver using derivatives")
+        .test(CLEAR, "'X^5-X-1' 'X' 0 ROOT", ENTER)
+        .noerror().expect("X=1.16730 39782 6");
+    step("Simultaneous solver")
+        .test(CLEAR, "{ 'X^2+Y^2=4' 'Y=X^2-1' } { X Y } { 1 1 } MSLV", ENTER)
+        .noerror()
+        .test(CLEAR, "X", ENTER)
+        .expect("1.51748 99135 5")
+        .test(CLEAR, "Y", ENTER)
+        .expect("1.30277 56377 3")
+        .test(CLEAR, "{ X Y } purge", ENTER)
+        .noerror();
+    step("Coupled equations with stored values are solved together")
+        .test(CLEAR, "5 'X' STO 7 'Y' STO", ENTER)
+        .noerror()
+        .test(CLEAR, "{ 'X+Y=3' 'X-Y=1' } { X Y } { 0 0 } ROOT", ENTER)
+        .noerror()
+        .test(CLEAR, "X", ENTER)
+        .expect("2.")
+        .test(CLEAR, "Y", ENTER)
+        .expect("1.")
+        .test(CLEAR, "{ X Y } purge", ENTER)
+        .noerror();
 
 
     step("Solving menu")
@@ -6991,6 +7393,39 @@ void tests::numerical_integration_testing()
         .test(ID_IntegrationMenu, ID_Integrate)
         .error("Inconsistent units");
 
+    step("Integration with hardware floating-point")
+        .test(CLEAR, "16 PRECISION 24 SIG HardFP", ENTER).noerror()
+        .test("1 2 '1/X' 'X' ∫", ENTER)
+        .noerror().expect("0.69314 71805 59937 626D")
+        .test(CLEAR, "1 2 « INV » 'X' ∫", ENTER)
+        .noerror().expect("0.69314 71805 59937 626D")
+        .test(CLEAR, "2 'IntK' STO 0 1 'IntK*X+exp(X)' 'X' ∫", ENTER)
+        .noerror().expect("2.71828 18284 59045 09D")
+        .test(CLEAR, "'IntK' PURGE SoftFP 24 PRECISION Std", ENTER)
+        .noerror();
+
+    step("Adaptive integration")
+        .test(CLEAR, "AdaptiveIntegration", ENTER).noerror()
+        .test("1 2 '1/X' 'X' ∫", ENTER)
+        .noerror().expect("0.69314 71805 6")
+        .test(KEY2, ID_log, ID_subtract).expect("-5.5⁳⁻²³");
+    step("Adaptive integration uses fewer samples")
+        .test(CLEAR, "0 'IntN' STO 1 2 « 'IntN' INCR DROP INV » 'X' ∫", ENTER)
+        .noerror().expect("0.69314 71805 6")
+        .test("IntN", ENTER).expect("105")
+        .test(CLEAR, "RombergIntegration", ENTER).noerror()
+        .test("0 'IntN' STO 1 2 « 'IntN' INCR DROP INV » 'X' ∫", ENTER)
+        .noerror().expect("0.69314 71805 6")
+        .test("IntN", ENTER).expect("255");
+    step("Adaptive integration with a narrow peak")
+        .test(CLEAR, "0 1 '1/(1E-4+(X-0.3)^2)' 'X' ∫", ENTER)
+        .error("Numerical precision lost")
+        .test(CLEAR, "AdaptiveIntegration", ENTER).noerror()
+        .test("0 1 '1/(1E-4+(X-0.3)^2)' 'X' ∫", ENTER)
+        .noerror().expect("309.39869 1512")
+        .test(CLEAR, "RombergIntegration 'IntN' PURGE", ENTER)
+        .noerror();
+
     step("Integrate with symbols")
         .test(CLEAR, "A B '1/X' 'X' ∫", ENTER)
         .expect("'∫(A;B;1÷X;X)'")
@@ -7253,6 +7688,18 @@ void tests::auto_simplification()
         .expect("'1+abs (abs X)+abs(-Y)'")
         .test(RUNSTOP).expect("'abs X+abs Y+1'");
 
+    step("Memoized simplification after storing a variable")
+        .test(CLEAR, "'MemoX+1+MemoX' SIMPLIFY", ENTER)
+        .expect("'2·MemoX+1'")
+        .test(CLEAR, "3 'MemoX' STO 'MemoX+1+MemoX' SIMPLIFY", ENTER)
+        .expect("'7'")
+        .test(CLEAR, "'MemoX' PURGE 'MemoX+1+MemoX' SIMPLIFY", ENTER)
+        .expect("'2·MemoX+1'");
+    step("Memoized derivative depends on the variable")
+        .test(CLEAR, "'sin(Y)*Y' 'X' ∂", ENTER).expect("'0'")
+        .test(CLEAR, "'sin(Y)*Y' 'Y' ∂", ENTER).expect("'sin Y+cos Y·Y'")
+        .test(CLEAR, "'sin(Y)*Y' 'X' ∂", ENTER).expect("'0'");
+
     step("Disable auto simplification");
     test(CLEAR, "NoAutoSimplify", ENTER).noerror();
 
@@ -7360,6 +7807,20 @@ void tests::rewrite_engine()
         .expect("3")
         .test(BSP)
         .expect("'5+tan(-B+A)+(-sin(-A+(C+D))+3)'");
+    step("Rule whose outer type disappears after rewrite (down multiple)");
+    test(CLEAR, "FinalAlgebraResults", ENTER,
+         "'sin(X)*Y+sin(Z)' { 'sin(x)' 'cos(x)' }",
+         RSHIFT, KEY7, F6, F1)
+        .expect("2")
+        .test(BSP)
+        .expect("'cos X·Y+cos Z'");
+    step("Rule whose outer type disappears after rewrite (up multiple)");
+    test(CLEAR, "FinalAlgebraResults", ENTER,
+         "'sin(X)*Y+sin(Z)' { 'sin(x)' 'cos(x)' }",
+         RSHIFT, KEY7, F6, F2)
+        .expect("2")
+        .test(BSP)
+        .expect("'cos X·Y+cos Z'");
 
     step("Matching integers");
     test(CLEAR, "'(A+B)^3' { 'X^K' 'X*X^(K-1)' }", RSHIFT, KEY7, F6, F1)
@@ -37,6 +37,7 @@
 #include "file.h"
 #include "functions.h"
 #include "grob.h"
+#include "hash.h"
 #include "integer.h"
 #include "parser.h"
 #include "renderer.h"
@@ -861,8 +862,169 @@ static const si_prefix si_prefixes[] =
 
 
 
+struct unit_memo
+// ----------------------------------------------------------------------------
+//   Recently used units and conversion factors, kept across commands
+// ----------------------------------------------------------------------------
+//   Looking up a unit scans the units file once per SI prefix, then parses
+//   and evaluates its definition. Converting between two units evaluates
+//   both unit expressions. The results only depend on the settings, which
+//   are part of the key, and on the units file. Like the constants index,
+//   the memo is dropped when the size or modification time of that file
+//   changes.
+{
+    enum { UNITS = 16, FACTORS = 8 };
+
+    struct unit_entry
+    {
+        uint        hash;           // Hash of name and settings
+        symbol_g    name;           // Name being looked up
+        unit_g      result;         // Unit, or nullptr if not a unit
+        int         prefix;         // Prefix information for the unit
+    };
+
+    struct factor_entry
+    {
+        uint        hash;           // Hash of units and settings
+        algebraic_g from;           // Unit expression we convert from
+        algebraic_g to;             // Unit expression we convert to
+        algebraic_g factor;         // Conversion factor
+    };
+
+    unit_entry      units[UNITS];
+    factor_entry    factors[FACTORS];
+    uint            nextUnit;
+    uint            nextFactor;
+};
+static unit_memo *UnitMemo = nullptr;
+static uint       UnitFileSize = 0;         // Size of units file for memo
+static uint       UnitFileModified = 0;     // Modification time of the file
+
+
+static uint memo_seed()
+// ----------------------------------------------------------------------------
+//   Initial hash for the memo, covering what may change the results
+// ----------------------------------------------------------------------------
+//   Unit definitions are evaluated in the caller's unit mode, so while
+//   factoring, a unit like kPa is not expanded down to base units
+{
+    uint sh   = Settings.hash();
+    uint hash = fnv1a(&sh, sizeof(sh));
+    hash = fnv1a(hash, &unit::mode, sizeof(unit::mode));
+    hash = fnv1a(hash, &unit::factoring, sizeof(unit::factoring));
+    return fnv1a(hash, &unit::nodates, sizeof(unit::nodates));
+}
+
+
+static unit_memo *memo_allocate()
+// ----------------------------------------------------------------------------
+//   Return the memo, allocating it the first time
+// ----------------------------------------------------------------------------
+{
+    unit_memo *memo = UnitMemo;
+    if (!memo)
+    {
+        // operator new support purposefully not linked in embedded versions
+        memo = (unit_memo *) malloc(sizeof(unit_memo));
+        if (!memo)
+            return nullptr;
+        new(memo) unit_memo();
+        UnitMemo = memo;
+    }
+    return memo;
+}
+
+
+void unit::memo_flush()
+// ----------------------------------------------------------------------------
+//   Forget memoized units and conversion factors
+// ----------------------------------------------------------------------------
+{
+    if (unit_memo *memo = UnitMemo)
+    {
+        for (unit_memo::unit_entry &e : memo->units)
+        {
+            e.hash   = 0;
+            e.name   = nullptr;
+            e.result = nullptr;
+        }
+        for (unit_memo::factor_entry &e : memo->factors)
+        {
+            e.hash   = 0;
+            e.from   = nullptr;
+            e.to     = nullptr;
+            e.factor = nullptr;
+        }
+    }
+}
+
+
+static unit_memo *memo_current()
+// ----------------------------------------------------------------------------
+//   Return the memo if it still matches the units file, flushing it if not
+// ----------------------------------------------------------------------------
+{
+    unit_file ufile;
+    uint      size  = ufile.valid() ? ufile.size() : 0;
+    uint      mtime = ufile.valid() ? ufile.modified() : 0;
+    if (size != UnitFileSize || mtime != UnitFileModified)
+    {
+        record(units, "Units file changed, flushing memo");
+        unit::memo_flush();
+        UnitFileSize     = size;
+        UnitFileModified = mtime;
+    }
+    return UnitMemo;
+}
+
+
 unit_p unit::lookup(symbol_p namep, int *prefix_info)
 // ----------------------------------------------------------------------------
+//   Lookup a unit, using the memo if possible
+// ----------------------------------------------------------------------------
+{
+    // While an error is pending, evaluating the definition may clear it
+    uint hash = fnv1a(memo_seed(), namep, namep->size()) | 1;
+    if (unit_memo *memo = rt.error() ? nullptr : memo_current())
+    {
+        for (unit_memo::unit_entry &e : memo->units)
+        {
+            if (e.hash == hash && e.name && e.name->is_same_as(namep))
+            {
+                record(units, "Memoized %t", namep);
+                if (prefix_info && e.result)
+                    *prefix_info = e.prefix;
+                return e.result;
+            }
+        }
+    }
+
+    symbol_g name   = namep;
+    int      prefix = 0;
+    unit_g   result = lookup_uncached(name, &prefix);
+    if (prefix_info && result)
+        *prefix_info = prefix;
+    if (rt.error())
+        return result;
+
+    if (unit_memo *memo = memo_allocate())
+    {
+        unit_memo::unit_entry &e = memo->units[memo->nextUnit];
+        memo->nextUnit = (memo->nextUnit + 1) % unit_memo::UNITS;
+        e.hash   = hash;
+        e.name   = name;
+        e.result = result;
+        e.prefix = prefix;
+
+        // The memoized objects must survive the current command
+        cleaner::disable();
+    }
+    return result;
+}
+
+
+unit_p unit::lookup_uncached(symbol_p namep, int *prefix_info)
+// ----------------------------------------------------------------------------
 //   Lookup a built-in unit
 // ----------------------------------------------------------------------------
 {
@@ -1041,8 +1203,36 @@ bool unit::convert(unit_g &x, bool error) const
 
     if (!unit::mode)
     {
+        // The result is built in unit mode, like the factor below
         save<bool> sumode(unit::mode, true);
 
+        // Check if we already know the conversion factor
+        uint hash = fnv1a(memo_seed(), +o, o->size());
+        hash = fnv1a(hash, +u, u->size()) | 1;
+        if (unit_memo *memo = rt.error() ? nullptr : memo_current())
+        {
+            for (unit_memo::factor_entry &e : memo->factors)
+            {
+                if (e.hash == hash &&
+                    e.from && e.from->is_same_as(+o) &&
+                    e.to && e.to->is_same_as(+u))
+                {
+                    record(units, "Memoized factor %t for %t->%t",
+                           +e.factor, +o, +u);
+                    algebraic_g v = x->value();
+                    algebraic_g f = e.factor;
+                    {
+                        settings::SaveAutoSimplify sas(false);
+                        v = v * f;
+                    }
+                    x = unit_p(unit::simple(v, svu));
+                    return true;
+                }
+            }
+        }
+        algebraic_g from   = o;
+        bool        linear = true;
+
         // Evaluate the unit expression for this one
         u = u->evaluate();
         if (!u)
@@ -1070,6 +1260,7 @@ bool unit::convert(unit_g &x, bool error) const
                 object_g         xvalue = x->value();
                 save<object_g *> sv(expression::independent_value, &xvalue);
                 save<bool>       sumode2(unit::mode, false);
+                linear = false;
                 o = oe->evaluate();
                 if (!o)
                     return false;
@@ -1114,6 +1305,7 @@ bool unit::convert(unit_g &x, bool error) const
                     object_g         xv = x->value();
                     save<object_g *> sv(expression::independent_value, &xv);
                     save<bool> sumode3(unit::mode, false);
+                    linear = false;
                     udef = ue->evaluate();
                     x = unit_p(unit::simple(udef, +xname));
                     u = unit::simple(integer::make(1), +tname);
@@ -1149,6 +1341,21 @@ bool unit::convert(unit_g &x, bool error) const
             return false;
         }
 
+        // Remember linear conversion factors, e.g. km/h to m/s
+        if (linear && !rt.error())
+        {
+            if (unit_memo *memo = memo_allocate())
+            {
+                unit_memo::factor_entry &e = memo->factors[memo->nextFactor];
+                memo->nextFactor = (memo->nextFactor + 1) % unit_memo::FACTORS;
+                e.hash   = hash;
+                e.from   = from;
+                e.to     = svu;
+                e.factor = o;
+                cleaner::disable();
+            }
+        }
+
         algebraic_g v = x->value();
         {
             settings::SaveAutoSimplify sas(false);
@@ -60,6 +60,8 @@ struct unit : complex
     static algebraic_p parse_uexpr(gcutf8 source, size_t &len);
 
     static unit_p lookup(symbol_p name, int *prefix_index = nullptr);
+    static unit_p lookup_uncached(symbol_p name, int *prefix_index = nullptr);
+    static void   memo_flush();
 
     unit_p cycle() const;
     unit_p custom_cycle(symbol_r sym) const;
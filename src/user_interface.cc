@@ -40,6 +40,7 @@
 #include "functions.h"
 #include "graphics.h"
 #include "grob.h"
+#include "help_index.h"
 #include "list.h"
 #include "menu.h"
 #include "precedence.h"
@@ -2376,6 +2377,10 @@ bool user_interface::draw_editor()
 // ----------------------------------------------------------------------------
 //   Draw the editor
 // ----------------------------------------------------------------------------
+//   There is no index of line starts and widths, so some costs remain
+//   linear in the size of the text: counting rows after the row cache was
+//   invalidated, e.g. by a newline or a cursor jump, and skipping the rows
+//   above the visible area. Typing on a line keeps the cached row count.
 {
     if ((!force && !dirtyEditor) || freezeStack)
         return false;
@@ -2408,10 +2413,8 @@ bool user_interface::draw_editor()
 
     // Count rows and colums
     int  rows   = 1;            // Number of rows in editor
-    int  cwidth = 0;            // Column width
     int  edrow  = 0;            // Row number of line being edited
     int  cursx  = 0;            // Cursor X position
-    bool found  = false;
 
     byte *wed = (byte *) ed;
     wed[len] = 0;               // Ensure utf8_next does not go into the woods
@@ -2420,42 +2423,33 @@ bool user_interface::draw_editor()
 reposition:
     if (!edRows)
     {
-        for (utf8 p = ed; p < last; p = utf8_next(p))
-            if (*p == '\n')
-                rows++;
-        edRows = rows;
-
-        font = Settings.editor_font(rows > 2);
-
+        // A single byte scan finds rows and the start of the cursor row,
+        // since '\n' never appears inside a multi-byte UTF-8 sequence
+        utf8 curs  = ed + (cursor < len ? cursor : len);
+        utf8 start = ed;
         rows = 1;
-        for (utf8 p = ed; p < last; p = utf8_next(p))
+        edrow = 0;
+        for (utf8 p = ed; p < last; p++)
         {
-            if (p - ed == (int) cursor)
-            {
-                edrow = rows - 1;
-                cursx = cwidth;
-                found = true;
-            }
-
             if (*p == '\n')
             {
+                if (p < curs)
+                {
+                    start = p + 1;
+                    edrow++;
+                }
                 rows++;
-                cwidth = 0;
             }
-            else
-            {
-                unicode cp  = utf8_codepoint(p);
-                cwidth     += font->width(cp);
-            }
-        }
-        if (!found)
-        {
-            edrow = rows - 1;
-            cursx = cwidth;
         }
-
+        edRows = rows;
         edRow = edrow;
 
+        // Only measure the text on the cursor row
+        font = Settings.editor_font(rows > 2);
+        cursx = 0;
+        for (utf8 p = start; p < curs; p = utf8_next(p))
+            cursx += font->width(utf8_codepoint(p));
+
         record(text_editor, "Computed: row %d/%d cursx %d (%d+%d=%d)",
                edrow, rows, cursx, cx, xoffset, cx+xoffset);
     }
@@ -2473,12 +2467,33 @@ reposition:
     // Check if we want to move the cursor up or down
     if (up || down)
     {
-        int   r    = 0;
         coord c    = 0;
         int   tgt  = edrow - (up && edrow > 0) + down;
         bool  done = up && edrow == 0;
         bool  repo = false;
 
+        // Walk from the cursor row to the target row, not from the top
+        utf8 p = ed + (cursor < len ? cursor : len);
+        int  r = edrow;
+        while (p > ed && p[-1] != '\n')
+            p--;
+        if (up && edrow > 0)
+        {
+            for (p--; p > ed && p[-1] != '\n'; p--)
+                /* Nothing */;
+            r--;
+        }
+        else if (down)
+        {
+            while (p < last && *p != '\n')
+                p++;
+            if (p < last)
+            {
+                p++;
+                r++;
+            }
+        }
+
         record(text_editor,
                "Moving %+s%+s edrow=%d target=%d curs=%d cursx=%d edcx=%d",
                up ? "up" : "", down ? "down" : "",
@@ -2490,7 +2505,7 @@ reposition:
             repo = true;
         }
 
-        for (utf8 p   = ed; p < last && !done; p = utf8_next(p))
+        for (; p < last && !done && r == tgt; p = utf8_next(p))
         {
             if (*p == '\n')
             {
@@ -2502,7 +2517,7 @@ reposition:
                     done   = true;
                 }
             }
-            else if (r == tgt)
+            else
             {
                 unicode cp = utf8_codepoint(p);
                 c += font->width(cp);
@@ -2568,10 +2583,11 @@ reposition:
                clippedRows,
                skip);
 
+        // Byte scan, since '\n' is never part of a multi-byte sequence
         for (int r = 0; r < skip; r++)
         {
             do
-                display = utf8_next(display);
+                display++;
             while (*display != '\n');
         }
         if (skip)
@@ -3060,6 +3076,55 @@ bool user_interface::transient_object(object_p obj)
 }
 
 
+static bool help_index_find(file              &index,
+                            uint32_t           hash,
+                            bool               spelling,
+                            help_index::entry &best)
+// ----------------------------------------------------------------------------
+//   Find a topic hash in the binary help index, update best match
+// ----------------------------------------------------------------------------
+//   The bucket for the hash gives the range of entries to read, which is
+//   typically a few entries long, so this takes two or three file reads.
+//   For a command spelling, we also accept the first word of a topic, but
+//   we only do that for second and third level sections.
+//   Entries for a given hash are sorted by level, so the first one we find
+//   is the main section for the topic. We only replace the best match found
+//   so far if it has a lower level.
+{
+    uint32_t range[2];
+    index.seek(sizeof(uint32_t) * (2 + help_index::bucket(hash)));
+    if (!index.read((char *) range, sizeof(range)))
+        return false;
+
+    const uint        BATCH = 16;
+    help_index::entry entries[BATCH];
+    for (uint32_t i = range[0]; i < range[1]; i += BATCH)
+    {
+        uint n = range[1] - i < BATCH ? range[1] - i : BATCH;
+        index.seek(sizeof(uint32_t) * help_index::HEADER +
+                   sizeof(help_index::entry) * i);
+        if (!index.read((char *) entries, sizeof(*entries) * n))
+            return false;
+
+        for (uint e = 0; e < n; e++)
+        {
+            const help_index::entry &x = entries[e];
+            if (x.hash > hash)
+                return false;
+            if (x.hash == hash && (spelling ? x.level() >= 2 : !x.prefix()))
+            {
+                record(help_search, "Index hash %08x at %u level %u",
+                       hash, x.position(), x.level());
+                if (!best.data || x.level() < best.level())
+                    best = x;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+
 void user_interface::load_help(utf8 topic, size_t len)
 // ----------------------------------------------------------------------------
 //   Find the help message associated with the topic
@@ -3091,7 +3156,7 @@ void user_interface::load_help(utf8 topic, size_t len)
     // alternate spellings as well
     size_t     cmdlen = len;
     object::id cmd = isvar ? object::id(0) : command::lookup(topic, cmdlen);
-    byte       ref[80];         // Length checked in the makefile
+    byte       ref[80];         // Longer topics are truncated
     size_t     refidx   = 0;
     if (cmdlen != len)
         cmd = object::id(0);
@@ -3105,54 +3170,37 @@ void user_interface::load_help(utf8 topic, size_t len)
     bool       found    = false;
     uint       idxpos   = 0;
 
-    // Check if the index exists. If so, scan it
+    // Check if the index exists. If so, look the topic up
     {
-        file index(HELPINDEX_NAME, file::READING);
-        if (index.valid())
+        file     index(HELPINDEX_NAME, file::READING);
+        uint32_t magic = 0;
+        if (index.valid() &&
+            index.read((char *) &magic, sizeof(magic)) &&
+            magic == help_index::MAGIC)
         {
-            for (char c = index.getchar(); !found && c; c = index.getchar())
+            // For regular topics, look up the topic hash directly.
+            // The hash matches markdown hyperlink style, i.e. case independent
+            // and matching '-' in the topic to ' ' in the text
+            help_index::entry best = { 0, 0 };
+            uint32_t hash = help_index::hash(topic, len);
+            help_index_find(index, hash, false, best);
+
+            // Check all spellings, which may point to a main section
+            for (size_t i = 0; cmd && i < object::spelling_count; i++)
             {
-                if (c == '\n')
-                {
-                    uint filepos = atoi(cstring(ref));
-                    byte_p p = ref;
-                    byte_p end = ref + refidx;
-                    while (p < end && *p++ != ':')
-                        /* nop */;
-
-                    level = 0;
-                    while (p < end && *p++ == '#')
-                        level++;
-                    while (p < end && *p == ' ')
-                        p++;
-
-                    refidx = refidx - (p - ref);
-
-                    // For regular topics, just to a string comparison
-                    // We match markdown hyperlink style, i.e. case independent
-                    // and matching '-' in the topic to ' ' in the text
-                    found = refidx == len;
-                    for (uint i = 0; found && i < len; i++)
-                        found = (tolower(p[i]) == tolower(topic[i]) ||
-                                 (p[i] == ' ' && topic[i] == '-'));
-
-                    // If we do not match a direct comparison, check spellings
-                    // We only do that for second and third level sections
-                    if (!found && cmd && level >= 2)
-                        found = command::lookup(p, refidx) == cmd;
-
-                    if (found)
-                    {
-                        idxpos = filepos;
-                        break;
-                    }
-                    refidx = 0;
-                }
-                else
+                const object::spelling &s = object::spellings[i];
+                if (s.type == cmd && s.name)
                 {
-                    ref[refidx++] = c;
+                    hash = help_index::hash(utf8(s.name), strlen(s.name));
+                    help_index_find(index, hash, true, best);
                 }
             }
+            found = best.data != 0;
+            if (found)
+            {
+                idxpos = best.position();
+                level  = best.level();
+            }
 
             // Not found in index, quit
             if (!found)
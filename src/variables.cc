@@ -34,6 +34,7 @@
 #include "constants.h"
 #include "expression.h"
 #include "files.h"
+#include "hash.h"
 #include "integer.h"
 #include "list.h"
 #include "locals.h"
@@ -192,6 +193,347 @@ object::result directory::enter() const
 }
 
 
+struct directory_index
+// ----------------------------------------------------------------------------
+//   Hash index of the names in the most recently used global directories
+// ----------------------------------------------------------------------------
+//   Looking up a name in a directory is a linear walk over names and values,
+//   which becomes the dominant cost of programs using many variables.
+//   This keeps open-addressing hash tables recording the offset of each name
+//   relative to the directory. Like the font cache, the tables live outside
+//   of the runtime, since globals can move while the scratchpad is in use.
+//   Offsets are adjusted in place when globals move, and an index is dropped
+//   when the directory it describes is overwritten or purged.
+{
+    enum
+    {
+        MAX_DIRECTORIES = 4,    // Number of directories indexed at once
+        MIN_BYTES       = 256,  // Smaller directories are scanned linearly
+        MIN_SLOTS       = 32,   // Minimum size of a hash table
+    };
+
+    struct table
+    // ------------------------------------------------------------------------
+    //   The index for a single directory
+    // ------------------------------------------------------------------------
+    {
+        object_p  dir;          // Directory being indexed, null if unused
+        uint32_t *slots;        // Offset of names from dir, 0 for empty slot
+        uint32_t  mask;         // Number of slots - 1
+        uint32_t  count;        // Number of names in the table
+        uint      used;         // Last use, for LRU replacement
+        bool      valid;        // Table content matches directory
+        bool      folded;       // Table was built ignoring symbol case
+    };
+
+    directory_index(): tables(), uses(0) {}
+    ~directory_index() { clear(); }
+
+
+    static uint32_t hash(object_p name)
+    // ------------------------------------------------------------------------
+    //   Hash a name consistently with the comparison in directory::lookup
+    // ------------------------------------------------------------------------
+    {
+        uint32_t h = FNV1A_BASIS;
+        if (symbol_p sym = name->as<symbol>())
+        {
+            size_t len = 0;
+            utf8   txt = sym->value(&len);
+            bool   fold = Settings.IgnoreSymbolCase();
+            for (size_t i = 0; i < len && txt[i]; i++)
+            {
+                byte c = txt[i];
+                if (fold && c >= 'A' && c <= 'Z')
+                    c += 'a' - 'A';
+                h = fnv1a(h, c);
+            }
+            h = fnv1a(h, len);
+        }
+        else
+        {
+            h = fnv1a(h, name, name->size());
+        }
+        return h ^ (h >> 15);
+    }
+
+
+    static bool same(object_p name, object_p ref, symbol_p rsym, size_t rsize)
+    // ------------------------------------------------------------------------
+    //   Check if the name matches what directory::lookup would accept
+    // ------------------------------------------------------------------------
+    {
+        if (name == ref)
+            return true;
+        if (name->size() != rsize)
+            return false;
+        if (rsym)
+        {
+            symbol_p nsym = name->as<symbol>();
+            return nsym && rsym->is_same_as(nsym);
+        }
+        return memcmp(cstring(name), cstring(ref), rsize) == 0;
+    }
+
+
+    table *find(object_p dir)
+    // ------------------------------------------------------------------------
+    //   Find the table for a given directory
+    // ------------------------------------------------------------------------
+    {
+        for (table &t : tables)
+            if (t.dir == dir)
+                return &t;
+        return nullptr;
+    }
+
+
+    table *allocate(object_p dir)
+    // ------------------------------------------------------------------------
+    //   Find or recycle a table for the given directory
+    // ------------------------------------------------------------------------
+    {
+        table *victim = tables;
+        for (table &t : tables)
+        {
+            if (t.dir == dir)
+                return &t;
+            if (!t.dir || (victim->dir && t.used < victim->used))
+                victim = &t;
+        }
+        victim->dir = dir;
+        victim->valid = false;
+        return victim;
+    }
+
+
+    static bool insert(table &t, object_p dir, object_p name)
+    // ------------------------------------------------------------------------
+    //   Insert a name in the table, unless an equivalent name is present
+    // ------------------------------------------------------------------------
+    {
+        size_t   rsize = name->size();
+        symbol_p rsym  = name->as<symbol>();
+        uint32_t mask  = t.mask;
+        for (uint32_t i = hash(name) & mask; t.slots[i]; i = (i + 1) & mask)
+            if (same(dir + t.slots[i], name, rsym, rsize))
+                return false;   // Keep the first one, as lookup would
+        for (uint32_t i = hash(name) & mask; ; i = (i + 1) & mask)
+        {
+            if (!t.slots[i])
+            {
+                t.slots[i] = name - dir;
+                t.count++;
+                return true;
+            }
+        }
+    }
+
+
+    static bool build(table &t, directory_p dir)
+    // ------------------------------------------------------------------------
+    //   Build the table for a directory
+    // ------------------------------------------------------------------------
+    {
+        byte_p p     = dir->payload();
+        size_t size  = leb128<size_t>(p);
+        byte_p body  = p;
+        size_t count = 0;
+
+        // Count names, checking the directory is well-formed
+        while (size)
+        {
+            object_p name = object_p(p);
+            size_t   ns   = name->size();
+            size_t   vs   = name->skip()->size();
+            if (ns + vs > size)
+                return false;
+            p += ns + vs;
+            size -= ns + vs;
+            count++;
+        }
+
+        // Size the table to be at most half full
+        size_t slots = MIN_SLOTS;
+        while (slots < 2 * count)
+            slots *= 2;
+        if (slots - 1 != t.mask || !t.slots)
+        {
+            free(t.slots);
+            t.slots = (uint32_t *) malloc(slots * sizeof(uint32_t));
+            t.mask = slots - 1;
+            if (!t.slots)
+                return false;
+        }
+        memset(t.slots, 0, slots * sizeof(uint32_t));
+        t.count = 0;
+        t.folded = Settings.IgnoreSymbolCase();
+
+        // Insert names in directory order, so that the first one wins
+        object_p start = object_p(dir);
+        for (p = body; count--; )
+        {
+            object_p name = object_p(p);
+            insert(t, start, name);
+            p = byte_p(name->skip()->skip());
+        }
+        t.valid = true;
+        record(directory, "Indexed %u names in directory %p", t.count, dir);
+        return true;
+    }
+
+
+    bool lookup(directory_p dir, object_p ref, object_p &found)
+    // ------------------------------------------------------------------------
+    //   Lookup a name through the index, return false if not indexed
+    // ------------------------------------------------------------------------
+    {
+        object_p start = object_p(dir);
+        if (!rt.is_global(start))
+            return false;
+
+        table *t = find(start);
+        if (!t || !t->valid || t->folded != Settings.IgnoreSymbolCase())
+        {
+            // Only index directories that are large enough to benefit
+            byte_p p = dir->payload();
+            if (leb128<size_t>(p) < MIN_BYTES)
+                return false;
+            t = allocate(start);
+            if (!build(*t, dir))
+            {
+                t->dir = nullptr;
+                return false;
+            }
+        }
+        t->used = ++uses;
+
+        size_t   rsize = ref->size();
+        symbol_p rsym  = ref->as<symbol>();
+        uint32_t mask  = t->mask;
+        found = nullptr;
+        for (uint32_t i = hash(ref) & mask; t->slots[i]; i = (i + 1) & mask)
+        {
+            object_p name = start + t->slots[i];
+            if (same(name, ref, rsym, rsize))
+            {
+                found = name;
+                break;
+            }
+        }
+        return true;
+    }
+
+
+    void added(object_p dir, object_p name)
+    // ------------------------------------------------------------------------
+    //   Record a name that was just inserted in the directory
+    // ------------------------------------------------------------------------
+    {
+        if (table *t = find(dir))
+            if (t->valid)
+                if (2 * (t->count + 1) > t->mask + 1 || !insert(*t, dir, name))
+                    t->valid = false;
+    }
+
+
+    void replaced(object_p start, size_t size)
+    // ------------------------------------------------------------------------
+    //   Drop the tables for directories in a region being overwritten
+    // ------------------------------------------------------------------------
+    {
+        object_p end = start + size;
+        for (table &t : tables)
+            if (t.dir >= start && t.dir < end)
+                t.dir = nullptr;
+    }
+
+
+    void moved(object_p to, object_p from)
+    // ------------------------------------------------------------------------
+    //   Adjust tables when all globals from `from` move to `to`
+    // ------------------------------------------------------------------------
+    {
+        int delta = to - from;
+        for (table &t : tables)
+        {
+            if (!t.dir)
+                continue;
+
+            // Directory moves as a whole: offsets remain valid
+            if (t.dir >= from)
+            {
+                t.dir += delta;
+                continue;
+            }
+
+            // Directory in a region being removed
+            if (t.dir >= to)
+            {
+                t.dir = nullptr;
+                continue;
+            }
+
+            // Names after the insertion or removal point move
+            if (!t.valid)
+                continue;
+            uint32_t moving  = from - t.dir;
+            uint32_t removed = delta < 0 ? to - t.dir : moving;
+            uint32_t slots   = t.mask + 1;
+            for (uint32_t i = 0; i < slots; i++)
+            {
+                uint32_t offset = t.slots[i];
+                if (offset >= moving)
+                {
+                    t.slots[i] = offset + delta;
+                }
+                else if (offset >= removed)
+                {
+                    // A name was purged, rebuild on next lookup
+                    t.valid = false;
+                    break;
+                }
+            }
+        }
+    }
+
+
+    void clear()
+    // ------------------------------------------------------------------------
+    //   Release all the tables
+    // ------------------------------------------------------------------------
+    {
+        for (table &t : tables)
+        {
+            free(t.slots);
+            t = table();
+        }
+    }
+
+private:
+    table tables[MAX_DIRECTORIES];
+    uint  uses;
+} DirectoryIndex;
+
+
+void directory::reindex(object_p to, object_p from)
+// ----------------------------------------------------------------------------
+//   Update the name index after globals moved
+// ----------------------------------------------------------------------------
+{
+    DirectoryIndex.moved(to, from);
+}
+
+
+void directory::unindex()
+// ----------------------------------------------------------------------------
+//   Drop the name index, e.g. when the globals area is reinitialized
+// ----------------------------------------------------------------------------
+{
+    DirectoryIndex.clear();
+}
+
+
 object_p directory::store(object_g name, object_g value)
 // ----------------------------------------------------------------------------
 //    Store an object in the directory and return stored value
@@ -271,6 +613,9 @@ object_p directory::store(object_g name, object_g value)
 
         // Clone any value in the stack that points to the existing value
         rt.clone_global(evalue, es);
+        rt.unindex(evalue, es);
+        DirectoryIndex.replaced(evalue, es);
+        expression::memo_flush();
 
         // Move memory above storage if necessary
         if (vs != es)
@@ -305,6 +650,7 @@ object_p directory::store(object_g name, object_g value)
         memmove((byte *) start, (byte *) name, ns);
         memmove((byte *) start + ns, (byte *) value, vs);
         value = start + ns;
+        DirectoryIndex.added(object_p(+thisdir), start);
 
         // Compute new size of the directory
         delta = requested;
@@ -340,6 +686,29 @@ object_p directory::update(object_p name, object_p value)
 }
 
 
+bool directory::overwrite(object_p global, object_p old, object_g value)
+// ----------------------------------------------------------------------------
+//   Overwrite part of a global value in place with an object of same size
+// ----------------------------------------------------------------------------
+{
+    size_t vs = value->size();
+    if (old->size() != vs || !rt.is_global(global) || !rt.is_global(old))
+        return false;
+
+    // Clone any value in the stack that points to the existing value
+    rt.clone_global(global, global->size());
+    if (rt.error())
+        return false;
+    rt.unindex(old, vs);
+    DirectoryIndex.replaced(old, vs);
+    expression::memo_flush();
+
+    // Sizes do not change, so the directories and offsets remain valid
+    memmove((byte *) old, (byte *) +value, vs);
+    return true;
+}
+
+
 void directory::adjust_sizes(directory_r thisdir, int delta)
 // ----------------------------------------------------------------------------
 //   Ajust the size for this directory and all enclosing ones
@@ -377,6 +746,10 @@ object_p directory::lookup(object_p ref) const
 //   Find if the name exists in the directory, if so return pointer to it
 // ----------------------------------------------------------------------------
 {
+    object_p found = nullptr;
+    if (DirectoryIndex.lookup(this, ref, found))
+        return found;
+
     byte_p   p     = payload();
     size_t   size  = leb128<size_t>(p);
     size_t   rsize = ref->size();
@@ -1000,8 +1373,12 @@ COMMAND_BODY(GarbageCollectorStatistics)
     tag_g lpurged   = tag::make("LastPurged",   integer::make(rt.GCLPurged));
     tag_g lduration = tag::make("LastDuration", integer::make(rt.GCLDuration));
     tag_g cleared   = tag::make("Cleared",      integer::make(rt.GCCleared));
+    tag_g lobjects  = tag::make("LastObjects",  integer::make(rt.GCLObjects));
+    tag_g lroots    = tag::make("LastRoots",    integer::make(rt.GCLRoots));
+    tag_g lpasses   = tag::make("LastPasses",   integer::make(rt.GCLPasses));
 
-    if (cycles && purged && duration && lpurged && lduration && cleared)
+    if (cycles && purged && duration && lpurged && lduration && cleared &&
+        lobjects && lroots && lpasses)
     {
         scribble scr;
         if (rt.append(cycles)    &&
@@ -1009,7 +1386,10 @@ COMMAND_BODY(GarbageCollectorStatistics)
             rt.append(duration)  &&
             rt.append(lpurged)   &&
             rt.append(lduration) &&
-            rt.append(cleared))
+            rt.append(cleared)   &&
+            rt.append(lobjects)  &&
+            rt.append(lroots)    &&
+            rt.append(lpasses))
         {
             size_t sz = scr.growth();
             gcbytes data = scr.scratch();
@@ -1025,6 +1405,9 @@ COMMAND_BODY(GarbageCollectorStatistics)
                         rt.GCLPurged           = 0;
                         rt.GCLDuration         = 0;
                         rt.GCCleared           = 0;
+                        rt.GCLObjects          = 0;
+                        rt.GCLRoots            = 0;
+                        rt.GCLPasses           = 0;
                     }
                     return OK;
                 }
@@ -96,6 +96,11 @@ struct directory : list
     //    Update an existing name
     // ------------------------------------------------------------------------
 
+    static bool overwrite(object_p global, object_p old, object_g value);
+    // ------------------------------------------------------------------------
+    //    Overwrite an object inside a global value with one of the same size
+    // ------------------------------------------------------------------------
+
     object_p recall(object_p name) const;
     // ------------------------------------------------------------------------
     //    Check if a name exists in the directory, return value ptr if it does
@@ -126,6 +131,16 @@ struct directory : list
     //   Purge an entry from the directory and parents
     // ------------------------------------------------------------------------
 
+    static void reindex(object_p to, object_p from);
+    // ------------------------------------------------------------------------
+    //   Update the name index after globals moved
+    // ------------------------------------------------------------------------
+
+    static void unindex();
+    // ------------------------------------------------------------------------
+    //   Drop the name index, e.g. when the globals area is reinitialized
+    // ------------------------------------------------------------------------
+
     size_t count() const
     // ------------------------------------------------------------------------
     //   Return the number of variables in the directory
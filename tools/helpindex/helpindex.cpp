@@ -0,0 +1,187 @@
+// ****************************************************************************
+//  helpindex.cpp                                                 DB48X project
+// ****************************************************************************
+//
+//   File Description:
+//
+//     Generate the binary index of topics in the help file
+//
+//     The input is the markdown help file, the output is the binary index
+//     described in src/help_index.h
+//
+//
+//
+//
+// ****************************************************************************
+//   (C) 2024 Christophe de Dinechin <christophe@dinechin.org>
+//   This software is licensed under the terms outlined in LICENSE.txt
+// ****************************************************************************
+//   This file is part of DB48X.
+//
+//   DB48X is free software: you can redistribute it and/or modify
+//   it under the terms outlined in the LICENSE.txt file
+//
+//   DB48X is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// ****************************************************************************
+
+#include "help_index.h"
+#include "utf8.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+
+typedef help_index::entry           entry;
+typedef std::vector<entry>          entries;
+
+
+static size_t first_word(utf8 text, size_t len)
+// ----------------------------------------------------------------------------
+//   Return the length of the first word, the way command::lookup sees it
+// ----------------------------------------------------------------------------
+{
+    unicode cp = utf8_codepoint(text);
+    if (is_valid_as_name_initial(cp) || cp == L'↑')
+    {
+        size_t max = utf8_size(text, len);
+        while (max < len && !is_separator(text + max))
+            max += utf8_size(text + max, len - max);
+        return max;
+    }
+    if (text[0] == '=')
+        return 1 + (len > 1 && text[1] == '=');
+    return utf8_size(text, len);
+}
+
+
+static void add(entries &index, utf8 text, size_t len,
+                size_t position, uint level, bool prefix)
+// ----------------------------------------------------------------------------
+//   Add an entry to the index
+// ----------------------------------------------------------------------------
+{
+    if (position > help_index::POSITION)
+    {
+        fprintf(stderr, "Help file too large, position %zu\n", position);
+        exit(1);
+    }
+    if (level > 15)
+        level = 15;
+
+    entry e;
+    e.hash = help_index::hash(text, len);
+    e.data = uint32_t(position)
+        | (prefix ? uint32_t(help_index::PREFIX) : 0)
+        | (level << help_index::LEVEL_SHIFT);
+    index.push_back(e);
+}
+
+
+static void write_word(uint32_t value)
+// ----------------------------------------------------------------------------
+//   Write a 32-bit value in little-endian order
+// ----------------------------------------------------------------------------
+{
+    for (uint i = 0; i < 4; i++)
+        putchar((value >> (8 * i)) & 0xFF);
+}
+
+
+int main(int argc, char **argv)
+// ----------------------------------------------------------------------------
+//   Read the help file from standard input, write index to standard output
+// ----------------------------------------------------------------------------
+{
+    entries     index;
+    std::string line;
+    size_t      position = 0;
+    size_t      topics   = 0;
+    int         c;
+
+    do
+    {
+        c = getchar();
+        if (c != '\n' && c != EOF)
+        {
+            line += char(c);
+            continue;
+        }
+
+        utf8   text = utf8(line.data());
+        size_t len  = line.size();
+        if (len && text[0] == '#')
+        {
+            // Section header: level is the number of '#'
+            uint level = 0;
+            while (level < len && text[level] == '#')
+                level++;
+            size_t start = level;
+            while (start < len && text[start] == ' ')
+                start++;
+            text += start;
+            len  -= start;
+            add(index, text, len, position, level, false);
+            topics++;
+
+            // Commands may be documented in a section starting with them
+            if (level >= 2 && len)
+            {
+                size_t word = first_word(text, len);
+                if (word < len)
+                    add(index, text, word, position, level, true);
+            }
+        }
+        else if (len > 3 && text[0] == '*' && text[1] == ' ' && text[2] == '`')
+        {
+            // Solver variable, e.g. "* `Var`"
+            size_t end = line.find('`', 3);
+            if (end != line.npos)
+            {
+                add(index, text + 2, end - 1, position, 0, false);
+                topics++;
+            }
+        }
+
+        position += line.size() + 1;
+        line.clear();
+    } while (c != EOF);
+
+    // Sort by hash, and for the same topic, prefer main sections,
+    // then full topics over first words, then the first one in the file
+    std::sort(index.begin(), index.end(),
+              [](const entry &x, const entry &y)
+              {
+                  if (x.hash != y.hash)
+                      return x.hash < y.hash;
+                  if (x.level() != y.level())
+                      return x.level() < y.level();
+                  if (x.prefix() != y.prefix())
+                      return y.prefix();
+                  return x.position() < y.position();
+              });
+
+    write_word(help_index::MAGIC);
+    write_word(index.size());
+    uint e = 0;
+    for (uint b = 0; b <= help_index::BUCKETS; b++)
+    {
+        while (e < index.size() && help_index::bucket(index[e].hash) < b)
+            e++;
+        write_word(e);
+    }
+    for (const entry &x : index)
+    {
+        write_word(x.hash);
+        write_word(x.data);
+    }
+
+    if (argc > 1 && argv[1][0] == '-' && argv[1][1] == 'v')
+        fprintf(stderr, "%zu topics, %zu index entries\n",
+                topics, index.size());
+    return 0;
+}
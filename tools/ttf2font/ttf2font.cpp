@@ -174,9 +174,10 @@ void processFont(cstring fontName,
  *
  * The formats are designed to make it possible to store it efficiently as a
  * dynamic and moveable RPL object. The downside is that some linear scanning is
- * required when displaying characters. This is mitigated in the text display
- * code by keeping a cache for the current range, with the assumption that in
- * most cases, consecutive characters tend to be in the same range.
+ * required when displaying characters. This is mitigated in the font code by
+ * a glyph cache, and by an index built the first time a font is used, which
+ * records the position of every 16th glyph. The index is not emitted here, in
+ * order to keep the font data position-independent and compact.
  *
  * The tool computes the total size of font data in either case, to let you pick
  * the representation that uses the least data.